@@ -0,0 +1,149 @@
+/**
+ * @file main.cpp
+ * @brief Benchmark of virtual versus compile-time atom dispatch
+ *
+ * Evaluates the same trees over the A-law example atoms twice, with the
+ * same evaluator and buffers:
+ * - virtual: every node calls AtomFunc1/AtomFunc2::CalculateTile() through AtomFuncs;
+ * - static: the atoms come from AlawAtomSet, and nodes dispatch to inlined
+ *   kernels with a switch over atom indices;
+ * - fused: as static, and node patterns such as AND(SHR(x;c1);c2) are
+ *   evaluated by one fused kernel each.
+ *
+ * @section usage Usage
+ * Run with --help to see command line options
+ */
+
+#include <CLI/CLI.hpp>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <print>
+#include <vector>
+
+#include "atom_samples.h"
+#include "func_node.h"
+#include "static_atoms.h"
+
+using fw::AtomFuncBase;
+using fw::AtomFuncs;
+using fw::AtomList;
+using fw::FuncNode;
+using fw::FUSED_PATTERNS;
+using fw::FusedPattern;
+using fw::FusedPatternName;
+using fw::StaticAtomSet;
+using fw::StaticEvaluator;
+
+namespace
+{
+
+using Tree_t = FuncNode<Value_t, true, true>;
+/// No kernels known at compile time: every atom goes through its virtual call
+using NoAtomSet = StaticAtomSet<Value_t, AtomList<>, AtomList<>>;
+
+/// @brief Evaluate all trees repeatedly, return nanoseconds per tree and a checksum
+template <typename Set>
+std::pair<double, std::size_t> Run(const AtomFuncs<Value_t>& atoms, const Set& set, const std::vector<Tree_t>& trees,
+                                   std::size_t repeat, bool fuse = false)
+{
+    StaticEvaluator<Value_t, Set> evaluator{&atoms, &set, fuse};
+    std::size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0; r < repeat; ++r) {
+        for (const auto& tree : trees) {
+            const auto values = evaluator.Calculate(tree);
+            checksum += values.front() + values.back();
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (fuse) {
+        std::println("fused nodes: {:.1f}% of {}", 100.0 * evaluator.HitRate(), evaluator.Nodes());
+        for (std::size_t p = 0; p < FUSED_PATTERNS; ++p) {
+            const auto pattern = static_cast<FusedPattern>(p);
+            std::println("  {:<18} {}", FusedPatternName(pattern), evaluator.Hits(pattern));
+        }
+    }
+    return {elapsed.count() / static_cast<double>(repeat * trees.size()), checksum};
+}
+
+/// @brief Collect trees in enumeration order
+std::vector<Tree_t> Trees(AtomFuncs<Value_t>* atoms, std::size_t max_depth, std::size_t max_trees)
+{
+    std::vector<Tree_t> trees;
+    Tree_t fnc{atoms};
+    do {
+        trees.push_back(fnc);
+    } while ((trees.size() < max_trees) and fnc.Iterate(max_depth));
+    return trees;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t max_depth = 3;
+    std::size_t max_trees = 100'000;
+    std::size_t repeat = 10;
+
+    CLI::App app{"Compares virtual and compile-time dispatch of atoms in tree evaluation"};
+    app.add_option("--max-depth", max_depth, "Maximum tree depth")->check(CLI::PositiveNumber);
+    app.add_option("--trees", max_trees, "Number of trees, in enumeration order")->check(CLI::PositiveNumber);
+    app.add_option("--repeat", repeat, "Evaluations of each tree")->check(CLI::PositiveNumber);
+    CLI11_PARSE(app, argc, argv);
+
+    constexpr std::size_t MAX_CONSTANTS_2_POW = 4;
+    std::vector<std::unique_ptr<AtomFuncBase>> leaves;
+    AtomFuncs<Value_t> virtual_atoms;
+    auto af_x = std::make_unique<AF_ARG_X>();
+    virtual_atoms.Add(af_x.get());
+    leaves.push_back(std::move(af_x));
+    for (std::size_t i = 0; i < MAX_CONSTANTS_2_POW; ++i) {
+        auto af_c = std::make_unique<AF_CONST>(static_cast<Value_t>(1U << i));
+        virtual_atoms.Add(af_c.get());
+        leaves.push_back(std::move(af_c));
+    }
+    AtomFuncs<Value_t> static_atoms = virtual_atoms;
+
+    AF_NOT af_not;
+    AF_BITCOUNT af_bc;
+    AF_AND af_and;
+    AF_OR af_or;
+    AF_XOR af_xor;
+    AF_SHR af_shr;
+    AF_SHL af_shl;
+    virtual_atoms.Add(&af_not);
+    virtual_atoms.Add(&af_bc);
+    virtual_atoms.Add(&af_and);
+    virtual_atoms.Add(&af_or);
+    virtual_atoms.Add(&af_xor);
+    virtual_atoms.Add(&af_shr);
+    virtual_atoms.Add(&af_shl);
+    AlawAtomSet alaw_set;
+    alaw_set.Register(static_atoms);
+    // Three-atom patterns are not generated, only registered.
+    alaw_set.RegisterFused<K_OR, K_SHL, K_SHR>();
+    alaw_set.RegisterFused<K_OR, K_SHR, K_SHL>();
+    alaw_set.RegisterFused<K_XOR, K_AND, K_AND>();
+    const NoAtomSet no_set;
+
+    const auto virtual_trees = Trees(&virtual_atoms, max_depth, max_trees);
+    const auto static_trees = Trees(&static_atoms, max_depth, max_trees);
+
+    std::println("trees {} (depth up to {}), {} samples, {} repeats", virtual_trees.size(), max_depth,
+                 VALUES_COUNT, repeat);
+    // Warm up buffers and caches.
+    Run(virtual_atoms, no_set, virtual_trees, 1);
+    Run(static_atoms, alaw_set, static_trees, 1);
+    const auto [virtual_ns, virtual_sum] = Run(virtual_atoms, no_set, virtual_trees, repeat);
+    const auto [static_ns, static_sum] = Run(static_atoms, alaw_set, static_trees, repeat);
+    const auto [fused_ns, fused_sum] = Run(static_atoms, alaw_set, static_trees, repeat, true);
+    std::println("virtual dispatch: {:.1f} ns/tree", virtual_ns);
+    std::println("static dispatch:  {:.1f} ns/tree ({:.2f}x)", static_ns, virtual_ns / static_ns);
+    std::println("fused kernels:    {:.1f} ns/tree ({:.2f}x)", fused_ns, virtual_ns / fused_ns);
+    if ((virtual_sum != static_sum) or (virtual_sum != fused_sum)) {
+        std::println("checksum mismatch: {} != {} != {}", virtual_sum, static_sum, fused_sum);
+        return 1;
+    }
+    return 0;
+}
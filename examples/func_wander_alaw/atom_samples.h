@@ -1,8 +1,10 @@
 #pragma once
 
-#include <bitset>
+#include <bit>
+#include <string_view>
 
 #include <atom.h>
+#include <static_atoms.h>
 
 using fw::AtomFunc0;
 using fw::AtomFunc1;
@@ -156,36 +158,22 @@ class AF_FW1 : public AtomFunc1<Value_t>
     [[nodiscard]] bool Involutive() const override { return true; }
     [[nodiscard]] bool Argument() const override { return false; }
 
-    [[nodiscard]] std::string Str() const override { return "FW1"; }
-};
-
-class AF_FW2 : public AtomFunc1<Value_t>
-{
-   public:
-    ~AF_FW2() override = default;
+    [[nodiscard]] bool Elementwise() const override { return true; }
 
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg) const override
+    void CalculateTile(std::span<const Value_t> arg, std::span<Value_t> out) const override
     {
-        assert(arg.size() == VALUES_COUNT);
-        FuncValues_t res;
-        res.reserve(VALUES_COUNT);
-        for (std::size_t i = {}; i < VALUES_COUNT; ++i) {
-            // NOLINTNEXTLINE(readability-magic-numbers)
-            res.push_back(static_cast<Value_t>(((127 - arg[i]) << 4) + 8));
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<Value_t>((arg[i] << 4) + 8);
         }
-        return res;
     }
 
-    [[nodiscard]] bool Involutive() const override { return true; }
-    [[nodiscard]] bool Argument() const override { return false; }
-
-    [[nodiscard]] std::string Str() const override { return "FW2"; }
+    [[nodiscard]] std::string Str() const override { return "FW1"; }
 };
 
-class AF_NOT : public AtomFunc1<Value_t>
+class AF_FW2 : public AtomFunc1<Value_t>
 {
    public:
-    ~AF_NOT() override = default;
+    ~AF_FW2() override = default;
 
     [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg) const override
     {
@@ -193,47 +181,26 @@ class AF_NOT : public AtomFunc1<Value_t>
         FuncValues_t res;
         res.reserve(VALUES_COUNT);
         for (std::size_t i = {}; i < VALUES_COUNT; ++i) {
-            res.push_back(static_cast<Value_t>(~arg[i]));
+            // NOLINTNEXTLINE(readability-magic-numbers)
+            res.push_back(static_cast<Value_t>(((127 - arg[i]) << 4) + 8));
         }
         return res;
     }
 
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg_chars) const override
-    {
-        return true;
-    };
-
     [[nodiscard]] bool Involutive() const override { return true; }
     [[nodiscard]] bool Argument() const override { return false; }
 
-    [[nodiscard]] std::string Str() const override { return "NOT"; }
-};
-
-class AF_BITCOUNT : public AtomFunc1<Value_t>
-{
-   public:
-    ~AF_BITCOUNT() override = default;
+    [[nodiscard]] bool Elementwise() const override { return true; }
 
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg) const override
+    void CalculateTile(std::span<const Value_t> arg, std::span<Value_t> out) const override
     {
-        assert(arg.size() == VALUES_COUNT);
-        FuncValues_t res;
-        res.reserve(VALUES_COUNT);
-        for (std::size_t i = {}; i < VALUES_COUNT; ++i) {
-            res.push_back(static_cast<Value_t>(std::bitset<16>{static_cast<uint16_t>(arg[i])}.count()));
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            // NOLINTNEXTLINE(readability-magic-numbers)
+            out[i] = static_cast<Value_t>(((127 - arg[i]) << 4) + 8);
         }
-        return res;
     }
 
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg_chars) const override
-    {
-        return true;
-    };
-
-    [[nodiscard]] bool Involutive() const override { return true; }
-    [[nodiscard]] bool Argument() const override { return false; }
-
-    [[nodiscard]] std::string Str() const override { return "BITCOUNT"; }
+    [[nodiscard]] std::string Str() const override { return "FW2"; }
 };
 
 class AF_BITCLZ : public AtomFunc1<Value_t>
@@ -260,37 +227,16 @@ class AF_BITCLZ : public AtomFunc1<Value_t>
     [[nodiscard]] bool Involutive() const override { return true; }
     [[nodiscard]] bool Argument() const override { return false; }
 
-    [[nodiscard]] std::string Str() const override { return "BITCLZ"; }
-};
-
-class AF_SUM : public AtomFunc2<Value_t>
-{
-   public:
-    ~AF_SUM() override = default;
+    [[nodiscard]] bool Elementwise() const override { return true; }
 
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
+    void CalculateTile(std::span<const Value_t> arg, std::span<Value_t> out) const override
     {
-        assert(arg1.size() == VALUES_COUNT);
-        assert(arg2.size() == VALUES_COUNT);
-        FuncValues_t res;
-        res.reserve(VALUES_COUNT);
-        for (std::size_t i = {}; i < VALUES_COUNT; ++i) {
-            res.push_back(static_cast<Value_t>(arg1[i] + arg2[i]));
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<Value_t>(__builtin_clz(arg[i]) - 16);
         }
-        return res;
     }
 
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg1_chars,
-                                  [[maybe_unused]] const Characteristics<Value_t>& arg2_chars) const override
-    {
-        return true;
-    };
-
-    [[nodiscard]] bool Commutative() const override { return true; }
-
-    [[nodiscard]] bool Idempotent() const override { return false; }
-
-    [[nodiscard]] std::string Str() const override { return "SUM"; }
+    [[nodiscard]] std::string Str() const override { return "BITCLZ"; }
 };
 
 class AF_SUB : public AtomFunc2<Value_t>
@@ -320,161 +266,103 @@ class AF_SUB : public AtomFunc2<Value_t>
 
     [[nodiscard]] bool Idempotent() const override { return false; }
 
-    [[nodiscard]] std::string Str() const override { return "SUB"; }
-};
+    [[nodiscard]] bool Elementwise() const override { return true; }
 
-class AF_AND : public AtomFunc2<Value_t>
-{
-   public:
-    ~AF_AND() override = default;
-
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
+    void CalculateTile(std::span<const Value_t> arg1, std::span<const Value_t> arg2,
+                       std::span<Value_t> out) const override
     {
-        assert(arg1.size() == VALUES_COUNT);
-        assert(arg2.size() == VALUES_COUNT);
-        FuncValues_t res;
-        res.reserve(VALUES_COUNT);
-        for (std::size_t i = {}; i < VALUES_COUNT; ++i) {
-            res.push_back(static_cast<Value_t>(arg1[i] & arg2[i]));
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<Value_t>(arg1[i] - arg2[i]);
         }
-        return res;
     }
 
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg1_chars,
-                                  [[maybe_unused]] const Characteristics<Value_t>& arg2_chars) const override
-    {
-        return true;
-    };
-
-    [[nodiscard]] bool Commutative() const override { return true; }
+    [[nodiscard]] std::string Str() const override { return "SUB"; }
+};
 
-    [[nodiscard]] bool Idempotent() const override { return true; }
+// Kernels of the elementwise atoms, shared by compile-time atom sets (see fw::StaticAtomSet)
+// and the runtime atoms below, so each atom has a single definition.
 
-    [[nodiscard]] std::string Str() const override { return "AND"; }
+struct K_NOT
+{
+    static constexpr std::string_view NAME = "NOT";
+    static constexpr bool INVOLUTIVE = true;
+    static constexpr Value_t Apply(Value_t x) { return static_cast<Value_t>(~x); }
 };
 
-class AF_OR : public AtomFunc2<Value_t>
+struct K_BITCOUNT
 {
-   public:
-    ~AF_OR() override = default;
-
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
-    {
-        assert(arg1.size() == VALUES_COUNT);
-        assert(arg2.size() == VALUES_COUNT);
-        FuncValues_t res;
-        res.reserve(VALUES_COUNT);
-        for (std::size_t i = {}; i < VALUES_COUNT; ++i) {
-            res.push_back(static_cast<Value_t>(arg1[i] | arg2[i]));
-        }
-        return res;
-    }
-
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg1_chars,
-                                  [[maybe_unused]] const Characteristics<Value_t>& arg2_chars) const override
-    {
-        return true;
-    };
-
-    [[nodiscard]] bool Commutative() const override { return true; }
-
-    [[nodiscard]] bool Idempotent() const override { return true; }
-
-    [[nodiscard]] std::string Str() const override { return "OR"; }
+    static constexpr std::string_view NAME = "BITCOUNT";
+    static constexpr bool INVOLUTIVE = true;
+    static constexpr Value_t Apply(Value_t x) { return static_cast<Value_t>(std::popcount(x)); }
 };
 
-class AF_XOR : public AtomFunc2<Value_t>
+struct K_SUM
 {
-   public:
-    ~AF_XOR() override = default;
-
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
-    {
-        assert(arg1.size() == VALUES_COUNT);
-        assert(arg2.size() == VALUES_COUNT);
-        FuncValues_t res;
-        res.reserve(VALUES_COUNT);
-        for (std::size_t i = {}; i < VALUES_COUNT; ++i) {
-            res.push_back(static_cast<Value_t>(arg1[i] ^ arg2[i]));
-        }
-        return res;
-    }
-
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg1_chars,
-                                  [[maybe_unused]] const Characteristics<Value_t>& arg2_chars) const override
-    {
-        return true;
-    };
-
-    [[nodiscard]] bool Commutative() const override { return true; }
+    static constexpr std::string_view NAME = "SUM";
+    static constexpr bool COMMUTATIVE = true;
+    static constexpr bool IDEMPOTENT = false;
+    static constexpr Value_t Apply(Value_t x, Value_t y) { return static_cast<Value_t>(x + y); }
+};
 
-    [[nodiscard]] bool Idempotent() const override { return true; }
+struct K_AND
+{
+    static constexpr std::string_view NAME = "AND";
+    static constexpr bool COMMUTATIVE = true;
+    static constexpr bool IDEMPOTENT = true;
+    static constexpr Value_t Apply(Value_t x, Value_t y) { return static_cast<Value_t>(x & y); }
+};
 
-    [[nodiscard]] std::string Str() const override { return "XOR"; }
+struct K_OR
+{
+    static constexpr std::string_view NAME = "OR";
+    static constexpr bool COMMUTATIVE = true;
+    static constexpr bool IDEMPOTENT = true;
+    static constexpr Value_t Apply(Value_t x, Value_t y) { return static_cast<Value_t>(x | y); }
 };
 
-class AF_SHR : public AtomFunc2<Value_t>
+struct K_XOR
 {
-   public:
-    ~AF_SHR() override = default;
+    static constexpr std::string_view NAME = "XOR";
+    static constexpr bool COMMUTATIVE = true;
+    static constexpr bool IDEMPOTENT = true;
+    static constexpr Value_t Apply(Value_t x, Value_t y) { return static_cast<Value_t>(x ^ y); }
+};
 
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
+struct K_SHR
+{
+    static constexpr std::string_view NAME = "SHR";
+    static constexpr bool COMMUTATIVE = false;
+    static constexpr bool IDEMPOTENT = false;
+    static constexpr Value_t Apply(Value_t x, Value_t y) { return static_cast<Value_t>(x >> y); }
+    static bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg1_chars,
+                           const Characteristics<Value_t>& arg2_chars)
     {
-        assert(arg1.size() == VALUES_COUNT);
-        assert(arg2.size() == VALUES_COUNT);
-        FuncValues_t res;
-        res.reserve(VALUES_COUNT);
-        for (std::size_t i = {}; i < VALUES_COUNT; ++i) {
-            res.push_back(static_cast<Value_t>(arg1[i] >> arg2[i]));
-        }
-        return res;
+        return (arg2_chars.min < 32);
     }
-
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg1_chars,
-                                  [[maybe_unused]] const Characteristics<Value_t>& arg2_chars) const override
-    {
-        if (arg2_chars.min >= 32) {
-            return false;
-        }
-        return true;
-    };
-
-    [[nodiscard]] bool Commutative() const override { return false; }
-
-    [[nodiscard]] bool Idempotent() const override { return false; }
-
-    [[nodiscard]] std::string Str() const override { return "SHR"; }
 };
 
-class AF_SHL : public AtomFunc2<Value_t>
+struct K_SHL
 {
-   public:
-    ~AF_SHL() override = default;
-
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
+    static constexpr std::string_view NAME = "SHL";
+    static constexpr bool COMMUTATIVE = false;
+    static constexpr bool IDEMPOTENT = false;
+    static constexpr Value_t Apply(Value_t x, Value_t y) { return static_cast<Value_t>(x << y); }
+    static bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg1_chars,
+                           const Characteristics<Value_t>& arg2_chars)
     {
-        assert(arg1.size() == VALUES_COUNT);
-        assert(arg2.size() == VALUES_COUNT);
-        FuncValues_t res;
-        res.reserve(VALUES_COUNT);
-        for (std::size_t i = {}; i < VALUES_COUNT; ++i) {
-            res.push_back(static_cast<Value_t>(arg1[i] << arg2[i]));
-        }
-        return res;
+        return (arg2_chars.min < 32);
     }
+};
 
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<Value_t>& arg1_chars,
-                                  [[maybe_unused]] const Characteristics<Value_t>& arg2_chars) const override
-    {
-        if (arg2_chars.min >= 32) {
-            return false;
-        }
-        return true;
-    };
-
-    [[nodiscard]] bool Commutative() const override { return false; }
-
-    [[nodiscard]] bool Idempotent() const override { return false; }
-
-    [[nodiscard]] std::string Str() const override { return "SHL"; }
-};
\ No newline at end of file
+using AF_NOT = fw::StaticAtom1<Value_t, K_NOT>;
+using AF_BITCOUNT = fw::StaticAtom1<Value_t, K_BITCOUNT>;
+using AF_SUM = fw::StaticAtom2<Value_t, K_SUM>;
+using AF_AND = fw::StaticAtom2<Value_t, K_AND>;
+using AF_OR = fw::StaticAtom2<Value_t, K_OR>;
+using AF_XOR = fw::StaticAtom2<Value_t, K_XOR>;
+using AF_SHR = fw::StaticAtom2<Value_t, K_SHR>;
+using AF_SHL = fw::StaticAtom2<Value_t, K_SHL>;
+
+/// Atoms of func_wander_alaw known at compile time
+using AlawAtomSet = fw::StaticAtomSet<Value_t, fw::AtomList<K_NOT, K_BITCOUNT>,
+                                      fw::AtomList<K_AND, K_OR, K_XOR, K_SHR, K_SHL>>;
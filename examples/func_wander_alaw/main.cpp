@@ -32,6 +32,7 @@
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <exception>
 #include <format>
 #include <fstream>
 #include <iostream>
@@ -43,10 +44,12 @@
 
 #include "atom_samples.h"
 #include "interaction_cli.h"
+#include "target_file.h"
 #include "target_sample.h"
 
 using fw::AtomFuncBase;
 using fw::AtomFuncs;
+using fw::FileTarget;
 using fw::SearchTask;
 using fw::Settings;
 
@@ -54,7 +57,47 @@ namespace
 {
 
 bool g_print_target = false;
+std::string g_target_file;
+std::string g_target_mask;
+std::string g_target_weights;
 std::vector<std::unique_ptr<AtomFuncBase>> g_atoms;
+std::vector<std::string> g_atom_costs;
+
+/// @brief Apply NAME=COST entries to atoms by their string representation
+bool SetAtomCosts()
+{
+    for (const auto& entry : g_atom_costs) {
+        const auto eq = entry.find('=');
+        if (eq == std::string::npos) {
+            std::println("Invalid atom cost (expected NAME=COST): {}", entry);
+            return false;
+        }
+        const auto name = entry.substr(0, eq);
+        std::size_t cost = 0;
+        try {
+            cost = std::stoul(entry.substr(eq + 1));
+        }
+        catch (const std::exception&) {
+            cost = 0;
+        }
+        if (cost == 0) {
+            std::println("Invalid atom cost (expected positive number): {}", entry);
+            return false;
+        }
+        bool found = false;
+        for (const auto& atom : g_atoms) {
+            if (atom->Str() == name) {
+                atom->SetCost(cost);
+                found = true;
+            }
+        }
+        if (not found) {
+            std::println("Unknown atom in cost: {}", entry);
+            return false;
+        }
+    }
+    return true;
+}
 
 void InitAtoms(AtomFuncs<Value_t>& atoms, MyTarget& target)
 {
@@ -148,7 +191,44 @@ int main(int argc, char* argv[])
     app.add_option("--http-host", settings.http_host, "Host address for HTTP server (default: localhost)");
     app.add_option("--http-port", settings.http_port, "Port for HTTP server (default: 8080, range 1-65535)")
         ->check(CLI::Range(1, 65535));
+    app.add_option("--probe-samples", settings.probe_samples,
+                   "Samples in the first tier of progressive evaluation (0 disables)");
+    app.add_option("--tile-size", settings.tile_size, "Samples per tile for streaming evaluation (0 disables)");
+    app.add_option("--unary-chains", settings.unary_chains,
+                   "Tabulate chains of unary atoms up to this length for evaluation");
+    app.add_flag("--random-sampling", settings.random_sampling, "Draw random trees instead of enumerating in order");
+    app.add_option("--random-seed", settings.random_seed, "Seed of random sampling (0 - nondeterministic)");
+    app.add_option("--depth-weights", settings.depth_weights, "Relative sampling weight per depth, e.g. 0 1 4");
+    app.add_flag("--size-order", settings.size_order, "Enumerate trees by cost (node count) instead of depth");
+    app.add_option("--max-cost", settings.max_cost, "Maximum tree cost in size or best-first order");
+    app.add_flag("--best-first", settings.best_first, "Enumerate trees best-first by weighted atom cost");
+    app.add_option("--max-queue", settings.max_queue, "Partial expansions kept in the best-first queue")
+        ->check(CLI::PositiveNumber);
+    app.add_option("--atom-cost", g_atom_costs, "Atom cost as NAME=COST, e.g. BITCOUNT=3 (default cost 1)");
+    app.add_option("--dag-steps", settings.dag_steps,
+                   "Enumerate DAG programs with shared subexpressions up to this many steps (0 - trees)");
+    app.add_flag("--shape-first", settings.shape_first, "Enumerate tree shapes, then atom labels per shape");
+    app.add_option("--shape-shards", settings.shape_shards, "Number of jobs the shapes are split between")
+        ->check(CLI::PositiveNumber);
+    app.add_option("--shape-shard", settings.shape_shard, "Shapes of this job (0 to shape-shards - 1)");
+    app.add_flag("--gray-order", settings.gray_order, "Visit labels of a shape in Gray order (one change per step)");
+    app.add_flag("--iterative-deepening", settings.iterative_deepening,
+                 "Complete depths in turn; a larger --max-depth continues a finished checkpoint");
+    app.add_flag("--huge-pages", settings.huge_pages, "Back large value buffers by huge pages where possible");
+    app.add_flag("--bottom-up", settings.bottom_up, "Enumerate distinct values bottom-up from banks per depth");
+    app.add_option("--memory-budget", settings.memory_budget, "Memory of value caches, e.g. 4GB (0 - unlimited)")
+        ->transform(CLI::AsSizeValue(false));
+    app.add_option("--spill-dir", settings.spill_dir, "Directory for value blocks beyond --memory-budget (local disk)")
+        ->check(CLI::ExistingDirectory);
+    app.add_option("--bank-tile", settings.bank_tile, "Bank entries per side of a combination tile (0 - auto from L2)");
+    app.add_flag("--affine-stage", settings.affine_stage, "Solve target as a GF(2)-affine map of each candidate");
     app.add_flag("--print-target", g_print_target, "Print target function");
+    app.add_option("--target-file", g_target_file, "Load target samples from binary or .csv file instead of A-law")
+        ->check(CLI::ExistingFile);
+    app.add_option("--target-mask", g_target_mask, "Binary don't-care mask for --target-file, one byte per sample")
+        ->check(CLI::ExistingFile);
+    app.add_option("--target-weights", g_target_weights, "Binary per-sample weights for --target-file")
+        ->check(CLI::ExistingFile);
 
     try {
         // Parse command line arguments
@@ -163,6 +243,23 @@ int main(int argc, char* argv[])
     MyTarget target;
 
     InitAtoms(atoms, target);
+    if (not SetAtomCosts()) {
+        return EXIT_FAILURE;
+    }
+
+    if (not g_target_file.empty()) {
+        FileTarget<Value_t> file_target;
+        if (not file_target.Load(g_target_file, g_target_mask, g_target_weights)) {
+            std::println("Failed to load target from file: {}", g_target_file);
+            return EXIT_FAILURE;
+        }
+        if (file_target.Size() != VALUES_COUNT) {
+            std::println("Target file must hold {} samples, got {}", VALUES_COUNT, file_target.Size());
+            return EXIT_FAILURE;
+        }
+        return MainLoop<Value_t>(settings, atoms, file_target);
+    }
+
     const auto result = MainLoop<Value_t>(settings, atoms, target);
 
     return result;
@@ -9,6 +9,7 @@
 using fw::Distance;
 using fw::RangeSet;
 using fw::Target;
+using fw::TargetValues;
 
 const std::array<uint16_t, 256> alaw2lpcm{
     0b1000'0000'0000'1000,  // 0b0000'0000    000
@@ -269,44 +270,31 @@ const std::array<uint16_t, 256> alaw2lpcm{
     0b0111'1110'0000'0000,  // 0b1111'1111    255
 };
 
-class MyTarget : public Target<Value_t>
+inline std::vector<Value_t> AlawTargetValues()
 {
-   public:
-    ~MyTarget() override = default;
-
-    MyTarget()
-    {
-        m_values.clear();
-        for (std::size_t i = 0; i < VALUES_COUNT; ++i) {
-            // NOLINTNEXTLINE(readability-magic-numbers)
-            auto l = static_cast<Value_t>(alaw2lpcm[i]);
-            m_values.push_back(l);
-        }
+    std::vector<Value_t> values;
+    values.reserve(VALUES_COUNT);
+    for (std::size_t i = 0; i < VALUES_COUNT; ++i) {
+        values.push_back(static_cast<Value_t>(alaw2lpcm[i]));
     }
+    return values;
+}
 
-    [[nodiscard]] Distance Compare(const FuncValues_t& values) const override
-    {
-        Distance dist{};
-        for (std::size_t i = VALUE_FIRST; i <= VALUE_LAST; ++i) {
-            if (values[i] != m_values[i]) {
-                ++dist;
-            }
-        }
-        return dist;
+inline std::vector<uint8_t> AlawCareMask()
+{
+    std::vector<uint8_t> mask(VALUES_COUNT, 0);
+    for (std::size_t i = VALUE_FIRST; i <= VALUE_LAST; ++i) {
+        mask[i] = 1;
     }
+    return mask;
+}
 
-    [[nodiscard]] RangeSet<std::size_t> MatchPositions(const FuncValues_t& values) const override
-    {
-        RangeSet<std::size_t> rset;
-        for (std::size_t i = VALUE_FIRST; i <= VALUE_LAST; ++i) {
-            if (values[i] == m_values[i]) {
-                rset.Add(i);
-            }
-        }
-        return rset;
-    }
+class MyTarget : public TargetValues<Value_t>
+{
+   public:
+    ~MyTarget() override = default;
 
-    [[nodiscard]] FuncValues_t Values() const override { return m_values; }
+    MyTarget() : TargetValues<Value_t>(AlawTargetValues(), AlawCareMask()) {}
 
     [[nodiscard]] std::string StrFull() const
     {
@@ -316,7 +304,4 @@ class MyTarget : public Target<Value_t>
         }
         return res;
     }
-
-   private:
-    FuncValues_t m_values;
-};
\ No newline at end of file
+};
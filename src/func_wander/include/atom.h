@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cassert>
+#include <span>
 #include <string>
 #include <variant>
 #include <vector>
@@ -38,6 +40,25 @@ class AtomFuncBase
      * @return String representation (e.g., "sin", "+", "const_5")
      */
     [[nodiscard]] virtual std::string Str() const = 0;
+
+    /**
+     * @brief Get cost of the function for cost-ordered enumeration
+     * @return Positive cost (1 by default - trees are ordered by node count)
+     */
+    [[nodiscard]] virtual std::size_t Cost() const { return m_cost; }
+
+    /**
+     * @brief Set cost of the function
+     * @param cost Positive cost; rarer operations get higher costs
+     */
+    void SetCost(std::size_t cost)
+    {
+        assert(cost > 0);
+        m_cost = cost;
+    }
+
+   private:
+    std::size_t m_cost = 1;  ///< Cost in cost-ordered enumeration
 };
 
 /**
@@ -69,6 +90,30 @@ class AtomFunc0 : public AtomFuncBase
      * @return true if the function always returns the same value
      */
     [[nodiscard]] virtual bool Constant() const = 0;
+
+    /**
+     * @brief Calculate values for a contiguous tile of samples
+     * @param first Index of the first sample in the tile
+     * @param out Output buffer, its size is the tile length
+     */
+    virtual void CalculateTile(std::size_t first, std::span<FuncValue_t> out) const
+    {
+        const auto& values = Calculate();
+        std::copy_n(values.begin() + static_cast<std::ptrdiff_t>(first), out.size(), out.begin());
+    }
+
+    /**
+     * @brief Calculate values for scattered samples
+     * @param positions Sample indices to gather
+     * @param out Output buffer of the same size
+     */
+    virtual void CalculateGather(std::span<const std::size_t> positions, std::span<FuncValue_t> out) const
+    {
+        const auto& values = Calculate();
+        for (std::size_t k = 0; k < positions.size(); ++k) {
+            out[k] = values[positions[k]];
+        }
+    }
 };
 
 /**
@@ -106,6 +151,27 @@ class AtomFunc1 : public AtomFuncBase
      * @return true if f(x) = x
      */
     [[nodiscard]] virtual bool Argument() const = 0;
+
+    /**
+     * @brief Check if each output sample depends only on the same input sample
+     * @return true if the function can be evaluated on any subset of samples
+     */
+    [[nodiscard]] virtual bool Elementwise() const { return false; }
+
+    /**
+     * @brief Calculate function values for a tile of argument samples
+     * @param arg Argument values of the tile
+     * @param out Output buffer of the same size
+     * 
+     * Valid only for elementwise functions. The default implementation
+     * goes through Calculate(); override it to avoid the copies.
+     */
+    virtual void CalculateTile(std::span<const FuncValue_t> arg, std::span<FuncValue_t> out) const
+    {
+        assert(Elementwise());
+        const auto res = Calculate(FuncValues_t(arg.begin(), arg.end()));
+        std::ranges::copy(res, out.begin());
+    }
 };
 
 /**
@@ -145,6 +211,29 @@ class AtomFunc2 : public AtomFuncBase
      * @return true if f(x,x) = x for all x
      */
     [[nodiscard]] virtual bool Idempotent() const = 0;
+
+    /**
+     * @brief Check if each output sample depends only on the same input samples
+     * @return true if the function can be evaluated on any subset of samples
+     */
+    [[nodiscard]] virtual bool Elementwise() const { return false; }
+
+    /**
+     * @brief Calculate function values for a tile of argument samples
+     * @param arg1 First argument values of the tile
+     * @param arg2 Second argument values of the tile
+     * @param out Output buffer of the same size
+     * 
+     * Valid only for elementwise functions. The default implementation
+     * goes through Calculate(); override it to avoid the copies.
+     */
+    virtual void CalculateTile(std::span<const FuncValue_t> arg1, std::span<const FuncValue_t> arg2,
+                               std::span<FuncValue_t> out) const
+    {
+        assert(Elementwise());
+        const auto res = Calculate(FuncValues_t(arg1.begin(), arg1.end()), FuncValues_t(arg2.begin(), arg2.end()));
+        std::ranges::copy(res, out.begin());
+    }
 };
 
 /**
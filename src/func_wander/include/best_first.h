@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "func_node.h"
+#include "serial_number.h"
+
+namespace fw
+{
+
+/// @addtogroup FunctionNodes
+/// @{
+
+/**
+ * @class BestFirst
+ * @brief Best-first enumeration of function trees by weighted atom cost
+ * @tparam FuncValue_t Type of function values
+ * @tparam SKIP_CONSTANT Whether to skip constant expressions
+ * @tparam SKIP_SYMMETRIC Whether to skip symmetric duplicates for commutative ops
+ * @tparam SN_t Serial number type
+ *
+ * A partial expansion is a prefix of a tree in preorder: the atoms placed
+ * so far and the number of pending operand holes. Its priority is the
+ * cost of the placed atoms plus the cheapest leaf cost per hole, a lower
+ * bound of every tree it expands to. Expanding fills the next hole with
+ * each atom. Partials are keyed by (priority, preorder atoms): since atom
+ * costs are positive and an expansion extends the prefix, every child key
+ * is greater than its parent's, so trees are popped from the priority
+ * queue in non-decreasing cost, in a fixed order within a cost.
+ *
+ * Memory is bounded: once the queue holds twice max_queue entries, only
+ * the max_queue smallest keys are kept and the smallest dropped key D is
+ * remembered. Every tree below D is still emitted in order; when the queue
+ * reaches D it is refilled by a depth-first pass from the root, which
+ * regenerates the frontier of keys ≥ D with stack memory only. The kept
+ * entries hold D itself, so each refill moves forward. The same pass
+ * resumes the enumeration after a saved tree.
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false,
+          typename SN_t = SerialNumber_t>
+class BestFirst
+{
+   public:
+    using FN_t = FuncNode<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t>;
+
+    /**
+     * @brief Construct enumerator positioned before the first tree
+     * @param atoms Pointer to atomic function library
+     * @param max_cost Maximum cost of enumerated trees
+     * @param max_queue Partial expansions kept after trimming the queue
+     */
+    BestFirst(const AtomFuncs<FuncValue_t>* atoms, std::size_t max_cost, std::size_t max_queue)
+        : m_atoms(atoms), m_max_cost(max_cost), m_max_queue(std::max<std::size_t>(max_queue, 1))
+    {
+        for (const auto* leaf : m_atoms->arg0) {
+            m_min_leaf = std::min(m_min_leaf, leaf->Cost());
+        }
+        if (m_min_leaf <= m_max_cost) {
+            Push(Root());
+        }
+    }
+
+    /**
+     * @brief Advance to the next tree in cost order
+     * @param fnc Tree rebuilt in place; unchanged subtrees keep cached values
+     * @return true if next tree exists, false if enumeration complete
+     *
+     * Trees pruned by SKIP_CONSTANT or SKIP_SYMMETRIC are skipped.
+     */
+    bool Next(FN_t& fnc)
+    {
+        while (true) {
+            if (m_dropped and (m_heap.empty() or not Less(m_heap.front(), *m_dropped))) {
+                const Partial bound = std::move(*m_dropped);
+                ++m_refills;
+                Refill(bound, true);
+                continue;
+            }
+            if (m_heap.empty()) {
+                return false;
+            }
+
+            std::ranges::pop_heap(m_heap, Later);
+            Partial partial = std::move(m_heap.back());
+            m_heap.pop_back();
+            if (partial.pending > 0) {
+                Expand(partial, [this](Partial&& child) { Push(std::move(child)); });
+                continue;
+            }
+
+            std::size_t pos = 0;
+            Build(fnc, partial.atoms, pos);
+            if (not fnc.Pruned()) {
+                return true;
+            }
+        }
+    }
+
+    /**
+     * @brief Continue enumeration after a given tree
+     * @param fnc Last visited tree, e.g. restored from a checkpoint
+     */
+    void Resume(const FN_t& fnc)
+    {
+        Partial bound;
+        bound.priority = fnc.Cost();
+        Preorder(fnc, bound.atoms);
+        Refill(bound, false);
+    }
+
+    /// @brief Number of partial expansions in the queue
+    [[nodiscard]] std::size_t QueueSize() const { return m_heap.size(); }
+
+    /// @brief Number of refills after trimming the queue
+    [[nodiscard]] std::size_t Refills() const { return m_refills; }
+
+   private:
+    static constexpr std::size_t NONE = SIZE_MAX;
+
+    /// @brief Prefix of a tree in preorder
+    struct Partial
+    {
+        std::size_t priority = 0;      ///< Lower bound of the cost of completed trees
+        std::size_t cost = 0;          ///< Cost of placed atoms
+        std::size_t pending = 0;       ///< Operand holes left to fill
+        std::vector<AtomIndex> atoms;  ///< Placed atoms in preorder
+    };
+
+    const AtomFuncs<FuncValue_t>* m_atoms = nullptr;  ///< Atomic function library
+    std::size_t m_max_cost = 0;                       ///< Maximum cost of enumerated trees
+    std::size_t m_max_queue = 0;                      ///< Queue size after trimming
+    std::size_t m_min_leaf = NONE;                    ///< Cheapest leaf cost, priority of a hole
+    std::vector<Partial> m_heap;                      ///< Priority queue of partial expansions
+    std::optional<Partial> m_dropped;                 ///< Smallest key dropped by trimming
+    std::size_t m_refills = 0;                        ///< Refills after trimming
+
+    /// @brief Key order: priority, then preorder atoms
+    static bool Less(const Partial& a, const Partial& b)
+    {
+        if (a.priority != b.priority) {
+            return (a.priority < b.priority);
+        }
+        return std::ranges::lexicographical_compare(a.atoms, b.atoms, [](const AtomIndex& x, const AtomIndex& y) {
+            return (x.arity != y.arity) ? (x.arity < y.arity) : (x.num < y.num);
+        });
+    }
+
+    /// @brief Heap order: smallest key on top
+    static bool Later(const Partial& a, const Partial& b) { return Less(b, a); }
+
+    [[nodiscard]] Partial Root() const { return Partial{.priority = m_min_leaf, .cost = 0, .pending = 1, .atoms = {}}; }
+
+    void Push(Partial&& partial)
+    {
+        m_heap.push_back(std::move(partial));
+        std::ranges::push_heap(m_heap, Later);
+        if (m_heap.size() < 2 * m_max_queue) {
+            return;
+        }
+
+        // Keep the smallest max_queue keys.
+        const auto keep = m_heap.begin() + static_cast<std::ptrdiff_t>(m_max_queue);
+        std::ranges::nth_element(m_heap, keep, Less);
+        const auto dropped = std::ranges::min_element(keep, m_heap.end(), Less);
+        if ((not m_dropped) or Less(*dropped, *m_dropped)) {
+            m_dropped = std::move(*dropped);
+        }
+        m_heap.erase(keep, m_heap.end());
+        std::ranges::make_heap(m_heap, Later);
+    }
+
+    /// @brief Pass every child of a partial expansion within the maximum cost to a sink
+    template <typename Sink>
+    void Expand(const Partial& partial, Sink&& sink) const
+    {
+        const auto add = [&](std::size_t arity, const auto& funcs) {
+            for (std::size_t num = 0; num < funcs.size(); ++num) {
+                Partial child;
+                child.cost = partial.cost + funcs[num]->Cost();
+                child.pending = partial.pending - 1 + arity;
+                child.priority = child.cost + (child.pending * m_min_leaf);
+                if (child.priority > m_max_cost) {
+                    continue;
+                }
+                child.atoms.reserve(partial.atoms.size() + 1);
+                child.atoms = partial.atoms;
+                child.atoms.push_back(AtomIndex{arity, num});
+                sink(std::move(child));
+            }
+        };
+        add(0, m_atoms->arg0);
+        add(1, m_atoms->arg1);
+        add(2, m_atoms->arg2);
+    }
+
+    /**
+     * @brief Rebuild the queue as the frontier of keys after a bound
+     * @param bound Trees with smaller keys were emitted
+     * @param inclusive Whether the bound itself is still to be emitted
+     */
+    void Refill(const Partial& bound, bool inclusive)
+    {
+        m_heap.clear();
+        m_dropped.reset();
+        if (m_min_leaf <= m_max_cost) {
+            Descend(Root(), bound, inclusive);
+        }
+    }
+
+    void Descend(Partial&& partial, const Partial& bound, bool inclusive)
+    {
+        if (Less(bound, partial) or (inclusive and not Less(partial, bound))) {
+            Push(std::move(partial));
+            return;
+        }
+        if (partial.pending > 0) {
+            Expand(partial, [&](Partial&& child) { Descend(std::move(child), bound, inclusive); });
+        }
+    }
+
+    static void Preorder(const FN_t& node, std::vector<AtomIndex>& atoms)
+    {
+        atoms.push_back(node.Atom());
+        if (node.Arity() >= 1) {
+            Preorder(node.Arg1(), atoms);
+        }
+        if (node.Arity() == 2) {
+            Preorder(node.Arg2(), atoms);
+        }
+    }
+
+    /**
+     * @brief Build subtree from preorder atoms in place
+     * @return true if the subtree changed
+     */
+    static bool Build(FN_t& node, std::span<const AtomIndex> atoms, std::size_t& pos)
+    {
+        const auto atom = atoms[pos++];
+        bool changed = node.SetAtom(atom);
+        if (atom.arity >= 1) {
+            changed = Build(node.Arg1(), atoms, pos) or changed;
+        }
+        if (atom.arity == 2) {
+            changed = Build(node.Arg2(), atoms, pos) or changed;
+        }
+        if (changed) {
+            node.ClearCalculated();
+        }
+        return changed;
+    }
+};
+
+/// @} // end of FunctionNodes group
+
+}  // namespace fw
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+
+#include "func_node.h"
+#include "serial_number.h"
+
+namespace fw
+{
+
+/// @addtogroup FunctionNodes
+/// @{
+
+/**
+ * @class CanonicalCounter
+ * @brief Exact count and rank of trees that survive structural pruning
+ * @tparam FuncValue_t Type of function values
+ * @tparam SKIP_CONSTANT Whether constant expressions are skipped
+ * @tparam SKIP_SYMMETRIC Whether symmetric duplicates of commutative ops are skipped
+ * @tparam SN_t Serial number type
+ *
+ * Serial numbers count every tree, but Iterate() skips a non-uniform
+ * share of them, so progress measured by serial number is misleading.
+ * This counter applies the structural pruning rules of Iterate():
+ * - all-constant subtrees (SKIP_CONSTANT);
+ * - commutative operands out of serial number order (SKIP_SYMMETRIC),
+ *   except the starting pair (leaf 0; leaf 0) that Iterate() keeps.
+ *
+ * Per depth level l it counts:
+ * - N(l), the canonical trees of depth exactly l;
+ * - L(l), the canonical trees of depth ≤ l.
+ *
+ * Rank() gives the position of a canonical tree among them in enumeration
+ * order. Trees pruned only because their values happen to be constant
+ * are data-dependent and still counted, so the count is an upper bound
+ * of the trees actually visited.
+ *
+ * Constant leaves are expected at the end of the leaf list (see
+ * AtomFuncs::Add()).
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false,
+          typename SN_t = SerialNumber_t>
+class CanonicalCounter
+{
+   public:
+    using FN_t = FuncNode<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t>;
+
+    /**
+     * @brief Precompute counts for all levels
+     * @param atoms Pointer to atomic function library
+     * @param max_depth Maximum depth of trees
+     */
+    CanonicalCounter(const AtomFuncs<FuncValue_t>* atoms, std::size_t max_depth) : m_atoms(atoms)
+    {
+        m_leaves = m_atoms->arg0.size();
+        for (const auto* leaf : m_atoms->arg0) {
+            if (SKIP_CONSTANT and leaf->Constant()) {
+                ++m_const_leaves;
+            }
+            else {
+                assert(m_const_leaves == 0);
+            }
+        }
+
+        m_exact.push_back(SN_t(m_leaves));
+        m_total.push_back(SN_t(m_leaves));
+        for (std::size_t l = 1; l <= max_depth; ++l) {
+            SN_t exact{};
+            SN_t unary{};
+            if (not CheckedMul(SN_t(m_atoms->arg1.size()), Unary(l), unary) or not CheckedAdd(exact, unary, exact)) {
+                m_fits = false;
+                return;
+            }
+            for (std::size_t num = 0; num < m_atoms->arg2.size(); ++num) {
+                SN_t binary{};
+                if (not PairsBefore(l, num, m_exact[l - 1], binary) or not CheckedAdd(exact, binary, exact)) {
+                    m_fits = false;
+                    return;
+                }
+            }
+            SN_t total{};
+            if (not CheckedAdd(m_total[l - 1], exact, total)) {
+                m_fits = false;
+                return;
+            }
+            m_exact.push_back(exact);
+            m_total.push_back(total);
+        }
+    }
+
+    /// @brief Check if all counts fit SN_t
+    [[nodiscard]] bool Fits() const { return m_fits; }
+
+    /// @brief Number of canonical trees with depth ≤ level
+    [[nodiscard]] SN_t Count(std::size_t level) const
+    {
+        assert(m_fits and (level < m_total.size()));
+        return m_total[level];
+    }
+
+    /**
+     * @brief Position of a canonical tree among all canonical trees in enumeration order
+     * @param fnc Canonical function tree (depth within the precomputed levels)
+     * @return Number of canonical trees enumerated before it
+     */
+    [[nodiscard]] SN_t Rank(const FN_t& fnc) const
+    {
+        assert(m_fits);
+        const auto& atom = fnc.Atom();
+        if (atom.arity == 0) {
+            return SN_t(atom.num);
+        }
+
+        const auto level = fnc.CurrentMaxLevel();
+        const SN_t smaller = m_total[level - 1];
+        const SN_t smaller2 = (level > 1) ? m_total[level - 2] : SN_t{};
+        if (atom.arity == 1) {
+            // Children of depth exactly level-1, constant leaves excluded (they are last).
+            return smaller + (Unary(level) * SN_t(atom.num)) + (Rank(fnc.Arg1()) - smaller2);
+        }
+
+        SN_t rank = smaller + (Unary(level) * SN_t(m_atoms->arg1.size()));
+        for (std::size_t num = 0; num < atom.num; ++num) {
+            SN_t pairs{};
+            PairsBefore(level, num, m_exact[level - 1], pairs);
+            rank += pairs;
+        }
+
+        // Pairs are ordered by the right operand first, then by the left one.
+        SN_t pairs{};
+        PairsBefore(level, atom.num, Rank(fnc.Arg2()) - smaller2, pairs);
+        return rank + pairs + Rank(fnc.Arg1());
+    }
+
+   private:
+    const AtomFuncs<FuncValue_t>* m_atoms = nullptr;  ///< Atomic function library
+    std::size_t m_leaves = 0;                         ///< Number of leaves
+    std::size_t m_const_leaves = 0;                   ///< Number of constant leaves (with SKIP_CONSTANT)
+    std::vector<SN_t> m_exact;                        ///< N(l): canonical trees of depth exactly l
+    std::vector<SN_t> m_total;                        ///< L(l): canonical trees of depth ≤ l
+    bool m_fits = true;                               ///< All counts fit SN_t
+
+    /// @brief Number of canonical unary trees of depth level per unary atom
+    [[nodiscard]] SN_t Unary(std::size_t level) const
+    {
+        return (level == 1) ? SN_t(m_leaves - m_const_leaves) : m_exact[level - 1];
+    }
+
+    [[nodiscard]] bool Symmetric(std::size_t num) const
+    {
+        return (SKIP_SYMMETRIC and m_atoms->arg2[num]->Commutative());
+    }
+
+    /**
+     * @brief Count canonical operand pairs whose right operand ranks below a given one
+     * @param level Depth of the binary tree
+     * @param num Index of the binary atom
+     * @param right Rank of the right operand among trees of depth exactly level-1
+     * @param pairs Number of pairs
+     * @return true if the count fits SN_t, false on overflow
+     *
+     * Sums allowed left operands over all right operands q < right:
+     * - level 1: left and right are leaves, and two constant leaves are
+     *   not allowed together;
+     * - level > 1: any canonical left tree of smaller depth, plus, for
+     *   symmetric atoms, only same-depth left trees ranked below q (or
+     *   up to q for non-idempotent atoms).
+     */
+    bool PairsBefore(std::size_t level, std::size_t num, const SN_t& right, SN_t& pairs) const
+    {
+        const bool symmetric = Symmetric(num);
+        const bool diagonal = (not symmetric) or (not m_atoms->arg2[num]->Idempotent());
+
+        if (level == 1) {
+            const SN_t leaves(m_leaves);
+            const SN_t var_leaves(m_leaves - m_const_leaves);
+            const SN_t var_rights = (right < var_leaves) ? right : var_leaves;
+            const SN_t const_rights = right - var_rights;
+            if (not symmetric) {
+                // Variable rights take any left, constant rights only variable lefts.
+                return (CheckedMul(var_rights, leaves, pairs) and
+                        CheckedAdd(pairs, const_rights * var_leaves, pairs));
+            }
+            // Variable right q takes lefts below q (or up to q), constant rights only variable lefts.
+            // Iterate() also visits the starting pair (leaf 0; leaf 0) of idempotent atoms.
+            if (not Triangle(var_rights, diagonal, pairs)) {
+                return false;
+            }
+            if ((not diagonal) and (var_rights > SN_t{})) {
+                pairs += 1U;
+            }
+            return CheckedAdd(pairs, const_rights * var_leaves, pairs);
+        }
+
+        const SN_t smaller = m_total[level - 2];
+        if (not symmetric) {
+            return CheckedMul(right, m_total[level - 1], pairs);
+        }
+        SN_t triangle{};
+        return (CheckedMul(right, smaller, pairs) and Triangle(right, diagonal, triangle) and
+                CheckedAdd(pairs, triangle, pairs));
+    }
+
+    /**
+     * @brief Sum of q (or q + 1 with diagonal) over q < n
+     * @return true if the sum fits SN_t, false on overflow
+     */
+    static bool Triangle(const SN_t& n, bool diagonal, SN_t& res)
+    {
+        if (n == SN_t{}) {
+            res = {};
+            return true;
+        }
+        // n(n-1)/2 or n(n+1)/2, halving the even factor first
+        const SN_t other = diagonal ? (n + 1U) : (n - 1U);
+        const SN_t two(2);
+        if (n % two == SN_t{}) {
+            return CheckedMul(n / two, other, res);
+        }
+        return CheckedMul(n, other / two, res);
+    }
+};
+
+/// @} // end of FunctionNodes group
+
+}  // namespace fw
@@ -3,6 +3,7 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <format>
@@ -21,6 +22,9 @@ namespace fw
 /// @brief Distance type for comparing function outputs
 using Distance = std::size_t;
 
+/// @brief Integer weight of a target sample
+using Weight = uint32_t;
+
 /// @brief Type for serial numbers of function trees (supports very large numbers)
 using SerialNumber_t = __int128;
 
@@ -32,6 +36,13 @@ struct SerialNumberHash
         uint64_t high = static_cast<uint64_t>(x >> 64);
         return std::hash<uint64_t>{}(low) ^ (std::hash<uint64_t>{}(high) << 1);
     }
+
+    /// @brief Hash of other serial number types (e.g. BigSerialNumber)
+    template <typename SN_t>
+    std::size_t operator()(const SN_t& x) const
+    {
+        return std::hash<SN_t>{}(x);
+    }
 };
 
 struct SerialNumberEqual
@@ -39,6 +50,81 @@ struct SerialNumberEqual
     bool operator()(__int128 a, __int128 b) const { return a == b; }
 };
 
+/// @brief Mix bits of a 64-bit value (SplitMix64 finalizer)
+constexpr std::size_t HashMix(std::size_t x)
+{
+    x ^= x >> 30U;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27U;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31U;
+    return x;
+}
+
+/**
+ * @brief Structural hash of a tree node from its atom and child hashes
+ * @param arity Arity of the atom
+ * @param num Index of the atom
+ * @param arg1 Hash of the first child (arity >= 1)
+ * @param arg2 Hash of the second child (arity = 2)
+ *
+ * Equal trees have equal hashes; operand order matters.
+ */
+constexpr std::size_t StructuralHash(std::size_t arity, std::size_t num, std::size_t arg1 = 0, std::size_t arg2 = 0)
+{
+    std::size_t hash = HashMix((arity << 32U) ^ num);
+    if (arity >= 1) {
+        hash = HashMix(hash ^ arg1);
+    }
+    if (arity == 2) {
+        hash = HashMix(hash + (arg2 * 3U));
+    }
+    return hash;
+}
+
+/**
+ * @class SmallSet
+ * @brief Set of values with inline storage for the first N elements
+ * @tparam T Element type (equality comparable)
+ * @tparam N Inline capacity
+ *
+ * Lookup is linear, which beats hashing for a few dozen elements. Only
+ * sets beyond N elements allocate.
+ */
+template <typename T, std::size_t N>
+class SmallSet
+{
+   public:
+    /**
+     * @brief Insert a value
+     * @return true if inserted, false if already present
+     */
+    bool Insert(const T& value)
+    {
+        const auto inline_end = m_inline.begin() + static_cast<std::ptrdiff_t>(std::min(m_size, N));
+        if ((std::find(m_inline.begin(), inline_end, value) != inline_end) or
+            (std::find(m_spill.begin(), m_spill.end(), value) != m_spill.end())) {
+            return false;
+        }
+        if (m_size < N) {
+            m_inline[m_size] = value;
+        }
+        else {
+            m_spill.push_back(value);
+        }
+        ++m_size;
+        return true;
+    }
+
+    /// @brief Number of elements
+    [[nodiscard]] std::size_t Size() const { return m_size; }
+
+   private:
+    std::array<T, N> m_inline{};  ///< First N elements
+    std::vector<T> m_spill;       ///< Elements beyond N
+    std::size_t m_size = 0;       ///< Number of elements
+};
+
 template <class T>
 std::string format_with_si_prefix(T value)
 {
@@ -185,6 +271,90 @@ class RangeSet
     std::set<std::pair<Tnum, Tnum>> m_ranges;
 };
 
+/**
+ * @class MatchMask
+ * @brief Bit mask of sample positions where a candidate matches the target
+ * 
+ * Filled tile by tile during streaming evaluation; one bit per sample.
+ */
+class MatchMask
+{
+   public:
+    /**
+     * @brief Resize mask and clear all bits
+     * @param size Number of samples
+     */
+    void Reset(std::size_t size)
+    {
+        m_size = size;
+        m_words.assign((size + WORD_BITS - 1) / WORD_BITS, 0);
+    }
+
+    /// @brief Mark sample as matching
+    void Set(std::size_t pos) { m_words[pos / WORD_BITS] |= (uint64_t{1} << (pos % WORD_BITS)); }
+
+    /**
+     * @brief Mark a run of samples as matching from packed bits
+     * @param pos Position of the first sample
+     * @param bits Match bits, bit j stands for sample pos + j
+     * @param count Number of valid bits (at most 64)
+     */
+    void Merge(std::size_t pos, uint64_t bits, std::size_t count)
+    {
+        if (count < WORD_BITS) {
+            bits &= (uint64_t{1} << count) - 1;
+        }
+        const auto word = pos / WORD_BITS;
+        const auto shift = pos % WORD_BITS;
+        m_words[word] |= bits << shift;
+        if ((shift != 0) and (shift + count > WORD_BITS)) {
+            m_words[word + 1] |= bits >> (WORD_BITS - shift);
+        }
+    }
+
+    /// @brief Check if sample is marked as matching
+    [[nodiscard]] bool Test(std::size_t pos) const
+    {
+        return ((m_words[pos / WORD_BITS] >> (pos % WORD_BITS)) & 1U) != 0;
+    }
+
+    /// @brief Number of samples covered by the mask
+    [[nodiscard]] std::size_t Size() const { return m_size; }
+
+    /**
+     * @brief Convert to range representation
+     * @return RangeSet of matching sample positions
+     */
+    [[nodiscard]] RangeSet<std::size_t> ToRangeSet() const
+    {
+        RangeSet<std::size_t> rset;
+        std::size_t pos = 0;
+        while (pos < m_size) {
+            if (m_words[pos / WORD_BITS] == 0) {
+                pos = (pos / WORD_BITS + 1) * WORD_BITS;
+                continue;
+            }
+            if (not Test(pos)) {
+                ++pos;
+                continue;
+            }
+            auto end = pos;
+            while ((end + 1 < m_size) and Test(end + 1)) {
+                ++end;
+            }
+            rset.AddRange(pos, end);
+            pos = end + 1;
+        }
+        return rset;
+    }
+
+   private:
+    static constexpr std::size_t WORD_BITS = 64;
+
+    std::size_t m_size = 0;         ///< Number of samples
+    std::vector<uint64_t> m_words;  ///< Packed match bits
+};
+
 /// @} // end of Common group
 
 }  // namespace fw
\ No newline at end of file
@@ -0,0 +1,508 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+#include "func_node.h"
+#include "node_store.h"
+
+namespace fw
+{
+
+/// @addtogroup FunctionNodes
+/// @{
+
+/**
+ * @struct DagStep
+ * @brief One step of a DAG program: an atom applied to earlier results
+ *
+ * Operand codes below the number of leaves select a leaf (nullary atom),
+ * code leaves + k references the result of step k.
+ */
+struct DagStep
+{
+    /// @brief Equality comparison operator
+    bool operator==(const DagStep& other) const
+    {
+        return ((atom == other.atom) and (arg1 == other.arg1) and (arg2 == other.arg2));
+    }
+
+    AtomIndex atom;        ///< Unary or binary atom
+    std::size_t arg1 = 0;  ///< First operand code
+    std::size_t arg2 = 0;  ///< Second operand code (for arity = 2)
+};
+
+/**
+ * @class DagProgram
+ * @brief Function as a DAG of shared subexpressions (let-bindings)
+ * @tparam FuncValue_t Type of function values
+ * @tparam SKIP_CONSTANT Whether to skip constant expressions
+ * @tparam SKIP_SYMMETRIC Whether to skip symmetric duplicates for commutative ops
+ *
+ * A straight-line program: every step applies a unary or binary atom to
+ * leaves or to results of earlier steps, the last step is the result.
+ * A subexpression used several times is a single step computed once, so
+ * a program of n steps may equal a tree of depth n with exponentially
+ * many nodes.
+ *
+ * Iterate() enumerates programs by number of steps, starting with the
+ * leaves (programs of no steps), then like an odometer with the last step
+ * changing fastest, so values of earlier steps stay cached. Programs that
+ * are not canonical are skipped:
+ * - a step other than the last is unused (dead code);
+ * - two steps are equal (the second is a redundant copy);
+ * - operands of a commutative atom are out of order (SKIP_SYMMETRIC);
+ * - a step has only constant leaves or constant values (SKIP_CONSTANT),
+ *   or the program is a constant leaf.
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false>
+class DagProgram
+{
+   public:
+    /// Vector type for function values
+    using FuncValues_t = std::vector<FuncValue_t>;
+
+    /**
+     * @brief Construct empty program (leaf 0), before the first Iterate()
+     * @param atoms Pointer to atomic function library
+     */
+    explicit DagProgram(const AtomFuncs<FuncValue_t>* atoms) : m_atoms(atoms) {}
+
+    /// @brief Equality comparison operator
+    bool operator==(const DagProgram& other) const
+    {
+        return ((m_steps == other.m_steps) and (m_leaf == other.m_leaf) and (m_started == other.m_started));
+    }
+
+    /// @brief Get number of steps
+    [[nodiscard]] std::size_t Steps() const { return m_steps.size(); }
+
+    /**
+     * @brief Advance to next canonical program
+     * @param max_steps Maximum number of steps
+     * @return true if next program exists, false if enumeration complete
+     */
+    bool Iterate(std::size_t max_steps)
+    {
+        while (IterateRaw(max_steps)) {
+            if (Canonical()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Calculate function values for all inputs
+     * @return Values of the last step
+     *
+     * Steps are evaluated once each; steps before the last change keep
+     * their values from the previous program.
+     */
+    const FuncValues_t& Calculate()
+    {
+        if (m_steps.empty()) {
+            return m_atoms->arg0[m_leaf]->Calculate();
+        }
+        m_values.resize(m_steps.size());
+        for (; m_valid < m_steps.size(); ++m_valid) {
+            const auto& step = m_steps[m_valid];
+            if (step.atom.arity == 1) {
+                m_values[m_valid] = m_atoms->arg1[step.atom.num]->Calculate(Operand(step.arg1));
+            }
+            else {
+                m_values[m_valid] = m_atoms->arg2[step.atom.num]->Calculate(Operand(step.arg1), Operand(step.arg2));
+            }
+        }
+        return m_values.back();
+    }
+
+    /**
+     * @brief Get string representation
+     * @return Expression in FuncNode::Repr() format; shared steps are bound
+     *         first, e.g. "t0=NOT(X); SUM(t0;AND(t0;1))"
+     */
+    [[nodiscard]] std::string Repr() const
+    {
+        if (m_steps.empty()) {
+            return m_atoms->arg0[m_leaf]->Str();
+        }
+        const auto uses = Uses();
+        std::string res;
+        for (std::size_t i = 0; i + 1 < m_steps.size(); ++i) {
+            if (uses[i] > 1) {
+                res += std::format("t{}={}; ", i, StepRepr(i, uses));
+            }
+        }
+        return res + StepRepr(m_steps.size() - 1, uses);
+    }
+
+    /**
+     * @brief Expand program into an equivalent tree
+     * @param fnc Tree rebuilt in place; unchanged subtrees keep cached values
+     *
+     * The tree may be exponentially larger than the program, prefer Intern().
+     */
+    template <typename FN_t>
+    void ToTree(FN_t& fnc) const
+    {
+        if (m_steps.empty()) {
+            fnc.SetAtom(AtomIndex{0, m_leaf});
+            return;
+        }
+        Expand(fnc, m_atoms->arg0.size() + m_steps.size() - 1);
+    }
+
+    /**
+     * @brief Intern program as a hash-consed tree without expanding it
+     * @param store Store the tree is interned in
+     * @return Shared root; every step is one shared node
+     */
+    NodeRef Intern(NodeStore& store) const
+    {
+        const auto leaves = m_atoms->arg0.size();
+        const auto operand = [&](std::size_t code, const std::vector<NodeRef>& steps) {
+            return (code < leaves) ? store.Make(AtomIndex{0, code}, nullptr, nullptr) : steps[code - leaves];
+        };
+        if (m_steps.empty()) {
+            return operand(m_leaf, {});
+        }
+        std::vector<NodeRef> nodes;
+        nodes.reserve(m_steps.size());
+        for (const auto& step : m_steps) {
+            auto arg2 = (step.atom.arity == 2) ? operand(step.arg2, nodes) : nullptr;
+            nodes.push_back(store.Make(step.atom, operand(step.arg1, nodes), std::move(arg2)));
+        }
+        return nodes.back();
+    }
+
+    /**
+     * @brief Estimate position in enumeration order
+     * @param max_steps Maximum number of steps
+     * @return Fraction of programs (canonical or not) enumerated before this one
+     */
+    [[nodiscard]] long double Progress(std::size_t max_steps) const
+    {
+        long double before = 0;
+        long double total = 0;
+        long double count = 1;
+        for (std::size_t n = 0; n < max_steps; ++n) {
+            count *= static_cast<long double>(Choices(n));
+            total += count;
+            if (n + 1 < m_steps.size()) {
+                before += count;
+            }
+        }
+        long double rank = 0;
+        for (std::size_t i = 0; i < m_steps.size(); ++i) {
+            rank = (rank * static_cast<long double>(Choices(i))) + static_cast<long double>(ChoiceIndex(i));
+        }
+        return (total > 0) ? ((before + rank) / total) : 0;
+    }
+
+    /**
+     * @brief Convert program to JSON representation
+     * @return JSON object with array of steps
+     */
+    [[nodiscard]] json ToJSON() const
+    {
+        json j;
+        j["leaf"] = m_leaf;
+        j["started"] = m_started;
+        j["steps"] = json::array();
+        for (const auto& step : m_steps) {
+            json j_step;
+            j_step["arity"] = step.atom.arity;
+            j_step["num"] = step.atom.num;
+            j_step["name"] = m_atoms->Get(step.atom.arity, step.atom.num)->Str();
+            j_step["arg1"] = step.arg1;
+            if (step.atom.arity == 2) {
+                j_step["arg2"] = step.arg2;
+            }
+            j["steps"].push_back(j_step);
+        }
+        return j;
+    }
+
+    /**
+     * @brief Load program from JSON representation
+     * @param j_root JSON object with array of steps
+     * @return true if successful, false on error
+     */
+    bool FromJSON(const json& j_root)
+    {
+        m_steps.clear();
+        m_valid = 0;
+        m_leaf = 0;
+        m_started = true;
+
+        const auto j_leaf = j_root.find("leaf");
+        if (j_leaf != j_root.end()) {
+            if ((not j_leaf->is_number_unsigned()) or (j_leaf->get<std::size_t>() >= m_atoms->arg0.size())) {
+                return false;
+            }
+            m_leaf = j_leaf->get<std::size_t>();
+        }
+        const auto j_started = j_root.find("started");
+        if (j_started != j_root.end()) {
+            if (not j_started->is_boolean()) {
+                return false;
+            }
+            m_started = j_started->get<bool>();
+        }
+
+        const auto j_steps = j_root.find("steps");
+        if (j_steps == j_root.end()) {
+            return false;
+        }
+        if (not j_steps->is_array()) {
+            return false;
+        }
+        for (const auto& j_step : *j_steps) {
+            DagStep step;
+            const auto j_arity = j_step.find("arity");
+            const auto j_num = j_step.find("num");
+            const auto j_arg1 = j_step.find("arg1");
+            if ((j_arity == j_step.end()) or (j_num == j_step.end()) or (j_arg1 == j_step.end())) {
+                return false;
+            }
+            if (not(j_arity->is_number_unsigned() and j_num->is_number_unsigned() and j_arg1->is_number_unsigned())) {
+                return false;
+            }
+            step.atom.arity = j_arity->get<std::size_t>();
+            step.atom.num = j_num->get<std::size_t>();
+            step.arg1 = j_arg1->get<std::size_t>();
+            if (step.atom.arity == 2) {
+                const auto j_arg2 = j_step.find("arg2");
+                if ((j_arg2 == j_step.end()) or (not j_arg2->is_number_unsigned())) {
+                    return false;
+                }
+                step.arg2 = j_arg2->get<std::size_t>();
+            }
+
+            const auto operands = Operands(m_steps.size());
+            const auto atoms = (step.atom.arity == 1) ? m_atoms->arg1.size() : m_atoms->arg2.size();
+            if (((step.atom.arity != 1) and (step.atom.arity != 2)) or (step.atom.num >= atoms) or
+                (step.arg1 >= operands) or (step.arg2 >= operands)) {
+                return false;
+            }
+            m_steps.push_back(step);
+        }
+        return true;
+    }
+
+   private:
+    const AtomFuncs<FuncValue_t>* m_atoms = nullptr;  ///< Atomic function library
+    std::vector<DagStep> m_steps;                     ///< Steps, the last one is the result
+    std::vector<FuncValues_t> m_values;               ///< Cached values per step
+    std::size_t m_valid = 0;                          ///< Steps with valid cached values
+    std::size_t m_leaf = 0;                           ///< Leaf of a program without steps
+    bool m_started = false;                           ///< Iterate() has visited the first program
+
+    /// @brief Number of operand codes available to step i
+    [[nodiscard]] std::size_t Operands(std::size_t i) const { return m_atoms->arg0.size() + i; }
+
+    /// @brief Number of possible steps at position i
+    [[nodiscard]] std::size_t Choices(std::size_t i) const
+    {
+        const auto ops = Operands(i);
+        return (m_atoms->arg1.size() * ops) + (m_atoms->arg2.size() * ops * ops);
+    }
+
+    /// @brief Index of step i among Choices(i) in enumeration order
+    [[nodiscard]] std::size_t ChoiceIndex(std::size_t i) const
+    {
+        const auto ops = Operands(i);
+        const auto& step = m_steps[i];
+        if (step.atom.arity == 1) {
+            return (step.atom.num * ops) + step.arg1;
+        }
+        return (m_atoms->arg1.size() * ops) + (((step.atom.num * ops) + step.arg1) * ops) + step.arg2;
+    }
+
+    [[nodiscard]] const FuncValues_t& Operand(std::size_t code) const
+    {
+        const auto leaves = m_atoms->arg0.size();
+        return (code < leaves) ? m_atoms->arg0[code]->Calculate() : m_values[code - leaves];
+    }
+
+    [[nodiscard]] DagStep FirstStep() const
+    {
+        return DagStep{.atom = AtomIndex{m_atoms->arg1.empty() ? std::size_t{2} : std::size_t{1}, 0}};
+    }
+
+    /**
+     * @brief Advance step i to its next choice
+     * @return true if advanced, false if it wrapped around to the first choice
+     */
+    bool AdvanceStep(std::size_t i)
+    {
+        const auto ops = Operands(i);
+        auto& step = m_steps[i];
+        if (step.atom.arity == 2) {
+            if (++step.arg2 < ops) {
+                return true;
+            }
+            step.arg2 = 0;
+        }
+        if (++step.arg1 < ops) {
+            return true;
+        }
+        step.arg1 = 0;
+        if ((step.atom.arity == 1) and (step.atom.num + 1 < m_atoms->arg1.size())) {
+            ++step.atom.num;
+        }
+        else if ((step.atom.arity == 1) and (not m_atoms->arg2.empty())) {
+            step.atom = AtomIndex{2, 0};
+        }
+        else if ((step.atom.arity == 2) and (step.atom.num + 1 < m_atoms->arg2.size())) {
+            ++step.atom.num;
+        }
+        else {
+            step = FirstStep();
+            return false;
+        }
+        return true;
+    }
+
+    bool IterateRaw(std::size_t max_steps)
+    {
+        if (m_steps.empty()) {
+            if (not m_started) {
+                m_started = true;
+                return true;
+            }
+            if (m_leaf + 1 < m_atoms->arg0.size()) {
+                ++m_leaf;
+                return true;
+            }
+        }
+        if (m_atoms->arg1.empty() and m_atoms->arg2.empty()) {
+            return false;
+        }
+        for (std::size_t i = m_steps.size(); i > 0; --i) {
+            if (AdvanceStep(i - 1)) {
+                m_valid = std::min(m_valid, i - 1);
+                return true;
+            }
+        }
+        if (m_steps.size() >= max_steps) {
+            return false;
+        }
+        m_steps.assign(m_steps.size() + 1, FirstStep());
+        m_valid = 0;
+        m_leaf = 0;
+        return true;
+    }
+
+    /// @brief Count references to every step
+    [[nodiscard]] std::vector<std::size_t> Uses() const
+    {
+        const auto leaves = m_atoms->arg0.size();
+        std::vector<std::size_t> uses(m_steps.size());
+        for (const auto& step : m_steps) {
+            if (step.arg1 >= leaves) {
+                ++uses[step.arg1 - leaves];
+            }
+            if ((step.atom.arity == 2) and (step.arg2 >= leaves)) {
+                ++uses[step.arg2 - leaves];
+            }
+        }
+        return uses;
+    }
+
+    [[nodiscard]] bool ConstantLeaf(std::size_t code) const
+    {
+        return ((code < m_atoms->arg0.size()) and m_atoms->arg0[code]->Constant());
+    }
+
+    bool Canonical()
+    {
+        if (m_steps.empty()) {
+            return not(SKIP_CONSTANT and ConstantLeaf(m_leaf));
+        }
+        const auto uses = Uses();
+        for (std::size_t i = 0; i + 1 < m_steps.size(); ++i) {
+            if (uses[i] == 0) {
+                return false;
+            }
+        }
+        for (std::size_t i = 0; i < m_steps.size(); ++i) {
+            const auto& step = m_steps[i];
+            if (std::find(m_steps.begin(), m_steps.begin() + static_cast<std::ptrdiff_t>(i), step) !=
+                m_steps.begin() + static_cast<std::ptrdiff_t>(i)) {
+                return false;
+            }
+            if (SKIP_SYMMETRIC and (step.atom.arity == 2) and m_atoms->arg2[step.atom.num]->Commutative()) {
+                if (m_atoms->arg2[step.atom.num]->Idempotent() ? (step.arg1 >= step.arg2)
+                                                                : (step.arg1 > step.arg2)) {
+                    return false;
+                }
+            }
+            if (SKIP_CONSTANT and ConstantLeaf(step.arg1) and ((step.atom.arity == 1) or ConstantLeaf(step.arg2))) {
+                return false;
+            }
+        }
+        if (SKIP_CONSTANT) {
+            Calculate();
+            for (const auto& values : m_values) {
+                if (std::ranges::adjacent_find(values, std::ranges::not_equal_to{}) == values.end()) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::string OperandRepr(std::size_t code, const std::vector<std::size_t>& uses) const
+    {
+        const auto leaves = m_atoms->arg0.size();
+        if (code < leaves) {
+            return m_atoms->arg0[code]->Str();
+        }
+        return (uses[code - leaves] > 1) ? std::format("t{}", code - leaves) : StepRepr(code - leaves, uses);
+    }
+
+    [[nodiscard]] std::string StepRepr(std::size_t i, const std::vector<std::size_t>& uses) const
+    {
+        const auto& step = m_steps[i];
+        if (step.atom.arity == 1) {
+            return std::format("{}({})", m_atoms->arg1[step.atom.num]->Str(), OperandRepr(step.arg1, uses));
+        }
+        return std::format("{}({};{})", m_atoms->arg2[step.atom.num]->Str(), OperandRepr(step.arg1, uses),
+                           OperandRepr(step.arg2, uses));
+    }
+
+    /**
+     * @brief Build subtree of an operand in place
+     * @return true if the subtree changed
+     */
+    template <typename FN_t>
+    bool Expand(FN_t& node, std::size_t code) const
+    {
+        const auto leaves = m_atoms->arg0.size();
+        if (code < leaves) {
+            return node.SetAtom(AtomIndex{0, code});
+        }
+        const auto& step = m_steps[code - leaves];
+        bool changed = node.SetAtom(step.atom);
+        changed = Expand(node.Arg1(), step.arg1) or changed;
+        if (step.atom.arity == 2) {
+            changed = Expand(node.Arg2(), step.arg2) or changed;
+        }
+        if (changed) {
+            node.ClearCalculated();
+        }
+        return changed;
+    }
+};
+
+/// @} // end of FunctionNodes group
+
+}  // namespace fw
@@ -1,14 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <format>
 #include <memory>
+#include <span>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
 #include "atom.h"
+#include "serial_number.h"
+#include "value_pool.h"
 
 namespace fw
 {
@@ -72,7 +77,7 @@ class AtomFuncs
      * @param num Index in the arity vector
      * @return Pointer to atomic function, or nullptr if invalid
      */
-    AtomFuncBase* Get(std::size_t arity, std::size_t num)
+    AtomFuncBase* Get(std::size_t arity, std::size_t num) const
     {
         switch (arity) {
             case 0:
@@ -98,6 +103,7 @@ class AtomFuncs
  * @tparam FuncValue_t Type of function values
  * @tparam SKIP_CONSTANT Whether to skip constant sub-expressions during iteration
  * @tparam SKIP_SYMMETRIC Whether to skip symmetric duplicates for commutative operations
+ * @tparam SN_t Serial number type: SerialNumber_t, or BigSerialNumber when the space does not fit
  * 
  * This class implements a tree structure where each node is either:
  * - A leaf: nullary function (constant or variable)
@@ -105,8 +111,16 @@ class AtomFuncs
  * - A binary node: function applied to two children
  * 
  * The tree can be evaluated, serialized, and iterated over.
+ *
+ * Values are not owned by the nodes: the nodes of a tree share one
+ * NodePool, created by the first Calculate() of the root, and a
+ * calculated node holds only the index of its slot there (leaves read
+ * their atom's values in place). A tree is evaluated within one small,
+ * cache-line-aligned allocation instead of a heap vector per node.
+ * Copies of a tree start without values and use a pool of their own.
  */
-template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false>
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false,
+          typename SN_t = SerialNumber_t>
 class FuncNode
 {
    public:
@@ -114,6 +128,8 @@ class FuncNode
     using FuncValues_t = std::vector<FuncValue_t>;
     /// Type alias for atomic function container
     using AtomFuncs_t = AtomFuncs<FuncValue_t>;
+    /// Type alias for the value slots of a tree
+    using Pool_t = NodePool<FuncValue_t>;
 
     /**
      * @brief Construct a FuncNode with reference to atomic functions
@@ -121,7 +137,10 @@ class FuncNode
      */
     explicit FuncNode(AtomFuncs_t* atoms) : m_atoms(atoms) {}
 
-    /// @brief Copy constructor (deep copy)
+    /// @brief Return the value slot to the pool of the tree
+    ~FuncNode() { ReleaseSlot(); }
+
+    /// @brief Copy constructor (deep copy, without values)
     FuncNode(const FuncNode& other) : m_atoms(other.m_atoms), m_atom_index(other.m_atom_index)
     {
         // Deep copy children based on arity
@@ -143,8 +162,14 @@ class FuncNode
         }
     }
 
-    /// @brief Move constructor
-    FuncNode(FuncNode&& other) noexcept : m_atoms(other.m_atoms), m_atom_index(other.m_atom_index)
+    /// @brief Move constructor (values move along)
+    FuncNode(FuncNode&& other) noexcept
+        : m_atoms(other.m_atoms),
+          m_atom_index(other.m_atom_index),
+          m_pool(std::move(other.m_pool)),
+          m_slot(std::exchange(other.m_slot, Pool_t::NONE)),
+          m_calculated(std::exchange(other.m_calculated, false)),
+          m_ch(other.m_ch)
     {
         switch (Arity()) {
             case 0:
@@ -170,6 +195,7 @@ class FuncNode
         if (this != &other) {
             m_atoms = other.m_atoms;
             m_atom_index = other.m_atom_index;
+            ClearCalculated();
 
             // Reconstruct children based on arity
             switch (Arity()) {
@@ -241,7 +267,101 @@ class FuncNode
     /// @brief Get arity of this node (0, 1, or 2)
     [[nodiscard]] std::size_t Arity() const { return m_atom_index.arity; }
 
-    void UniqFunctionsSerialNumbers(std::unordered_set<SerialNumber_t, SerialNumberHash>& uniqs) const
+    /// @brief Get index of this node's atomic function
+    [[nodiscard]] const AtomIndex& Atom() const { return m_atom_index; }
+
+    /// @brief Get first child (for arity >= 1)
+    [[nodiscard]] const FuncNode& Arg1() const { return *m_arg1; }
+
+    /// @brief Get second child (for arity = 2)
+    [[nodiscard]] const FuncNode& Arg2() const { return *m_arg2; }
+
+    /// @brief Get first child for in-place rebuilding (for arity >= 1)
+    [[nodiscard]] FuncNode& Arg1() { return *m_arg1; }
+
+    /// @brief Get second child for in-place rebuilding (for arity = 2)
+    [[nodiscard]] FuncNode& Arg2() { return *m_arg2; }
+
+    /**
+     * @brief Replace atomic function of this node
+     * @param atom New atom index
+     * @return true if the atom changed, false if it was already set
+     * 
+     * Children are kept while the arity allows it, so an enumerator
+     * can rebuild a tree in place and keep cached values of unchanged
+     * subtrees. Missing children are created as leaf 0.
+     */
+    bool SetAtom(const AtomIndex& atom)
+    {
+        if (m_atom_index == atom) {
+            return false;
+        }
+        if (atom.arity < 2) {
+            m_arg2 = nullptr;
+        }
+        else if (m_arg2 == nullptr) {
+            m_arg2 = MakeChild();
+        }
+        if (atom.arity < 1) {
+            m_arg1 = nullptr;
+        }
+        else if (m_arg1 == nullptr) {
+            m_arg1 = MakeChild();
+        }
+        m_atom_index = atom;
+        ClearCalculated();
+        return true;
+    }
+
+    /// @brief Get total cost of the tree (sum of atom costs, node count by default)
+    [[nodiscard]] std::size_t Cost() const
+    {
+        switch (Arity()) {
+            case 0:
+                return m_atoms->arg0[m_atom_index.num]->Cost();
+            case 1:
+                return (m_atoms->arg1[m_atom_index.num]->Cost() + m_arg1->Cost());
+            case 2:
+                return (m_atoms->arg2[m_atom_index.num]->Cost() + m_arg1->Cost() + m_arg2->Cost());
+            default:
+                return 0;
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Structural hash of the tree, computed bottom-up
+     * @return Hash equal for equal trees, see fw::StructuralHash()
+     */
+    [[nodiscard]] std::size_t StructuralHash() const
+    {
+        switch (Arity()) {
+            case 1:
+                return fw::StructuralHash(1, m_atom_index.num, m_arg1->StructuralHash());
+            case 2:
+                return fw::StructuralHash(2, m_atom_index.num, m_arg1->StructuralHash(), m_arg2->StructuralHash());
+            default:
+                return fw::StructuralHash(0, m_atom_index.num);
+        }
+    }
+
+    /**
+     * @brief Count distinct function (non-leaf) subtrees
+     * @return Number of distinct structural hashes of function nodes
+     *
+     * One bottom-up pass, each hash computed once from the child hashes
+     * and kept in an inline set: trees up to depth 5 (31 function nodes)
+     * do not allocate. Unlike UniqFunctionsSerialNumbers() it works for
+     * trees of any depth and shape, e.g. from size order or DAG programs.
+     */
+    [[nodiscard]] std::size_t UniqueFunctions() const
+    {
+        SmallSet<std::size_t, UNIQUE_INLINE> hashes;
+        CollectHashes(hashes);
+        return hashes.Size();
+    }
+
+    void UniqFunctionsSerialNumbers(std::unordered_set<SN_t, SerialNumberHash>& uniqs) const
     {
         switch (Arity()) {
             case 0:
@@ -342,29 +462,57 @@ class FuncNode
  * @param level Maximum depth of trees (non‑negative integer).
  * @return Total number of trees with depth ≤ level.
  */
-    [[nodiscard]] SerialNumber_t MaxSerialNumber(std::size_t level) const
+    [[nodiscard]] SN_t MaxSerialNumber(std::size_t level) const
     {
-        // Base case: only leaves (arity 0) have depth 0.
-        if (level == 0) {
-            return m_atoms->arg0.size();
-        }
-
-        // Number of trees with depth ≤ level-1.
-        const auto max_prev = MaxSerialNumber(level - 1);
+        SN_t max_sn{};
+        [[maybe_unused]] const bool fits = MaxSerialNumber(level, max_sn);
+        assert(fits);
+        return max_sn;
+    }
 
-        // Number of trees with depth exactly level-1.
-        // For level = 1, trees of depth exactly 0 are just the leaves,
-        // and M(-1) is defined as 0.
-        const auto max_prev_lvl = (level > 1) ? max_prev - MaxSerialNumber(level - 2) : max_prev;
+    /**
+     * @brief Overflow-checked number of distinct trees with depth up to given level
+     * @param level Maximum depth of trees
+     * @param max_sn Number of trees, valid only on success
+     * @return true if the count fits SN_t, false on overflow
+     *
+     * Computes the recurrence above bottom-up, checking every addition and
+     * multiplication.
+     */
+    bool MaxSerialNumber(std::size_t level, SN_t& max_sn) const
+    {
+        // Base case: only leaves (arity 0) have depth 0, and M(-1) = 0.
+        SN_t max_prev2{};
+        SN_t max_prev = m_atoms->arg0.size();
+        for (std::size_t l = 1; l <= level; ++l) {
+            // Number of trees with depth exactly l-1.
+            const SN_t max_prev_lvl = max_prev - max_prev2;
+
+            SN_t binary;
+            SN_t unary;
+            SN_t m;
+            if (not(CheckedMul(max_prev, max_prev_lvl, binary) and
+                    CheckedMul(binary, SN_t(m_atoms->arg2.size()), binary) and
+                    CheckedMul(max_prev_lvl, SN_t(m_atoms->arg1.size()), unary) and CheckedAdd(binary, unary, m) and
+                    CheckedAdd(m, max_prev, m))) {
+                return false;
+            }
+            max_prev2 = max_prev;
+            max_prev = m;
+        }
+        max_sn = max_prev;
+        return true;
+    }
 
-        // Total for depth ≤ level:
-        //   old ones (max_prev)
-        // + new unary trees of depth level
-        // + new binary trees of depth level
-        const auto m = (max_prev * max_prev_lvl * m_atoms->arg2.size())  // binary trees
-                       + (max_prev_lvl * m_atoms->arg1.size())           // unary trees
-                       + max_prev;                                       // trees of smaller depth
-        return m;
+    /**
+     * @brief Check if serial numbers of trees up to given depth fit SN_t
+     * @param level Maximum depth of trees
+     * @return true if no serial number arithmetic overflows, false otherwise
+     */
+    [[nodiscard]] bool SerialNumberFits(std::size_t level) const
+    {
+        SN_t max_sn{};
+        return MaxSerialNumber(level, max_sn);
     }
 
     /**
@@ -421,8 +569,11 @@ class FuncNode
  *   subtree (any depth ≤ \(l-1\)).
  *
  * @return Serial number uniquely identifying this tree.
+ *
+ * The tree depth must satisfy SerialNumberFits(), use the checked overload
+ * or CompareSerial() for trees of any depth.
  */
-    [[nodiscard]] SerialNumber_t SerialNumber() const
+    [[nodiscard]] SN_t SerialNumber() const
     {
         // Leaf case: depth 0, number is simply the atom's index.
         if (Arity() == 0) {
@@ -436,19 +587,19 @@ class FuncNode
         const auto max_prev = MaxSerialNumber(level - 1);
 
         // Total count of trees with depth ≤ level-2 (used for normalization).
-        const auto max_prev2 = (level > 1) ? MaxSerialNumber(level - 2) : 0;
+        const SN_t max_prev2 = (level > 1) ? MaxSerialNumber(level - 2) : SN_t{};
 
         // Number of trees with depth exactly level-1.
-        const auto max_prev_lvl = max_prev - max_prev2;
+        const SN_t max_prev_lvl = max_prev - max_prev2;
 
         // Start with the offset of all smaller-depth trees.
-        std::size_t snum = max_prev;
+        SN_t snum = max_prev;
 
         if (Arity() == 1) {
             // Unary tree: add contribution of the unary atom index,
             // then the normalized serial number of the subtree (which must
             // have depth exactly level-1).
-            snum += max_prev_lvl * m_atom_index.num;          // offset for this atom
+            snum += max_prev_lvl * SN_t(m_atom_index.num);    // offset for this atom
             auto snum1 = m_arg1->SerialNumber() - max_prev2;  // subtree index within depth level-1
             snum += snum1;
         }
@@ -456,94 +607,135 @@ class FuncNode
             // Binary tree: first skip all unary trees of this depth,
             // then add the contribution of the binary atom index,
             // then add the contributions of the two subtrees.
-            snum += max_prev_lvl * m_atoms->arg1.size();         // all unary trees of depth level
-            snum += max_prev * max_prev_lvl * m_atom_index.num;  // offset for this binary atom
-            auto snum1 = m_arg1->SerialNumber();                 // left subtree (any depth ≤ level-1)
-            auto snum2 = m_arg2->SerialNumber() - max_prev2;     // right subtree (depth exactly level-1)
-            snum += max_prev * snum2 + snum1;                    // combine: first by right, then by left
+            snum += max_prev_lvl * SN_t(m_atoms->arg1.size());         // all unary trees of depth level
+            snum += max_prev * max_prev_lvl * SN_t(m_atom_index.num);  // offset for this binary atom
+            auto snum1 = m_arg1->SerialNumber();                       // left subtree (any depth ≤ level-1)
+            auto snum2 = m_arg2->SerialNumber() - max_prev2;           // right subtree (depth exactly level-1)
+            snum += max_prev * snum2 + snum1;                          // combine: first by right, then by left
         }
         return snum;
     }
 
-    void FromSerialNumber(const SerialNumber_t snum)
+    /**
+     * @brief Overflow-checked serial number of this tree
+     * @param snum Serial number, valid only on success
+     * @return true if the serial number fits SN_t, false otherwise
+     */
+    bool SerialNumber(SN_t& snum) const
     {
+        if (not SerialNumberFits(CurrentMaxLevel())) {
+            return false;
+        }
+        snum = SerialNumber();
+        return true;
+    }
+
+    /**
+     * @brief Compare trees in serial number order without computing serial numbers
+     * @param other Tree over the same atoms
+     * @return Negative, zero or positive as this tree's serial number is less, equal or greater
+     *
+     * Follows the numbering of SerialNumber() structurally: by depth, then
+     * unary before binary roots, then root atom, then the right subtree and
+     * finally the left one. Works for trees of any depth, the serial numbers
+     * themselves need not fit SN_t.
+     */
+    [[nodiscard]] int CompareSerial(const FuncNode& other) const
+    {
+        const auto level = CurrentMaxLevel();
+        const auto other_level = other.CurrentMaxLevel();
+        if (level != other_level) {
+            return (level < other_level) ? -1 : 1;
+        }
+        return CompareSerialAtLevel(other);
+    }
+
+    /**
+     * @brief Rebuild tree from its serial number
+     * @param snum Serial number, see SerialNumber()
+     * @return true if successful, false if the depth holding snum overflows SN_t
+     */
+    bool FromSerialNumber(const SN_t& snum)
+    {
+        ClearCalculated();
+        m_arg1 = nullptr;
+        m_arg2 = nullptr;
         std::size_t level = 0;
 
-        auto snum_l = MaxSerialNumber(level);
+        SN_t snum_l = MaxSerialNumber(level);
         while (snum_l <= snum) {
             level += 1;
-            snum_l = MaxSerialNumber(level);
+            if (not MaxSerialNumber(level, snum_l)) {
+                return false;
+            }
         }
 
         if (level == 0) {
-            assert(snum < m_atoms->arg0.size());
+            assert(snum < SN_t(m_atoms->arg0.size()));
             m_atom_index.arity = 0;
-            m_atom_index.num = snum;
-            return;
+            m_atom_index.num = static_cast<std::size_t>(snum);
+            return true;
         }
 
-        const auto max_prev = MaxSerialNumber(level - 1);
-        const auto max_prev2 = (level > 1) ? MaxSerialNumber(level - 2) : 0;
-        const auto max_prev_lvl = max_prev - max_prev2;
-        const auto offset = snum - max_prev;
-        const auto arg1_max_snum = max_prev_lvl * m_atoms->arg1.size();
+        const SN_t max_prev = MaxSerialNumber(level - 1);
+        const SN_t max_prev2 = (level > 1) ? MaxSerialNumber(level - 2) : SN_t{};
+        const SN_t max_prev_lvl = max_prev - max_prev2;
+        const SN_t offset = snum - max_prev;
+        const SN_t arg1_max_snum = max_prev_lvl * SN_t(m_atoms->arg1.size());
         if (offset < arg1_max_snum) {
             m_atom_index.arity = 1;
-            m_atom_index.num = offset / max_prev_lvl;
-            const auto arg1_snum = (offset % max_prev_lvl) + max_prev2;
-            m_arg1 = std::make_unique<FuncNode>(m_atoms);
-            m_arg1->FromSerialNumber(arg1_snum);
-        }
-        else {
-            m_atom_index.arity = 2;
-            const auto ar2_offset = offset - max_prev_lvl * m_atoms->arg1.size();
-            const auto foo = ar2_offset / max_prev;
-            const auto arg1_sn = ar2_offset % max_prev;
-            m_atom_index.num = foo / max_prev_lvl;
-            const auto arg2_sn = foo % max_prev_lvl + max_prev2;
-            m_arg1 = std::make_unique<FuncNode>(m_atoms);
-            m_arg1->FromSerialNumber(arg1_sn);
-            m_arg2 = std::make_unique<FuncNode>(m_atoms);
-            m_arg2->FromSerialNumber(arg2_sn);
+            m_atom_index.num = static_cast<std::size_t>(offset / max_prev_lvl);
+            const SN_t arg1_snum = (offset % max_prev_lvl) + max_prev2;
+            m_arg1 = MakeChild();
+            return m_arg1->FromSerialNumber(arg1_snum);
         }
+
+        m_atom_index.arity = 2;
+        const SN_t ar2_offset = offset - arg1_max_snum;
+        const SN_t foo = ar2_offset / max_prev;
+        const SN_t arg1_sn = ar2_offset % max_prev;
+        m_atom_index.num = static_cast<std::size_t>(foo / max_prev_lvl);
+        const SN_t arg2_sn = (foo % max_prev_lvl) + max_prev2;
+        m_arg1 = MakeChild();
+        m_arg2 = MakeChild();
+        return (m_arg1->FromSerialNumber(arg1_sn) and m_arg2->FromSerialNumber(arg2_sn));
     }
 
-    /// @brief Clear cached calculation results
-    void ClearCalculated() { m_values.clear(); }
+    /// @brief Clear cached calculation results (the node keeps its slot)
+    void ClearCalculated() { m_calculated = false; }
 
     /**
      * @brief Calculate function values for all inputs
-     * @param recalculate Force recalculation even if cached
-     * @return Vector of output values
+     * @param recalculate Force recalculation of this node even if cached
+     * @return Output values, valid until a node of the tree is calculated again
      * 
      * Results are cached for subsequent calls unless recalculate is true.
      */
-    const FuncValues_t& Calculate(bool recalculate = false)
+    std::span<const FuncValue_t> Calculate(bool recalculate = false)
     {
-        if (m_values.empty() or recalculate) {
-            switch (Arity()) {
-                case 0:
-                    m_values = m_atoms->arg0[m_atom_index.num]->Calculate();
-                    break;
-                case 1:
-                    m_values = m_atoms->arg1[m_atom_index.num]->Calculate(m_arg1->Calculate());
-                    break;
-                case 2:
-                    m_values = m_atoms->arg2[m_atom_index.num]->Calculate(m_arg1->Calculate(), m_arg2->Calculate());
-                    break;
-                default:
-                    break;
-            }
-            auto result = std::ranges::minmax_element(m_values);
-            m_ch.min = *result.min;
-            m_ch.max = *result.max;
-        }
-        return m_values;
+        MakePool();
+        return Evaluate(recalculate);
+    }
+
+    /**
+     * @brief Calculate function values, evaluating unary chains by their tables
+     * @param chains Composition tables of unary chains, see UnaryChains
+     * @param recalculate Force recalculation of this node even if cached
+     * @return Output values, valid until a node of the tree is calculated again
+     *
+     * A chain of unary atoms costs one lookup per sample; its inner nodes
+     * are skipped and keep no values.
+     */
+    template <typename Chains_t>
+    std::span<const FuncValue_t> Calculate(const Chains_t& chains, bool recalculate = false)
+    {
+        MakePool();
+        return Evaluate(chains, recalculate);
     }
 
     const Characteristics<FuncValue_t>& Chars() const
     {
-        assert(not m_values.empty());
+        assert(m_calculated);
         return m_ch;
     }
 
@@ -566,6 +758,58 @@ class FuncNode
         return true;
     }
 
+    /**
+     * @brief Check if the tree is one that Iterate() skips
+     * @param check_values Also prune trees whose values are constant (calculates values)
+     * @return true if SKIP_CONSTANT or SKIP_SYMMETRIC prunes this tree or any of its subtrees
+     * 
+     * Mirrors the pruning rules of Iterate() for trees built other ways,
+     * e.g. by FromSerialNumber(). Without value checks only the structural
+     * rules apply, as counted by CanonicalCounter.
+     */
+    bool Pruned(bool check_values = true)
+    {
+        switch (Arity()) {
+            case 0:
+                return false;
+            case 1:
+                if (m_arg1->Pruned(check_values)) {
+                    return true;
+                }
+                break;
+            case 2:
+                if (m_arg1->Pruned(check_values) or m_arg2->Pruned(check_values)) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (SKIP_CONSTANT) {
+            if (Constant()) {
+                return true;
+            }
+        }
+        if (SKIP_CONSTANT and check_values) {
+            Calculate();
+            if (Chars().min == Chars().max) {
+                return true;
+            }
+        }
+
+        // Iterate() starts every binary atom at operands (leaf 0; leaf 0)
+        // without the symmetric check, so that pair is visited as well.
+        if (SKIP_SYMMETRIC and (Arity() == 2) and m_atoms->arg2[m_atom_index.num]->Commutative()) {
+            const auto cmp = m_arg1->CompareSerial(*m_arg2);
+            const bool start_pair = ((m_arg1->Arity() == 0) and (m_arg1->m_atom_index.num == 0) and (cmp == 0));
+            if (m_atoms->arg2[m_atom_index.num]->Idempotent() ? ((cmp >= 0) and not start_pair) : (cmp > 0)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      * @brief Get string representation of the expression
      * @param append Optional string to append to representation
@@ -639,7 +883,7 @@ class FuncNode
 
         // Parse children recursively
         if (Arity() > 0) {
-            m_arg1 = std::make_unique<FuncNode>(m_atoms);
+            m_arg1 = MakeChild();
             const auto j_arg1 = j_root.find("arg1");
             if (j_arg1 == j_root.end()) {
                 return false;
@@ -653,7 +897,7 @@ class FuncNode
         }
 
         if (Arity() > 1) {
-            m_arg2 = std::make_unique<FuncNode>(m_atoms);
+            m_arg2 = MakeChild();
             const auto j_arg2 = j_root.find("arg2");
             if (j_arg2 == j_root.end()) {
                 return false;
@@ -690,7 +934,7 @@ class FuncNode
         }
         else {
             // Internal node (unary function by default)
-            m_arg1 = std::make_unique<FuncNode>(m_atoms);
+            m_arg1 = MakeChild();
             m_arg1->InitDepth(max_depth, current_depth + 1);
             m_atom_index.arity = 1;
             m_atom_index.num = 0;
@@ -708,10 +952,33 @@ class FuncNode
      * Skips constant or symmetric trees based on template parameters.
      */
     bool Iterate(const std::size_t max_depth, const std::size_t current_depth = 0)
+    {
+        // Nodes created from now on share the pool of this tree.
+        MakePool();
+        const auto constant_values = [](FuncNode& fnc) {
+            fnc.Calculate(true);
+            return (fnc.Chars().min == fnc.Chars().max);
+        };
+        return Iterate(max_depth, current_depth, constant_values);
+    }
+
+    /**
+     * @brief Advance to next tree, testing nodes for constant values another way
+     * @param max_depth Maximum allowed tree depth
+     * @param current_depth Current depth in recursion
+     * @param constant_values Callable taking a FuncNode&, true if all its values are equal
+     * @return true if next tree exists, false if enumeration complete
+     *
+     * Same order as Iterate(). The test decides for SKIP_CONSTANT, e.g. a
+     * tiled evaluator stopping at the first tile with two different
+     * values, so the nodes need not keep full values.
+     */
+    template <typename Test_t>
+    bool Iterate(const std::size_t max_depth, const std::size_t current_depth, const Test_t& constant_values)
     {
         bool keep_iterate = true;
         while (keep_iterate) {
-            if (not IterateRaw(max_depth, current_depth)) {
+            if (not IterateRaw(max_depth, current_depth, constant_values)) {
                 return false;
             }
 
@@ -725,13 +992,7 @@ class FuncNode
                 keep_iterate = false;
             }
             else {
-                keep_iterate = Constant();
-                if (not keep_iterate) {
-                    Calculate(true);
-                    if (Chars().min == Chars().max) {
-                        keep_iterate = true;
-                    }
-                }
+                keep_iterate = Constant() or constant_values(*this);
             }
         }
 
@@ -752,9 +1013,10 @@ class FuncNode
         return true;
     }
 
-    bool IterateArity1(const std::size_t max_depth, const std::size_t next_depth)
+    template <typename Test_t>
+    bool IterateArity1(const std::size_t max_depth, const std::size_t next_depth, const Test_t& constant_values)
     {
-        bool arg1_iterated = m_arg1->Iterate(max_depth, next_depth);
+        bool arg1_iterated = m_arg1->Iterate(max_depth, next_depth, constant_values);
 
         if (SKIP_CONSTANT) {
             if (arg1_iterated and (m_arg1->Arity() == 0) and (m_arg1->Constant())) {
@@ -775,6 +1037,28 @@ class FuncNode
         return true;
     }
 
+    /// @brief CompareSerial() for trees of equal depth
+    [[nodiscard]] int CompareSerialAtLevel(const FuncNode& other) const
+    {
+        if (Arity() != other.Arity()) {
+            return (Arity() < other.Arity()) ? -1 : 1;
+        }
+        if (m_atom_index.num != other.m_atom_index.num) {
+            return (m_atom_index.num < other.m_atom_index.num) ? -1 : 1;
+        }
+        switch (Arity()) {
+            case 1:
+                return m_arg1->CompareSerial(*other.m_arg1);
+            case 2:
+                if (const auto cmp = m_arg2->CompareSerial(*other.m_arg2); cmp != 0) {
+                    return cmp;
+                }
+                return m_arg1->CompareSerial(*other.m_arg1);
+            default:
+                return 0;
+        }
+    }
+
     bool IterateArity2_CheckConstant(bool arg1_iterated)
     {
         if (SKIP_CONSTANT) {
@@ -791,12 +1075,12 @@ class FuncNode
         if (SKIP_SYMMETRIC) {
             if (arg1_iterated and m_atoms->arg2[m_atom_index.num]->Commutative()) {
                 if (m_atoms->arg2[m_atom_index.num]->Idempotent()) {
-                    if (m_arg1->SerialNumber() >= m_arg2->SerialNumber()) {
+                    if (m_arg1->CompareSerial(*m_arg2) >= 0) {
                         return false;
                     }
                 }
                 else {
-                    if (m_arg1->SerialNumber() > m_arg2->SerialNumber()) {
+                    if (m_arg1->CompareSerial(*m_arg2) > 0) {
                         return false;
                     }
                 }
@@ -805,15 +1089,16 @@ class FuncNode
         return true;
     }
 
-    bool IterateArity2(const std::size_t max_depth, const std::size_t next_depth)
+    template <typename Test_t>
+    bool IterateArity2(const std::size_t max_depth, const std::size_t next_depth, const Test_t& constant_values)
     {
-        bool arg1_iterated = m_arg1->Iterate(max_depth, next_depth);
+        bool arg1_iterated = m_arg1->Iterate(max_depth, next_depth, constant_values);
 
         arg1_iterated = arg1_iterated and IterateArity2_CheckConstant(arg1_iterated);
         arg1_iterated = arg1_iterated and IterateArity2_CheckSymmetric(arg1_iterated);
 
         if (not arg1_iterated) {
-            if (not m_arg2->Iterate(max_depth, next_depth)) {
+            if (not m_arg2->Iterate(max_depth, next_depth, constant_values)) {
                 if (LastArityFunc()) {
                     return false;
                 }
@@ -821,13 +1106,14 @@ class FuncNode
                 m_arg2->InitDepth(max_depth, next_depth);
             }
             else {
-                m_arg1 = std::make_unique<FuncNode>(m_atoms);
+                m_arg1 = MakeChild();
             }
         }
         return true;
     }
 
-    bool IterateRaw(const std::size_t max_depth, const std::size_t current_depth)
+    template <typename Test_t>
+    bool IterateRaw(const std::size_t max_depth, const std::size_t current_depth, const Test_t& constant_values)
     {
         bool result = false;
         const auto next_depth = current_depth + 1;
@@ -836,10 +1122,10 @@ class FuncNode
             result = IterateArity0(current_max_depth, next_depth);
         }
         else if (Arity() == 1) {
-            result = IterateArity1(current_max_depth, next_depth);
+            result = IterateArity1(current_max_depth, next_depth, constant_values);
         }
         else if (Arity() == 2) {
-            result = IterateArity2(current_max_depth, next_depth);
+            result = IterateArity2(current_max_depth, next_depth, constant_values);
         }
 
         if (not result) {
@@ -853,14 +1139,182 @@ class FuncNode
     }
 
    private:
+    static constexpr std::size_t UNIQUE_INLINE = 32;  ///< Function nodes of a full binary tree of depth 5, plus one
+
     AtomFuncs_t* m_atoms = nullptr;  ///< Reference to atomic function library
     AtomIndex m_atom_index;          ///< Index of this node's function
 
     std::unique_ptr<FuncNode> m_arg1 = nullptr;  ///< First child (for arity >= 1)
     std::unique_ptr<FuncNode> m_arg2 = nullptr;  ///< Second child (for arity = 2)
 
-    FuncValues_t m_values;
-    Characteristics<FuncValue_t> m_ch;
+    std::shared_ptr<Pool_t> m_pool;     ///< Value slots shared by the nodes of the tree
+    std::size_t m_slot = Pool_t::NONE;  ///< Slot of this node's values (NONE - not taken yet)
+    bool m_calculated = false;          ///< Values and characteristics are up to date
+    Characteristics<FuncValue_t> m_ch;  ///< Minimum and maximum of the values
+
+    /// @brief Create a child node sharing the pool of this tree
+    std::unique_ptr<FuncNode> MakeChild() const
+    {
+        auto child = std::make_unique<FuncNode>(m_atoms);
+        child->m_pool = m_pool;
+        return child;
+    }
+
+    /// @brief Create the pool of this tree, unless the node shares one
+    void MakePool()
+    {
+        if (not m_pool) {
+            m_pool = std::make_shared<Pool_t>(m_atoms->arg0.front()->Calculate().size());
+        }
+    }
+
+    void ReleaseSlot()
+    {
+        if (m_slot != Pool_t::NONE) {
+            m_pool->Release(m_slot);
+            m_slot = Pool_t::NONE;
+        }
+        m_calculated = false;
+    }
+
+    /// @brief Move a node calculated in another tree into the pool of this one
+    void Join(const std::shared_ptr<Pool_t>& pool)
+    {
+        if (m_pool != pool) {
+            ReleaseSlot();
+            m_pool = pool;
+        }
+    }
+
+    /// @brief Values of a calculated node: in place for leaves, else the node's slot
+    [[nodiscard]] std::span<const FuncValue_t> Values() const
+    {
+        if (Arity() == 0) {
+            return m_atoms->arg0[m_atom_index.num]->Calculate();
+        }
+        return m_pool->Slot(m_slot);
+    }
+
+    /// @brief Slot to calculate into; taken after the operands, as taking it may move theirs
+    std::span<FuncValue_t> Output()
+    {
+        if (m_slot == Pool_t::NONE) {
+            m_slot = m_pool->Acquire();
+        }
+        return m_pool->Slot(m_slot);
+    }
+
+    std::span<const FuncValue_t> Finish()
+    {
+        m_calculated = true;
+        if (Arity() == 0) {
+            m_ch = m_atoms->arg0[m_atom_index.num]->Chars();
+            return Values();
+        }
+        const auto values = Values();
+        const auto result = std::ranges::minmax_element(values);
+        m_ch.min = *result.min;
+        m_ch.max = *result.max;
+        return values;
+    }
+
+    std::span<const FuncValue_t> Evaluate(bool recalculate)
+    {
+        if (m_calculated and (not recalculate)) {
+            return Values();
+        }
+        switch (Arity()) {
+            case 1: {
+                m_arg1->Join(m_pool);
+                m_arg1->Evaluate(false);
+                const auto out = Output();
+                const auto& atom = *m_atoms->arg1[m_atom_index.num];
+                if (atom.Elementwise()) {
+                    atom.CalculateTile(m_arg1->Values(), out);
+                }
+                else {
+                    const auto arg = m_arg1->Values();
+                    std::ranges::copy(atom.Calculate(FuncValues_t(arg.begin(), arg.end())), out.begin());
+                }
+                break;
+            }
+            case 2: {
+                m_arg1->Join(m_pool);
+                m_arg2->Join(m_pool);
+                m_arg1->Evaluate(false);
+                m_arg2->Evaluate(false);
+                const auto out = Output();
+                const auto& atom = *m_atoms->arg2[m_atom_index.num];
+                if (atom.Elementwise()) {
+                    atom.CalculateTile(m_arg1->Values(), m_arg2->Values(), out);
+                }
+                else {
+                    const auto arg1 = m_arg1->Values();
+                    const auto arg2 = m_arg2->Values();
+                    std::ranges::copy(atom.Calculate(FuncValues_t(arg1.begin(), arg1.end()),
+                                                     FuncValues_t(arg2.begin(), arg2.end())),
+                                      out.begin());
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        return Finish();
+    }
+
+    template <typename Chains_t>
+    std::span<const FuncValue_t> Evaluate(const Chains_t& chains, bool recalculate)
+    {
+        if (m_calculated and (not recalculate)) {
+            return Values();
+        }
+        switch (Arity()) {
+            case 1: {
+                FuncNode* operand = nullptr;
+                const auto table = chains.Match(*this, operand);
+                if (table.empty()) {
+                    m_arg1->Join(m_pool);
+                    m_arg1->Evaluate(chains, false);
+                    break;
+                }
+                operand->Join(m_pool);
+                operand->Evaluate(chains, false);
+                const auto out = Output();
+                Chains_t::Apply(table, operand->Values(), out);
+                return Finish();
+            }
+            case 2:
+                m_arg1->Join(m_pool);
+                m_arg2->Join(m_pool);
+                m_arg1->Evaluate(chains, false);
+                m_arg2->Evaluate(chains, false);
+                break;
+            default:
+                break;
+        }
+        return Evaluate(true);
+    }
+
+    /// @brief Insert hashes of function subtrees into a set, return hash of this tree
+    std::size_t CollectHashes(SmallSet<std::size_t, UNIQUE_INLINE>& hashes) const
+    {
+        std::size_t hash = 0;
+        switch (Arity()) {
+            case 1:
+                hash = fw::StructuralHash(1, m_atom_index.num, m_arg1->CollectHashes(hashes));
+                break;
+            case 2: {
+                const auto arg1 = m_arg1->CollectHashes(hashes);
+                hash = fw::StructuralHash(2, m_atom_index.num, arg1, m_arg2->CollectHashes(hashes));
+                break;
+            }
+            default:
+                return fw::StructuralHash(0, m_atom_index.num);
+        }
+        hashes.Insert(hash);
+        return hash;
+    }
 
     [[nodiscard]] bool LastArityFunc() const
     {
@@ -886,7 +1340,7 @@ class FuncNode
         else {
             ++m_atom_index.num;
         }
-        m_arg1 = std::make_unique<FuncNode>(m_atoms);
+        m_arg1 = MakeChild();
         m_arg2 = nullptr;
     }
 
@@ -899,8 +1353,8 @@ class FuncNode
         else {
             ++m_atom_index.num;
         }
-        m_arg1 = std::make_unique<FuncNode>(m_atoms);
-        m_arg2 = std::make_unique<FuncNode>(m_atoms);
+        m_arg1 = MakeChild();
+        m_arg2 = MakeChild();
     }
 };
 
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#if __has_include(<generator>)
+#include <generator>
+#endif
+
+#include "dag_program.h"
+#include "func_node.h"
+#include "serial_number.h"
+#include "shape_enum.h"
+#include "size_order.h"
+
+namespace fw
+{
+
+/// @addtogroup FunctionNodes
+/// @{
+
+/**
+ * @struct Candidate
+ * @brief Lightweight view of an enumerated candidate: program plus values
+ * @tparam FuncValue_t Type of function values
+ * @tparam Program Tree (FuncNode), DagProgram or ShapeLabels
+ *
+ * Both members point into the enumerator state and stay valid until the
+ * generator is resumed; copy the program (or its Repr()) to keep it.
+ */
+template <typename FuncValue_t, typename Program>
+struct Candidate
+{
+    const Program* program = nullptr;     ///< Current program, owned by the enumerator
+    std::span<const FuncValue_t> values;  ///< Cached function values for all inputs
+
+    /// @brief Get string representation of the program
+    [[nodiscard]] std::string Repr() const { return program->Repr(); }
+};
+
+#if defined(__cpp_lib_generator)
+
+/**
+ * @brief Enumerate trees by depth, like FuncNode::Iterate()
+ * @param atoms Pointer to atomic function library
+ * @param max_depth Maximum depth of function trees
+ * @return Lazy sequence of candidates, starting with the first leaf
+ *
+ * Stages compose with ranges without intermediate copies, e.g.
+ * @code
+ * for (const auto& c : EnumerateTrees<uint16_t, true, true>(&atoms, 3) |
+ *                          std::views::filter([](const auto& c) { return c.values[0] == 0; })) {
+ *     std::println("{}", c.Repr());
+ * }
+ * @endcode
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false,
+          typename SN_t = SerialNumber_t>
+std::generator<Candidate<FuncValue_t, FuncNode<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t>>> EnumerateTrees(
+    AtomFuncs<FuncValue_t>* atoms, std::size_t max_depth)
+{
+    FuncNode<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t> fnc{atoms};
+    do {
+        co_yield Candidate<FuncValue_t, decltype(fnc)>{.program = &fnc, .values = fnc.Calculate()};
+    } while (fnc.Iterate(max_depth));
+}
+
+/**
+ * @brief Enumerate trees by cost, see SizeOrder
+ * @param atoms Pointer to atomic function library
+ * @param max_cost Maximum cost of function trees
+ * @return Lazy sequence of candidates, empty if the counts do not fit SN_t
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false,
+          typename SN_t = SerialNumber_t>
+std::generator<Candidate<FuncValue_t, FuncNode<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t>>> EnumerateBySize(
+    AtomFuncs<FuncValue_t>* atoms, std::size_t max_cost)
+{
+    const SizeOrder<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t> order{atoms, max_cost};
+    if (not order.Fits()) {
+        co_return;
+    }
+    FuncNode<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t> fnc{atoms};
+    for (bool first = true; order.Next(fnc, first); first = false) {
+        co_yield Candidate<FuncValue_t, decltype(fnc)>{.program = &fnc, .values = fnc.Calculate()};
+    }
+}
+
+/**
+ * @brief Enumerate DAG programs by number of steps, see DagProgram
+ * @param atoms Pointer to atomic function library
+ * @param max_steps Maximum number of steps
+ * @return Lazy sequence of candidates
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false>
+std::generator<Candidate<FuncValue_t, DagProgram<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC>>> EnumerateDags(
+    const AtomFuncs<FuncValue_t>* atoms, std::size_t max_steps)
+{
+    DagProgram<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC> dag{atoms};
+    while (dag.Iterate(max_steps)) {
+        co_yield Candidate<FuncValue_t, decltype(dag)>{.program = &dag, .values = dag.Calculate()};
+    }
+}
+
+/**
+ * @brief Enumerate shapes, then labels per shape, see ShapeLabels
+ * @param atoms Pointer to atomic function library
+ * @param max_depth Maximum depth of tree shapes
+ * @param gray Visit labels in Gray order
+ * @param shards Number of jobs sharing the shapes
+ * @param shard Shapes of this job: index % shards == shard
+ * @return Lazy sequence of candidates, empty if the shape count does not fit std::size_t
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false>
+std::generator<Candidate<FuncValue_t, ShapeLabels<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC>>> EnumerateShapes(
+    const AtomFuncs<FuncValue_t>* atoms, std::size_t max_depth, bool gray = false, std::size_t shards = 1,
+    std::size_t shard = 0)
+{
+    const TreeShapes shapes{max_depth};
+    if (not shapes.Fits()) {
+        co_return;
+    }
+    for (std::size_t index = shard; index < shapes.Count(); index += std::max<std::size_t>(shards, 1)) {
+        ShapeLabels<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC> labels{atoms, shapes.Unrank(index), gray};
+        while (labels.Next()) {
+            co_yield Candidate<FuncValue_t, decltype(labels)>{.program = &labels, .values = labels.Calculate()};
+        }
+    }
+}
+
+#endif  // __cpp_lib_generator
+
+/// @} // end of FunctionNodes group
+
+}  // namespace fw
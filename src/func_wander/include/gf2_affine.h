@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "atom.h"
+#include "common.h"
+
+namespace fw
+{
+
+/// @addtogroup Atoms
+/// @{
+
+/**
+ * @brief Check if a value type can be treated as a vector over GF(2)
+ *
+ * Unsigned integers up to 63 bits leave room for the constant column in
+ * a 64-bit elimination row.
+ */
+template <typename FuncValue_t>
+constexpr bool GF2Compatible = std::is_unsigned_v<FuncValue_t> and (std::numeric_limits<FuncValue_t>::digits < 64);
+
+/**
+ * @class AffineMap
+ * @brief Affine map y = A·x ⊕ c over GF(2) on the bits of a value
+ * @tparam FuncValue_t Unsigned value type
+ *
+ * Row j of A is a mask of input bits whose parity gives output bit j.
+ */
+template <typename FuncValue_t>
+class AffineMap
+{
+   public:
+    static constexpr std::size_t BITS = std::numeric_limits<FuncValue_t>::digits;
+
+    /// @brief Apply map to a value
+    [[nodiscard]] FuncValue_t Apply(FuncValue_t x) const
+    {
+        uint64_t y = m_constant;
+        for (std::size_t j = 0; j < BITS; ++j) {
+            y ^= static_cast<uint64_t>(std::popcount(m_rows[j] & x) & 1) << j;
+        }
+        return static_cast<FuncValue_t>(y);
+    }
+
+    /**
+     * @brief Emit map as an expression of XOR/AND/shift operations
+     * @param arg Representation of the argument
+     * @return Expression in Repr() format, e.g. "XOR(AND(SHL(X;1);254);1)"
+     *
+     * Input bit i feeding output bit j is a shift by j - i, so terms are
+     * grouped by shift amount and masked with the output bits they feed.
+     */
+    [[nodiscard]] std::string Repr(std::string_view arg) const
+    {
+        std::vector<std::string> terms;
+        for (int shift = -static_cast<int>(BITS) + 1; shift < static_cast<int>(BITS); ++shift) {
+            uint64_t out_mask = 0;
+            for (std::size_t j = 0; j < BITS; ++j) {
+                const auto i = static_cast<int>(j) - shift;
+                if ((i >= 0) and (i < static_cast<int>(BITS)) and (((m_rows[j] >> i) & 1U) != 0)) {
+                    out_mask |= uint64_t{1} << j;
+                }
+            }
+            if (out_mask == 0) {
+                continue;
+            }
+
+            std::string term;
+            if (shift > 0) {
+                term = std::format("SHL({};{})", arg, shift);
+            }
+            else if (shift < 0) {
+                term = std::format("SHR({};{})", arg, -shift);
+            }
+            else {
+                term = std::string(arg);
+            }
+            if (out_mask != AllBits()) {
+                term = std::format("AND({};{})", term, out_mask);
+            }
+            terms.push_back(std::move(term));
+        }
+        if (m_constant != 0) {
+            terms.push_back(std::to_string(m_constant));
+        }
+        if (terms.empty()) {
+            return "0";
+        }
+
+        auto expr = terms.back();
+        for (auto it = std::next(terms.rbegin()); it != terms.rend(); ++it) {
+            expr = std::format("XOR({};{})", *it, expr);
+        }
+        return expr;
+    }
+
+    std::array<uint64_t, BITS> m_rows{};  ///< Input bit masks per output bit
+    uint64_t m_constant = 0;              ///< Constant term c
+
+   private:
+    static constexpr uint64_t AllBits() { return (BITS == 64) ? ~uint64_t{0} : ((uint64_t{1} << BITS) - 1); }
+};
+
+/**
+ * @brief Find an affine GF(2) map from candidate values to target values
+ * @param values Candidate values (e.g. output of an enumerated subtree)
+ * @param target Target values
+ * @param positions Sample positions to fit
+ * @return Affine map if target equals A·values ⊕ c on every position
+ *
+ * Incremental Gaussian elimination: every sample is a row
+ * [bits of value | 1] with the target value bits as right-hand side, all
+ * output bits solved at once. Rows are reduced against an XOR basis keyed
+ * by leading bit, and the first inconsistent sample rejects the candidate,
+ * so the solver works as a fast filter.
+ */
+template <typename FuncValue_t>
+std::optional<AffineMap<FuncValue_t>> SolveAffine(std::span<const FuncValue_t> values,
+                                                  std::span<const FuncValue_t> target,
+                                                  std::span<const std::size_t> positions)
+{
+    static_assert(GF2Compatible<FuncValue_t>);
+    constexpr std::size_t BITS = AffineMap<FuncValue_t>::BITS;
+    constexpr std::size_t COLUMNS = BITS + 1;
+    constexpr uint64_t CONSTANT_COLUMN = uint64_t{1} << BITS;
+
+    std::array<uint64_t, COLUMNS> basis_lhs{};
+    std::array<uint64_t, COLUMNS> basis_rhs{};
+
+    for (const auto pos : positions) {
+        uint64_t lhs = static_cast<uint64_t>(values[pos]) | CONSTANT_COLUMN;
+        uint64_t rhs = static_cast<uint64_t>(target[pos]);
+        while (lhs != 0) {
+            const auto lead = static_cast<std::size_t>(std::bit_width(lhs) - 1);
+            if (basis_lhs[lead] == 0) {
+                basis_lhs[lead] = lhs;
+                basis_rhs[lead] = rhs;
+                break;
+            }
+            lhs ^= basis_lhs[lead];
+            rhs ^= basis_rhs[lead];
+        }
+        if ((lhs == 0) and (rhs != 0)) {
+            return std::nullopt;
+        }
+    }
+
+    // Reduced row echelon form: clear every pivot column from the rows above it.
+    for (std::size_t col = 0; col < COLUMNS; ++col) {
+        if (basis_lhs[col] == 0) {
+            continue;
+        }
+        for (std::size_t row = col + 1; row < COLUMNS; ++row) {
+            if (((basis_lhs[row] >> col) & 1U) != 0) {
+                basis_lhs[row] ^= basis_lhs[col];
+                basis_rhs[row] ^= basis_rhs[col];
+            }
+        }
+    }
+
+    // Free columns are set to 0, pivot columns take the right-hand side bits.
+    AffineMap<FuncValue_t> map;
+    for (std::size_t col = 0; col < COLUMNS; ++col) {
+        if (basis_lhs[col] == 0) {
+            continue;
+        }
+        if (col == BITS) {
+            map.m_constant = basis_rhs[col];
+            continue;
+        }
+        for (std::size_t j = 0; j < BITS; ++j) {
+            map.m_rows[j] |= ((basis_rhs[col] >> j) & 1U) << col;
+        }
+    }
+    return map;
+}
+
+/**
+ * @class AffineAtom
+ * @brief Unary atom applying a fixed affine GF(2) map
+ * @tparam FuncValue_t Unsigned value type
+ *
+ * Lets a whole bit-linear tail of an expression be a single atom.
+ */
+template <typename FuncValue_t>
+class AffineAtom : public AtomFunc1<FuncValue_t>
+{
+   public:
+    using typename AtomFunc1<FuncValue_t>::FuncValues_t;
+
+    explicit AffineAtom(AffineMap<FuncValue_t> map) : m_map(map) {}
+    ~AffineAtom() override = default;
+
+    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg) const override
+    {
+        FuncValues_t res(arg.size());
+        CalculateTile(arg, res);
+        return res;
+    }
+
+    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<FuncValue_t>& arg_chars) const override
+    {
+        return true;
+    }
+
+    [[nodiscard]] bool Involutive() const override { return false; }
+    [[nodiscard]] bool Argument() const override { return false; }
+    [[nodiscard]] bool Elementwise() const override { return true; }
+
+    void CalculateTile(std::span<const FuncValue_t> arg, std::span<FuncValue_t> out) const override
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = m_map.Apply(arg[i]);
+        }
+    }
+
+    [[nodiscard]] std::string Str() const override { return "GF2AFFINE"; }
+
+    /// @brief Get applied map
+    [[nodiscard]] const AffineMap<FuncValue_t>& Map() const { return m_map; }
+
+   private:
+    AffineMap<FuncValue_t> m_map;  ///< Applied map
+};
+
+/// @} // end of Atoms group
+
+}  // namespace fw
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace fw
+{
+
+/// @addtogroup Common
+/// @{
+
+/**
+ * @class HugePageRegion
+ * @brief Memory region backed by huge pages where possible (RAII)
+ *
+ * Large regions try, in order:
+ * 1. explicit huge pages (MAP_HUGETLB), which need a reserved pool;
+ * 2. a 2 MiB aligned anonymous mapping with madvise(MADV_HUGEPAGE), which
+ *    transparent huge pages may back fully, partly or not at all;
+ * 3. the heap, for small regions or when huge pages are not requested.
+ *
+ * HugeBytes() reports the bytes actually backed by huge pages, so the
+ * fallback is visible instead of silent. Counting transparent huge pages
+ * reads /proc/self/smaps; the extents of many regions are counted in one
+ * pass, see HugeBytes(std::span<const Extent>).
+ */
+class HugePageRegion
+{
+   public:
+    /// Size of a huge page on x86-64 and most aarch64 kernels
+    static constexpr std::size_t HUGE_PAGE = std::size_t{2} << 20U;
+    /// Alignment of heap regions
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    /// @brief How a region is backed
+    enum class Backing : uint8_t
+    {
+        None,         ///< No region
+        Heap,         ///< Aligned heap allocation
+        Explicit,     ///< MAP_HUGETLB mapping
+        Transparent,  ///< Anonymous mapping advised for transparent huge pages
+    };
+
+    /// @brief Address range and backing of a region, counted without the region itself
+    struct Extent
+    {
+        const void* data = nullptr;        ///< Start of the region
+        std::size_t size = 0;              ///< Size in bytes
+        Backing backing = Backing::None;   ///< How the region is backed
+    };
+
+    HugePageRegion() = default;
+
+    /**
+     * @brief Allocate region
+     * @param bytes Size in bytes
+     * @param huge_pages Try huge pages for regions of at least one huge page
+     */
+    HugePageRegion(std::size_t bytes, bool huge_pages)
+    {
+        if (huge_pages and (bytes >= HUGE_PAGE) and (MapExplicit(bytes) or MapTransparent(bytes))) {
+            return;
+        }
+        m_data = ::operator new[](std::max<std::size_t>(bytes, 1), std::align_val_t{ALIGNMENT});
+        m_size = bytes;
+        m_backing = Backing::Heap;
+    }
+
+    HugePageRegion(const HugePageRegion&) = delete;
+    HugePageRegion& operator=(const HugePageRegion&) = delete;
+
+    /// @brief Move constructor
+    HugePageRegion(HugePageRegion&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr)),
+          m_size(std::exchange(other.m_size, 0)),
+          m_mapped(std::exchange(other.m_mapped, 0)),
+          m_backing(std::exchange(other.m_backing, Backing::None))
+    {
+    }
+
+    /// @brief Move assignment operator
+    HugePageRegion& operator=(HugePageRegion&& other) noexcept
+    {
+        if (this != &other) {
+            Free();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_mapped = std::exchange(other.m_mapped, 0);
+            m_backing = std::exchange(other.m_backing, Backing::None);
+        }
+        return *this;
+    }
+
+    ~HugePageRegion() { Free(); }
+
+    /// @brief Start of the region
+    [[nodiscard]] void* Data() const { return m_data; }
+
+    /// @brief Size of the region in bytes
+    [[nodiscard]] std::size_t Size() const { return m_size; }
+
+    /// @brief How the region is backed
+    [[nodiscard]] Backing GetBacking() const { return m_backing; }
+
+    /// @brief Address range and backing of the region
+    [[nodiscard]] Extent GetExtent() const { return {m_data, m_size, m_backing}; }
+
+    /**
+     * @brief Bytes of the region backed by huge pages
+     *
+     * Transparent huge pages are counted from /proc/self/smaps, so only
+     * touched and actually collapsed pages are reported.
+     */
+    [[nodiscard]] std::size_t HugeBytes() const
+    {
+        const Extent extent = GetExtent();
+        return HugeBytes(std::span{&extent, 1});
+    }
+
+    /**
+     * @brief Bytes of several regions backed by huge pages
+     * @param extents Extents of the regions, see GetExtent()
+     *
+     * /proc/self/smaps is read once for all transparent regions. The
+     * kernel may merge neighbouring mappings, so each mapping counts its
+     * AnonHugePages at most up to the bytes of the regions inside it.
+     * Extents of freed regions are harmless, they only skew the count.
+     */
+    static std::size_t HugeBytes(std::span<const Extent> extents)
+    {
+        std::size_t bytes = 0;
+        bool transparent = false;
+        for (const auto& extent : extents) {
+            bytes += (extent.backing == Backing::Explicit) ? extent.size : 0;
+            transparent = transparent or (extent.backing == Backing::Transparent);
+        }
+        if (not transparent) {
+            return bytes;
+        }
+        std::ifstream smaps("/proc/self/smaps");
+        std::size_t inside = 0;
+        std::string line;
+        while (std::getline(smaps, line)) {
+            std::uintptr_t first = 0;
+            std::uintptr_t last = 0;
+            char dash = 0;
+            std::istringstream fields(line);
+            if ((fields >> std::hex >> first >> dash >> last) and (dash == '-')) {
+                inside = Overlap(extents, first, last);
+                continue;
+            }
+            if ((inside > 0) and line.starts_with("AnonHugePages:")) {
+                std::istringstream value(line.substr(line.find(':') + 1));
+                std::size_t kib = 0;
+                value >> kib;
+                bytes += std::min(kib * 1024, inside);
+                inside = 0;
+            }
+        }
+        return bytes;
+    }
+
+   private:
+    void* m_data = nullptr;              ///< Start of the region
+    std::size_t m_size = 0;              ///< Requested size in bytes
+    std::size_t m_mapped = 0;            ///< Mapped size in bytes
+    Backing m_backing = Backing::None;   ///< How the region is backed
+
+    static std::size_t RoundUp(std::size_t bytes) { return (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE; }
+
+    bool MapExplicit(std::size_t bytes)
+    {
+#if defined(MAP_HUGETLB)
+        const auto mapped = RoundUp(bytes);
+        void* data = ::mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        m_data = data;
+        m_size = bytes;
+        m_mapped = mapped;
+        m_backing = Backing::Explicit;
+        return true;
+#else
+        (void)bytes;
+        return false;
+#endif
+    }
+
+    bool MapTransparent(std::size_t bytes)
+    {
+#if defined(MADV_HUGEPAGE)
+        // Over-map by one huge page and trim to a huge page boundary.
+        const auto mapped = RoundUp(bytes);
+        void* raw = ::mmap(nullptr, mapped + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            return false;
+        }
+        const auto start = reinterpret_cast<std::uintptr_t>(raw);
+        const auto aligned = (start + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+        if (aligned > start) {
+            ::munmap(raw, aligned - start);
+        }
+        const auto tail = (start + mapped + HUGE_PAGE) - (aligned + mapped);
+        if (tail > 0) {
+            ::munmap(reinterpret_cast<void*>(aligned + mapped), tail);
+        }
+        m_data = reinterpret_cast<void*>(aligned);
+        ::madvise(m_data, mapped, MADV_HUGEPAGE);
+        m_size = bytes;
+        m_mapped = mapped;
+        m_backing = Backing::Transparent;
+        return true;
+#else
+        (void)bytes;
+        return false;
+#endif
+    }
+
+    void Free()
+    {
+        if (m_backing == Backing::Heap) {
+            ::operator delete[](m_data, std::align_val_t{ALIGNMENT});
+        }
+        else if (m_backing != Backing::None) {
+            ::munmap(m_data, m_mapped);
+        }
+        m_data = nullptr;
+        m_size = 0;
+        m_mapped = 0;
+        m_backing = Backing::None;
+    }
+
+    /// @brief Bytes of transparent regions within a mapping [first, last)
+    static std::size_t Overlap(std::span<const Extent> extents, std::uintptr_t first, std::uintptr_t last)
+    {
+        std::size_t bytes = 0;
+        for (const auto& extent : extents) {
+            if (extent.backing != Backing::Transparent) {
+                continue;
+            }
+            const auto start = reinterpret_cast<std::uintptr_t>(extent.data);
+            const auto lo = std::max(start, first);
+            const auto hi = std::min(start + extent.size, last);
+            bytes += (lo < hi) ? (hi - lo) : 0;
+        }
+        return bytes;
+    }
+};
+
+/// @} // end of Common group
+
+}  // namespace fw
@@ -2,7 +2,9 @@
 
 #include <atomic>
 #include <csignal>
+#include <format>
 #include <print>
+#include <string>
 
 #include "func_node.h"
 #include "interaction_http.h"
@@ -31,6 +33,10 @@ int MainLoop(const Settings& settings, AtomFuncs<TVal>& atoms, Target<TVal>& tar
     }
 
     SearchTask<Value_t, true, true> task{settings, &atoms, &target};
+    if (not task.Rejected().empty()) {
+        std::println("Settings rejected: {}", task.Rejected());
+        return EXIT_FAILURE;
+    }
 
     if (not settings.save_file.empty()) {
         const std::ifstream file(settings.save_file);
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "atom.h"
+#include "func_node.h"
+
+namespace fw
+{
+
+/// @addtogroup Atoms
+/// @{
+
+/// @brief Value type small enough to tabulate a unary function over its whole domain
+template <typename FuncValue_t>
+concept LutValue = std::unsigned_integral<FuncValue_t> and (sizeof(FuncValue_t) <= 2);
+
+/**
+ * @brief Tabulate an elementwise unary atom over the whole value domain
+ * @param atom Elementwise atom
+ * @param table Output table, one entry per value of FuncValue_t
+ *
+ * Elementwise kernels (CalculateTile()) see values only, not sample
+ * positions, so an elementwise atom is a function of the value alone.
+ */
+template <LutValue FuncValue_t>
+void Tabulate(const AtomFunc1<FuncValue_t>& atom, std::span<FuncValue_t> table)
+{
+    assert(atom.Elementwise());
+    assert(table.size() == std::size_t{std::numeric_limits<FuncValue_t>::max()} + 1);
+    std::vector<FuncValue_t> domain(table.size());
+    std::iota(domain.begin(), domain.end(), FuncValue_t{});
+    atom.CalculateTile(domain, table);
+}
+
+/**
+ * @class LutAtom1
+ * @brief Unary atom evaluated by one table lookup per sample
+ * @tparam FuncValue_t Unsigned type of at most 16 bits
+ *
+ * Wraps an elementwise atom: its values are tabulated once (at most 64K
+ * entries), and its properties and cost are taken over. Worth it for
+ * atoms whose kernel is more expensive than a gather.
+ */
+template <LutValue FuncValue_t>
+class LutAtom1 final : public AtomFunc1<FuncValue_t>
+{
+   public:
+    /// Vector type for function values
+    using FuncValues_t = std::vector<FuncValue_t>;
+
+    /**
+     * @brief Tabulate atom
+     * @param atom Elementwise atom; must outlive this one
+     */
+    explicit LutAtom1(const AtomFunc1<FuncValue_t>* atom)
+        : m_atom(atom), m_table(std::size_t{std::numeric_limits<FuncValue_t>::max()} + 1)
+    {
+        Tabulate(*m_atom, std::span<FuncValue_t>(m_table));
+        this->SetCost(m_atom->Cost());
+    }
+
+    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg) const override
+    {
+        FuncValues_t res(arg.size());
+        CalculateTile(arg, res);
+        return res;
+    }
+
+    [[nodiscard]] bool CheckChars(const Characteristics<FuncValue_t>& arg_chars) const override
+    {
+        return m_atom->CheckChars(arg_chars);
+    }
+
+    [[nodiscard]] bool Involutive() const override { return m_atom->Involutive(); }
+
+    [[nodiscard]] bool Argument() const override { return m_atom->Argument(); }
+
+    [[nodiscard]] bool Elementwise() const override { return true; }
+
+    void CalculateTile(std::span<const FuncValue_t> arg, std::span<FuncValue_t> out) const override
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = m_table[arg[i]];
+        }
+    }
+
+    [[nodiscard]] std::string Str() const override { return m_atom->Str(); }
+
+    /// @brief Value of the atom for each argument value
+    [[nodiscard]] std::span<const FuncValue_t> Table() const { return m_table; }
+
+   private:
+    const AtomFunc1<FuncValue_t>* m_atom = nullptr;  ///< Tabulated atom
+    FuncValues_t m_table;                            ///< Value per argument value
+};
+
+/**
+ * @class UnaryChains
+ * @brief Composition tables of all chains of unary atoms up to a given length
+ * @tparam FuncValue_t Type of function values
+ *
+ * A chain such as NOT(BITCOUNT(NOT(x))) maps each value through a fixed
+ * table, so it is evaluated with one gather per sample instead of one
+ * kernel pass per node. Tables of length k are composed from the atom
+ * tables and the tables of length k-1, u + u^2 + ... + u^max_length of
+ * them for u unary atoms, each with one entry per value.
+ *
+ * Only value types of at most 16 bits are tabulated, only if every unary
+ * atom is elementwise, and at most MAX_TABLES tables; otherwise the set is
+ * empty, see Available().
+ */
+template <typename FuncValue_t>
+class UnaryChains
+{
+   public:
+    /// Most tables built, 512 MiB of 16-bit values
+    static constexpr std::size_t MAX_TABLES = 4096;
+    /// Entries per table (0 - values too wide to tabulate)
+    static constexpr std::size_t TABLE_SIZE = LutValue<FuncValue_t> ? (std::size_t{1} << (8 * sizeof(FuncValue_t))) : 0;
+
+    /**
+     * @brief Build tables
+     * @param atoms Pointer to atomic function library
+     * @param max_length Longest tabulated chain (below 2 - none)
+     */
+    UnaryChains(const AtomFuncs<FuncValue_t>* atoms, std::size_t max_length)
+    {
+        if constexpr (LutValue<FuncValue_t>) {
+            const auto unary = atoms->arg1.size();
+            const auto elementwise = [](const auto* atom) { return atom->Elementwise(); };
+            if ((max_length < 2) or (unary == 0) or (not std::ranges::all_of(atoms->arg1, elementwise)) or
+                (TableCount(unary, max_length) > MAX_TABLES)) {
+                return;
+            }
+            m_domain = TABLE_SIZE;
+            m_unary = unary;
+            m_max_length = max_length;
+            // Chain with local index c * u + a is atom a applied to chain c of the previous length.
+            std::size_t count = 0;
+            for (std::size_t length = 1, chains = unary; length <= max_length; ++length, chains *= unary) {
+                m_first.push_back(count);
+                count += chains;
+            }
+            m_tables.resize(count * m_domain);
+            for (std::size_t a = 0; a < unary; ++a) {
+                Tabulate(*atoms->arg1[a], Table(a));
+            }
+            for (std::size_t length = 2; length <= max_length; ++length) {
+                const auto inner_first = m_first[length - 2];
+                for (std::size_t c = 0; c < m_first[length - 1] - inner_first; ++c) {
+                    const auto inner = Table(inner_first + c);
+                    for (std::size_t a = 0; a < unary; ++a) {
+                        const auto atom = Table(a);
+                        auto table = Table(m_first[length - 1] + (c * unary) + a);
+                        for (std::size_t x = 0; x < m_domain; ++x) {
+                            table[x] = atom[inner[x]];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Count the tables of all chains up to a length, without building them
+     * @param unary Number of unary atoms
+     * @param max_length Longest chain
+     * @return u + u^2 + ... + u^max_length, saturated above MAX_TABLES
+     */
+    [[nodiscard]] static constexpr std::size_t TableCount(std::size_t unary, std::size_t max_length)
+    {
+        std::size_t count = 0;
+        for (std::size_t length = 1, chains = unary; (length <= max_length) and (count <= MAX_TABLES); ++length) {
+            count += chains;
+            chains = std::min(chains * unary, MAX_TABLES + 1);
+        }
+        return count;
+    }
+
+    /// @brief Check if chain tables were built
+    [[nodiscard]] bool Available() const { return m_max_length > 0; }
+
+    /// @brief Longest tabulated chain (0 - none)
+    [[nodiscard]] std::size_t MaxLength() const { return m_max_length; }
+
+    /// @brief Number of tables
+    [[nodiscard]] std::size_t Count() const { return (m_domain > 0) ? (m_tables.size() / m_domain) : 0; }
+
+    /// @brief Memory of the tables in bytes
+    [[nodiscard]] std::size_t Bytes() const { return m_tables.size() * sizeof(FuncValue_t); }
+
+    /**
+     * @brief Find the table of the unary chain at the top of a tree
+     * @param fnc Unary node
+     * @param operand Set to the first node below the chain
+     * @return Table of the chain, empty if the node starts no chain of at least 2 atoms
+     *
+     * The chain is cut at the longest tabulated length; the rest is matched again below.
+     * FN_t may be const, then so is the operand.
+     */
+    template <typename FN_t>
+    [[nodiscard]] std::span<const FuncValue_t> Match(FN_t& fnc, FN_t*& operand) const
+    {
+        std::size_t local = 0;
+        std::size_t weight = 1;
+        std::size_t length = 0;
+        FN_t* node = &fnc;
+        while ((length < m_max_length) and (node->Atom().arity == 1)) {
+            local += node->Atom().num * weight;
+            weight *= m_unary;
+            ++length;
+            node = &node->Arg1();
+        }
+        if (length < 2) {
+            return {};
+        }
+        operand = node;
+        return Lookup(length, local);
+    }
+
+    /**
+     * @brief Find the table of a chain of unary atoms
+     * @param nums Atom indices, outermost first, 2 to MaxLength() of them
+     * @return Table of the chain
+     */
+    [[nodiscard]] std::span<const FuncValue_t> Find(std::span<const std::size_t> nums) const
+    {
+        assert((nums.size() >= 2) and (nums.size() <= m_max_length));
+        std::size_t local = 0;
+        std::size_t weight = 1;
+        for (const auto num : nums) {
+            local += num * weight;
+            weight *= m_unary;
+        }
+        return Lookup(nums.size(), local);
+    }
+
+    /**
+     * @brief Apply a chain table to each sample
+     * @param table Table found by Match()
+     * @param arg Values of the operand below the chain
+     * @param out Output buffer of the same size
+     */
+    static void Apply(std::span<const FuncValue_t> table, std::span<const FuncValue_t> arg,
+                      std::span<FuncValue_t> out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = table[static_cast<std::size_t>(arg[i])];
+        }
+    }
+
+   private:
+    std::size_t m_domain = 0;           ///< Entries per table
+    std::size_t m_unary = 0;            ///< Number of unary atoms
+    std::size_t m_max_length = 0;       ///< Longest tabulated chain (0 - none)
+    std::vector<std::size_t> m_first;   ///< First table of each chain length (from 1)
+    std::vector<FuncValue_t> m_tables;  ///< All tables, in order of length and local index
+
+    [[nodiscard]] std::span<FuncValue_t> Table(std::size_t index)
+    {
+        return {m_tables.data() + (index * m_domain), m_domain};
+    }
+
+    [[nodiscard]] std::span<const FuncValue_t> Lookup(std::size_t length, std::size_t local) const
+    {
+        return {m_tables.data() + ((m_first[length - 1] + local) * m_domain), m_domain};
+    }
+};
+
+/// @} // end of Atoms group
+
+}  // namespace fw
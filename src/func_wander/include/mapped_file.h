@@ -0,0 +1,226 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fw
+{
+
+/// @addtogroup Common
+/// @{
+
+/**
+ * @class MappedFile
+ * @brief Memory mapping of a whole file (RAII)
+ *
+ * Pages are loaded lazily by the OS, so opening even a very large file
+ * is instant and its contents are never copied.
+ */
+class MappedFile
+{
+   public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// @brief Move constructor
+    MappedFile(MappedFile&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0))
+    {
+    }
+
+    /// @brief Move assignment operator
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other) {
+            Close();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+        }
+        return *this;
+    }
+
+    ~MappedFile() { Close(); }
+
+    /**
+     * @brief Map file into memory
+     * @param path Path to file
+     * @return true if successful, false on error
+     */
+    bool Open(const std::string& path)
+    {
+        Close();
+
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st{};
+        if ((::fstat(fd, &st) != 0) or (st.st_size <= 0)) {
+            ::close(fd);
+            return false;
+        }
+
+        const auto size = static_cast<std::size_t>(st.st_size);
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+
+        m_data = data;
+        m_size = size;
+        return true;
+    }
+
+    /// @brief Unmap file
+    void Close()
+    {
+        if (m_data != nullptr) {
+            ::munmap(m_data, m_size);
+            m_data = nullptr;
+            m_size = 0;
+        }
+    }
+
+    /// @brief Check if a file is mapped
+    [[nodiscard]] bool IsOpen() const { return (m_data != nullptr); }
+
+    /// @brief Size of mapped file in bytes
+    [[nodiscard]] std::size_t Size() const { return m_size; }
+
+    /**
+     * @brief View file contents as an array of elements
+     * @tparam T Element type (trivially copyable)
+     * @return Span over whole elements of the file
+     */
+    template <typename T>
+    [[nodiscard]] std::span<const T> As() const
+    {
+        return {static_cast<const T*>(m_data), m_size / sizeof(T)};
+    }
+
+   private:
+    void* m_data = nullptr;  ///< Start of mapping
+    std::size_t m_size = 0;  ///< Mapping size in bytes
+};
+
+/**
+ * @class ScratchFile
+ * @brief Growing, memory-mapped scratch file for data larger than memory (RAII)
+ *
+ * The file is created on the first Append() and unlinked right away, so
+ * it disappears with the process even if it dies. It grows and is mapped
+ * in extents of a fixed size: few mappings however large it gets, and
+ * appended data stays contiguous within an extent. Its pages are written
+ * back under memory pressure instead of counting as anonymous memory, and
+ * the mappings are advised for sequential access, so streaming reads are
+ * read ahead.
+ */
+class ScratchFile
+{
+   public:
+    /**
+     * @brief Construct scratch file, created on first use
+     * @param dir Directory of the file, preferably on local disk
+     * @param extent Bytes allocated and mapped at a time
+     */
+    ScratchFile(std::string dir, std::size_t extent) : m_dir(std::move(dir)), m_extent(extent) {}
+
+    ScratchFile(const ScratchFile&) = delete;
+    ScratchFile& operator=(const ScratchFile&) = delete;
+
+    /// @brief Move constructor
+    ScratchFile(ScratchFile&& other) noexcept
+        : m_dir(std::move(other.m_dir)),
+          m_extent(other.m_extent),
+          m_fd(std::exchange(other.m_fd, -1)),
+          m_maps(std::move(other.m_maps)),
+          m_size(std::exchange(other.m_size, 0))
+    {
+    }
+
+    ScratchFile& operator=(ScratchFile&&) = delete;
+
+    ~ScratchFile()
+    {
+        for (void* data : m_maps) {
+            ::munmap(data, m_extent);
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    /**
+     * @brief Take bytes at the end of the file
+     * @param bytes Size in bytes, at most one extent
+     * @return Writable start of the bytes, nullptr on error
+     *
+     * Data never crosses an extent: the rest of a full extent is skipped.
+     */
+    void* Append(std::size_t bytes)
+    {
+        if ((bytes == 0) or (bytes > m_extent)) {
+            return nullptr;
+        }
+        if ((m_maps.empty() or (m_size + bytes > m_maps.size() * m_extent)) and (not Grow())) {
+            return nullptr;
+        }
+        m_size = std::max(m_size, (m_maps.size() - 1) * m_extent);
+        const auto offset = m_size - ((m_maps.size() - 1) * m_extent);
+        m_size += bytes;
+        return static_cast<char*>(m_maps.back()) + offset;
+    }
+
+    /// @brief Bytes allocated on disk
+    [[nodiscard]] std::size_t Bytes() const { return m_maps.size() * m_extent; }
+
+   private:
+    std::string m_dir;            ///< Directory of the file
+    std::size_t m_extent = 0;     ///< Bytes allocated and mapped at a time
+    int m_fd = -1;                ///< Unlinked file (-1 - not created yet)
+    std::vector<void*> m_maps;    ///< Mapping of each extent
+    std::size_t m_size = 0;       ///< Bytes taken
+
+    /// @brief Allocate and map one more extent
+    bool Grow()
+    {
+        if (m_fd < 0) {
+            std::string path = m_dir + "/fw_spill_XXXXXX";
+            m_fd = ::mkstemp(path.data());
+            if (m_fd < 0) {
+                return false;
+            }
+            ::unlink(path.c_str());
+        }
+        const auto offset = static_cast<off_t>(m_maps.size() * m_extent);
+        // Reserve the blocks now: writing to a sparse mapping on a full disk raises SIGBUS.
+        if (::posix_fallocate(m_fd, offset, static_cast<off_t>(m_extent)) != 0) {
+            return false;
+        }
+        void* data = ::mmap(nullptr, m_extent, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, offset);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        ::madvise(data, m_extent, MADV_SEQUENTIAL);
+        m_maps.push_back(data);
+        return true;
+    }
+};
+
+/// @} // end of Common group
+
+}  // namespace fw
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace fw
+{
+
+/// @addtogroup Common
+/// @{
+
+/**
+ * @class MemoryBudget
+ * @brief Byte budget shared by the caches of one search task
+ *
+ * Caches charge their allocations before making them and release them
+ * when freed. A cache that hits the limit evicts by its own policy and
+ * records the evictions here, so the status reports one usage figure
+ * and one eviction count for all of them.
+ */
+class MemoryBudget
+{
+   public:
+    /**
+     * @brief Construct budget
+     * @param limit Maximum charged bytes (0 - unlimited)
+     */
+    explicit MemoryBudget(std::size_t limit = 0) : m_limit(limit) {}
+
+    /**
+     * @brief Charge bytes if they fit the limit
+     * @param bytes Size of the allocation
+     * @return true if charged, false if the limit would be exceeded
+     */
+    bool Charge(std::size_t bytes)
+    {
+        if ((m_limit > 0) and (m_used + bytes > m_limit)) {
+            return false;
+        }
+        m_used += bytes;
+        return true;
+    }
+
+    /**
+     * @brief Charge bytes regardless of the limit
+     * @param bytes Size of an allocation a cache cannot do without
+     */
+    void Force(std::size_t bytes) { m_used += bytes; }
+
+    /// @brief Return bytes of a freed allocation
+    void Release(std::size_t bytes) { m_used -= std::min(bytes, m_used); }
+
+    /// @brief Record evicted cache entries
+    void Evicted(std::size_t count) { m_evictions += count; }
+
+    /// @brief Maximum charged bytes (0 - unlimited)
+    [[nodiscard]] std::size_t Limit() const { return m_limit; }
+
+    /// @brief Currently charged bytes
+    [[nodiscard]] std::size_t Used() const { return m_used; }
+
+    /// @brief Total number of evicted entries
+    [[nodiscard]] std::size_t Evictions() const { return m_evictions; }
+
+   private:
+    std::size_t m_limit = 0;      ///< Maximum charged bytes (0 - unlimited)
+    std::size_t m_used = 0;       ///< Currently charged bytes
+    std::size_t m_evictions = 0;  ///< Evicted entries so far
+};
+
+/// @} // end of Common group
+
+}  // namespace fw
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+#include "func_node.h"
+
+namespace fw
+{
+
+/// @addtogroup FunctionNodes
+/// @{
+
+/**
+ * @struct SharedNode
+ * @brief Immutable node of a hash-consed function tree
+ *
+ * Children are shared, so equal subtrees interned in one NodeStore are
+ * the same object and compare by pointer.
+ */
+struct SharedNode
+{
+    AtomIndex atom;                          ///< Atomic function of this node
+    std::shared_ptr<const SharedNode> arg1;  ///< First child (for arity >= 1)
+    std::shared_ptr<const SharedNode> arg2;  ///< Second child (for arity = 2)
+    std::size_t hash = 0;                    ///< Structural hash, equal to FuncNode::StructuralHash()
+    std::size_t depth = 0;                   ///< Maximum depth (height) of the subtree
+    std::size_t functions = 0;               ///< Number of function (non-leaf) nodes
+};
+
+/// Reference to an interned subtree
+using NodeRef = std::shared_ptr<const SharedNode>;
+
+/**
+ * @class NodeStore
+ * @brief Hash-consing store of immutable, reference-counted function trees
+ *
+ * Intern() maps a FuncNode tree to shared nodes bottom-up: a node is
+ * looked up by (atom, child pointers), so each distinct subtree is
+ * stored once and a whole tree is a single NodeRef, copied in O(1).
+ * The store only keeps weak references; nodes are freed with the last
+ * tree using them and expired entries are swept as the table grows.
+ */
+class NodeStore
+{
+   public:
+    /**
+     * @brief Intern a tree
+     * @param fnc Function tree, e.g. FuncNode
+     * @return Shared root, equal by pointer for equal trees
+     */
+    template <typename FN_t>
+    NodeRef Intern(const FN_t& fnc)
+    {
+        const auto arity = fnc.Arity();
+        NodeRef arg1 = (arity >= 1) ? Intern(fnc.Arg1()) : nullptr;
+        NodeRef arg2 = (arity == 2) ? Intern(fnc.Arg2()) : nullptr;
+        return Make(fnc.Atom(), std::move(arg1), std::move(arg2));
+    }
+
+    /**
+     * @brief Get or create the node with given atom and children
+     * @param atom Atomic function
+     * @param arg1 First child, nullptr for leaves
+     * @param arg2 Second child, nullptr unless binary
+     * @return Shared node
+     */
+    NodeRef Make(const AtomIndex& atom, NodeRef arg1, NodeRef arg2)
+    {
+        const Key key{.atom = atom, .arg1 = arg1.get(), .arg2 = arg2.get()};
+        const auto it = m_nodes.find(key);
+        if (it != m_nodes.end()) {
+            if (auto node = it->second.lock()) {
+                return node;
+            }
+        }
+
+        auto node = std::make_shared<SharedNode>();
+        node->atom = atom;
+        node->hash = StructuralHash(atom.arity, atom.num, arg1 ? arg1->hash : 0, arg2 ? arg2->hash : 0);
+        if (arg1) {
+            node->depth = arg1->depth + 1;
+            node->functions = arg1->functions + 1;
+        }
+        if (arg2) {
+            node->depth = std::max(node->depth, arg2->depth + 1);
+            node->functions += arg2->functions;
+        }
+        node->arg1 = std::move(arg1);
+        node->arg2 = std::move(arg2);
+        m_nodes.insert_or_assign(key, std::weak_ptr<const SharedNode>(node));
+        if (m_nodes.size() >= m_sweep_at) {
+            Sweep();
+        }
+        return node;
+    }
+
+    /// @brief Number of entries in the table, live or not yet swept
+    [[nodiscard]] std::size_t Size() const { return m_nodes.size(); }
+
+    /**
+     * @brief Rebuild a FuncNode tree from shared nodes
+     * @param node Shared root
+     * @param fnc Tree rebuilt in place; unchanged subtrees keep cached values
+     * @return true if the tree changed
+     */
+    template <typename FN_t>
+    static bool ToTree(const SharedNode& node, FN_t& fnc)
+    {
+        bool changed = fnc.SetAtom(node.atom);
+        if (node.atom.arity >= 1) {
+            changed = ToTree(*node.arg1, fnc.Arg1()) or changed;
+        }
+        if (node.atom.arity == 2) {
+            changed = ToTree(*node.arg2, fnc.Arg2()) or changed;
+        }
+        if (changed) {
+            fnc.ClearCalculated();
+        }
+        return changed;
+    }
+
+    /**
+     * @brief Count distinct function (non-leaf) subtrees
+     * @param node Shared root
+     * @return Number of distinct subtrees, compared by pointer
+     */
+    [[nodiscard]] static std::size_t UniqueFunctions(const SharedNode& node)
+    {
+        // Not reserved by node.functions: shared subtrees count once per use there
+        std::vector<const SharedNode*> seen;
+        CollectFunctions(node, seen);
+        return seen.size();
+    }
+
+    /**
+     * @brief Compare trees structurally
+     *
+     * Trees of one store compare in O(1); the recursion only runs for
+     * trees interned in different stores.
+     */
+    [[nodiscard]] static bool Equal(const SharedNode& a, const SharedNode& b)
+    {
+        if (&a == &b) {
+            return true;
+        }
+        if ((a.hash != b.hash) or (a.atom != b.atom)) {
+            return false;
+        }
+        return ((a.atom.arity < 1) or Equal(*a.arg1, *b.arg1)) and ((a.atom.arity < 2) or Equal(*a.arg2, *b.arg2));
+    }
+
+    /**
+     * @brief Get string representation in FuncNode::Repr() format
+     * @param atoms Atomic function library the tree was built from
+     * @param node Shared root
+     */
+    template <typename FuncValue_t>
+    [[nodiscard]] static std::string Repr(const AtomFuncs<FuncValue_t>* atoms, const SharedNode& node)
+    {
+        switch (node.atom.arity) {
+            case 0:
+                return atoms->arg0[node.atom.num]->Str();
+            case 1:
+                return std::format("{}({})", atoms->arg1[node.atom.num]->Str(), Repr(atoms, *node.arg1));
+            default:
+                return std::format("{}({};{})", atoms->arg2[node.atom.num]->Str(), Repr(atoms, *node.arg1),
+                                   Repr(atoms, *node.arg2));
+        }
+    }
+
+   private:
+    static constexpr std::size_t MIN_SWEEP = 1024;
+
+    /// @brief Table key: atom and child identities
+    struct Key
+    {
+        bool operator==(const Key& other) const = default;
+
+        AtomIndex atom;                    ///< Atomic function
+        const SharedNode* arg1 = nullptr;  ///< First child
+        const SharedNode* arg2 = nullptr;  ///< Second child
+    };
+
+    /// @brief Hash of a table key
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const noexcept
+        {
+            return StructuralHash(key.atom.arity, key.atom.num, HashMix(reinterpret_cast<std::uintptr_t>(key.arg1)),
+                                  HashMix(reinterpret_cast<std::uintptr_t>(key.arg2)));
+        }
+    };
+
+    std::unordered_map<Key, std::weak_ptr<const SharedNode>, KeyHash> m_nodes;  ///< Interned nodes
+    std::size_t m_sweep_at = MIN_SWEEP;                                          ///< Table size of the next sweep
+
+    void Sweep()
+    {
+        std::erase_if(m_nodes, [](const auto& entry) { return entry.second.expired(); });
+        m_sweep_at = std::max(MIN_SWEEP, 2 * m_nodes.size());
+    }
+
+    static void CollectFunctions(const SharedNode& node, std::vector<const SharedNode*>& seen)
+    {
+        if ((node.atom.arity == 0) or (std::ranges::find(seen, &node) != seen.end())) {
+            return;
+        }
+        seen.push_back(&node);
+        CollectFunctions(*node.arg1, seen);
+        if (node.atom.arity == 2) {
+            CollectFunctions(*node.arg2, seen);
+        }
+    }
+};
+
+/**
+ * @class SharedFunc
+ * @brief Immutable function tree with its values, copied in O(1)
+ * @tparam FuncValue_t Type of function values
+ */
+template <typename FuncValue_t>
+class SharedFunc
+{
+   public:
+    /// Vector type for function values
+    using FuncValues_t = std::vector<FuncValue_t>;
+
+    /**
+     * @brief Intern a tree and keep its values
+     * @param store Store the tree is interned in
+     * @param fnc Function tree with Calculate()
+     */
+    template <typename FN_t>
+    SharedFunc(NodeStore& store, FN_t& fnc)
+        : m_root(store.Intern(fnc))
+    {
+        const auto values = fnc.Calculate();
+        m_values = std::make_shared<const FuncValues_t>(values.begin(), values.end());
+    }
+
+    /**
+     * @brief Keep an interned tree with its values
+     * @param root Shared root, e.g. from DagProgram::Intern()
+     * @param values Function values of the tree
+     */
+    SharedFunc(NodeRef root, FuncValues_t values)
+        : m_root(std::move(root)), m_values(std::make_shared<const FuncValues_t>(std::move(values)))
+    {
+    }
+
+    /// @brief Structural equality
+    bool operator==(const SharedFunc& other) const { return NodeStore::Equal(*m_root, *other.m_root); }
+
+    /// @brief Get shared root
+    [[nodiscard]] const NodeRef& Root() const { return m_root; }
+
+    /// @brief Get function values for all inputs
+    [[nodiscard]] const FuncValues_t& Calculate() const { return *m_values; }
+
+    /// @brief Get maximum depth of the tree (height)
+    [[nodiscard]] std::size_t CurrentMaxLevel() const { return m_root->depth; }
+
+    /// @brief Count total number of function nodes in the tree
+    [[nodiscard]] std::size_t FunctionsCount() const { return m_root->functions; }
+
+    /// @brief Count distinct function subtrees
+    [[nodiscard]] std::size_t UniqueFunctions() const { return NodeStore::UniqueFunctions(*m_root); }
+
+    /// @brief Get string representation in FuncNode::Repr() format
+    [[nodiscard]] std::string Repr(const AtomFuncs<FuncValue_t>* atoms) const
+    {
+        return NodeStore::Repr(atoms, *m_root);
+    }
+
+    /**
+     * @brief Build equivalent FuncNode tree
+     * @param fnc Tree rebuilt in place; unchanged subtrees keep cached values
+     */
+    template <typename FN_t>
+    void ToTree(FN_t& fnc) const
+    {
+        NodeStore::ToTree(*m_root, fnc);
+    }
+
+   private:
+    NodeRef m_root;                                ///< Interned tree
+    std::shared_ptr<const FuncValues_t> m_values;  ///< Values, shared between copies
+};
+
+/// @} // end of FunctionNodes group
+
+}  // namespace fw
@@ -1,22 +1,43 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <format>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <random>
+#include <span>
+#include <sstream>
 #include <stop_token>
+#include <string_view>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
+#include "best_first.h"
+#include "canonical_count.h"
 #include "common.h"
 #include "comparison.h"
+#include "dag_program.h"
 #include "func_node.h"
+#include "gf2_affine.h"
+#include "huge_pages.h"
+#include "lut_atoms.h"
+#include "memory_budget.h"
+#include "node_store.h"
+#include "shape_enum.h"
+#include "size_order.h"
+#include "static_atoms.h"
 #include "status.h"
 #include "target.h"
+#include "tiled_eval.h"
+#include "value_bank.h"
 
 namespace fw
 {
@@ -39,12 +60,61 @@ struct Settings
         return ((save_file == other.save_file) and (max_best == other.max_best) and (max_depth == other.max_depth));
     }
 
+    /**
+     * @brief Get enumeration modes enabled by the settings
+     * @return Names of the enabled modes (none - depth order), more than one is a conflict
+     *
+     * Value banks are built depth by depth, so iterative deepening
+     * combines with bottom_up instead of being a mode of its own.
+     */
+    [[nodiscard]] std::vector<std::string_view> EnumerationModes() const
+    {
+        std::vector<std::string_view> modes;
+        const std::array<std::pair<bool, std::string_view>, 7> flags = {{{dag_steps > 0, "dag_steps"},
+                                                                         {shape_first, "shape_first"},
+                                                                         {bottom_up, "bottom_up"},
+                                                                         {random_sampling, "random_sampling"},
+                                                                         {best_first, "best_first"},
+                                                                         {size_order, "size_order"},
+                                                                         {iterative_deepening and (not bottom_up),
+                                                                          "iterative_deepening"}}};
+        for (const auto& [enabled, name] : flags) {
+            if (enabled) {
+                modes.push_back(name);
+            }
+        }
+        return modes;
+    }
+
     std::string save_file;                ///< 📁 File path for automatic save/load of search state
     std::size_t max_best = 32;            ///< 🏆 Maximum number of best functions to retain
     std::size_t max_depth = 3;            ///< 🌳 Maximum depth of function trees to explore
     bool http_enabled = false;            ///< 🌐 Enable/disable HTTP server for remote control
     std::string http_host = "localhost";  ///< 🖧 Host address for HTTP server (default: localhost)
     int http_port = 8080;                 ///< 🔌 Port for HTTP server (default: 8080)
+    std::size_t probe_samples = 0;        ///< 🔬 Samples in the first evaluation tier (0 - single tier)
+    std::size_t tile_size = 0;            ///< 🧱 Samples per tile for streaming evaluation (0 - disabled)
+    std::size_t unary_chains = 0;         ///< 🔗 Tabulate unary atom chains up to this length (below 2 - none)
+    bool fused_kernels = false;           ///< ⚡ Fuse node patterns in tiled evaluation, see SearchTask::UseAtomSet()
+    bool affine_stage = false;            ///< ⊕ Solve target as a GF(2)-affine map of each candidate
+    bool random_sampling = false;         ///< 🎲 Draw random trees instead of enumerating them in order
+    uint64_t random_seed = 0;             ///< 🎲 Seed of random sampling (0 - nondeterministic)
+    std::vector<double> depth_weights;    ///< 🎲 Relative sampling weight per depth (empty - uniform over all trees)
+    bool size_order = false;              ///< 📏 Enumerate trees by cost (node count) instead of depth
+    std::size_t max_cost = 7;             ///< 📏 Maximum tree cost in size or best-first order
+    bool best_first = false;              ///< 🥇 Enumerate trees best-first by weighted atom cost
+    std::size_t max_queue = 1'000'000;    ///< 🥇 Partial expansions kept in the best-first queue
+    std::size_t dag_steps = 0;            ///< 🕸️ Enumerate DAG programs with up to this many steps (0 - trees)
+    bool shape_first = false;             ///< 🔷 Enumerate tree shapes, then atom labels per shape
+    std::size_t shape_shards = 1;         ///< 🔷 Number of parallel tasks sharing the shapes
+    std::size_t shape_shard = 0;          ///< 🔷 Shapes of this task: index % shape_shards == shape_shard
+    bool gray_order = false;              ///< 🔷 Visit labels of a shape in Gray order, one node change per step
+    bool iterative_deepening = false;     ///< 🪜 Complete depths in turn; checkpoints may resume deeper
+    bool huge_pages = false;              ///< 🐘 Back large value buffers by huge pages where possible
+    bool bottom_up = false;               ///< 🧺 Enumerate distinct values bottom-up, combining banks per depth
+    std::size_t memory_budget = 0;        ///< 🧮 Bytes shared by value caches (0 - unlimited)
+    std::string spill_dir;                ///< 💽 Directory for value blocks beyond memory_budget (empty - evict)
+    std::size_t bank_tile = 0;            ///< 🧺 Bank entries per side of a binary combination tile (0 - auto)
 };
 
 /**
@@ -53,6 +123,7 @@ struct Settings
  * @tparam FuncValue_t Type of function values (e.g., int, double, bool)
  * @tparam SKIP_CONSTANT Whether to skip constant expressions during iteration
  * @tparam SKIP_SYMMETRIC Whether to skip symmetric duplicates for commutative ops
+ * @tparam SN_t Serial number type: SerialNumber_t, or BigSerialNumber for spaces beyond 128 bits
  * 
  * Manages the systematic exploration of function space to discover
  * expressions that approximate a target function. Supports parallel
@@ -65,12 +136,45 @@ struct Settings
  * @note Search can be run in background threads with cooperative
  * cancellation via std::stop_token.
  */
-template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false>
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false,
+          typename SN_t = SerialNumber_t>
 class SearchTask
 {
    public:
     /// Type alias for function nodes used in this search
-    using FN_t = FuncNode<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC>;
+    using FN_t = FuncNode<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t>;
+    /// Type alias for the counter of canonical trees
+    using Counter_t = CanonicalCounter<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t>;
+    /// Type alias for the cost order of trees
+    using SizeOrder_t = SizeOrder<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t>;
+    /// Type alias for the best-first enumerator
+    using BestFirst_t = BestFirst<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t>;
+    /// Type alias for DAG programs
+    using Dag_t = DagProgram<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC>;
+    /// Type alias for label enumeration over a tree shape
+    using ShapeLabels_t = ShapeLabels<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC>;
+    /// Type alias for hash-consed best functions
+    using Shared_t = SharedFunc<FuncValue_t>;
+    /// Type alias for bottom-up value banks
+    using Bank_t = ValueBank<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC>;
+
+    /// Minimum time between two counts of huge pages, see GetStatus()
+    static constexpr std::chrono::seconds HUGE_COUNT_PERIOD{10};
+
+    /// @brief Results kept when iterative deepening completes a depth
+    struct DepthResult
+    {
+        std::size_t depth = 0;   ///< Completed depth
+        std::size_t count = 0;   ///< Iterations up to and including this depth
+        std::vector<FN_t> best;  ///< Best functions up to this depth
+    };
+
+    /// @brief Exact result of a complete tiled evaluation, see TiledReject() and ProbeReject()
+    struct TiledScore
+    {
+        Distance distance{};  ///< Distance to target
+        MatchMask mask;       ///< Matching samples
+    };
 
     /**
      * @brief Construct a new search task
@@ -80,10 +184,38 @@ class SearchTask
      * 
      * @note The SearchTask does not take ownership of atoms or target.
      *       These must remain valid for the lifetime of the task.
+     * @note Settings enabling more than one enumeration mode, or unary
+     *       chain tables beyond their limits, are rejected: the task does
+     *       not search, see Rejected().
      */
     explicit SearchTask(Settings settings, AtomFuncs<FuncValue_t>* atoms, Target<FuncValue_t>* target)
-        : m_settings(std::move(settings)), m_atoms(atoms), m_target(target), m_fn{atoms}
+        : m_settings(std::move(settings)),
+          m_atoms(atoms),
+          m_target(target),
+          m_fn{atoms},
+          m_canonical{atoms, m_settings.max_depth},
+          m_size_order{atoms, (m_settings.size_order or m_settings.best_first) ? m_settings.max_cost : 0},
+          m_best_first{atoms, m_settings.best_first ? m_settings.max_cost : 0, m_settings.max_queue},
+          m_dag{atoms},
+          m_shapes{m_settings.shape_first ? m_settings.max_depth : 0},
+          m_shape_index{m_settings.shape_shard},
+          m_probe_tiles{atoms, target, m_settings.probe_samples},
+          m_tiled{atoms, target, m_settings.tile_size}
     {
+        if (const auto modes = m_settings.EnumerationModes(); modes.size() > 1) {
+            std::string names;
+            for (const auto& mode : modes) {
+                names += names.empty() ? std::string(mode) : std::format(", {}", mode);
+            }
+            m_rejected = std::format("conflicting enumeration modes: {}", names);
+        }
+        InitBank();
+        InitProbe();
+        m_tiled_enabled = m_tiled.Available();
+        m_probe_streamed = (not m_tiled_enabled) and (not m_probe.empty()) and m_probe_tiles.Available();
+        InitChains();
+        InitAffine();
+        InitSampling();
     }
 
     /**
@@ -91,7 +223,7 @@ class SearchTask
      * @param other SearchTask to compare with
      * @return true if tasks have identical state
      */
-    bool operator==(const SearchTask<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC>& other) const
+    bool operator==(const SearchTask& other) const
     {
         if (m_settings != other.m_settings) {
             return false;
@@ -127,7 +259,26 @@ class SearchTask
      * Updates m_fn to the next function tree in lexicographic order.
      * Used for single-step iteration without starting a background thread.
      */
-    bool Iterate() { return m_fn.Iterate(m_settings.max_depth); }
+    bool Iterate() { return IterateTree(); }
+
+    /**
+     * @brief Evaluate tiles with the kernels of an atom set known at compile time
+     * @tparam Set StaticAtomSet
+     * @param set Set registered in the library of the task; must outlive the task
+     *
+     * Tiled evaluation (see Settings::tile_size) and the gathered tiers of
+     * progressive evaluation then run whole trees per tile through
+     * StaticTileKernels: atoms of the set are dispatched to inlined
+     * kernels, and with Settings::fused_kernels their node patterns run as
+     * fused kernels, with hit rates reported by Status(). Unary chain tables
+     * are not used in tiles then. Values cached per node, as without tiled
+     * evaluation, are left to the atoms. Call before Run().
+     */
+    template <typename Set>
+    void UseAtomSet(const Set* set)
+    {
+        m_kernels = std::make_unique<StaticTileKernels<FuncValue_t, FN_t, Set>>(m_atoms, set, m_settings.fused_kernels);
+    }
 
     /**
      * @brief Start search in a background thread
@@ -170,9 +321,42 @@ class SearchTask
         j["suit_threshold"]["functions_count"] = m_suit_threshold.functions_count();
         j["suit_threshold"]["functions_unique"] = m_suit_threshold.functions_unique();
         j["current_fn"] = m_fn.ToJSON();
+        if (m_settings.dag_steps > 0) {
+            j["current_dag"] = m_dag.ToJSON();
+        }
+        if (m_settings.shape_first) {
+            j["shape"]["index"] = m_shape_index;
+            // The position is stored as a tree, so it maps to serial numbers in either label order.
+            if (m_shape_labels) {
+                FN_t fnc{m_atoms};
+                m_shape_labels->ToTree(fnc);
+                j["shape"]["fn"] = fnc.ToJSON();
+            }
+        }
+        if (m_settings.bottom_up and m_bank->Started()) {
+            j["bank"] = m_bank->ToJSON();
+        }
+        if (m_settings.iterative_deepening) {
+            j["depths"] = json::array();
+            for (const auto& result : m_depths) {
+                json j_result;
+                j_result["depth"] = result.depth;
+                j_result["count"] = result.count;
+                j_result["best"] = json::array();
+                for (const auto& best : result.best) {
+                    j_result["best"].push_back(best.ToJSON());
+                }
+                j["depths"].push_back(j_result);
+            }
+        }
+        if (m_settings.random_sampling) {
+            std::ostringstream rng_state;
+            rng_state << m_rng;
+            j["rng_state"] = rng_state.str();
+        }
         j["best"] = json::array();
         for (const auto& best : m_best) {
-            j["best"].push_back(best.ToJSON());
+            j["best"].push_back(Materialize(best).ToJSON());
         }
         return j;
     }
@@ -222,7 +406,13 @@ class SearchTask
         if (not j_settings_max_depth->is_number()) {
             return false;
         }
-        m_settings.max_depth = j_settings_max_depth->get<std::size_t>();
+        const auto saved_max_depth = j_settings_max_depth->get<std::size_t>();
+        const bool deepen = m_settings.iterative_deepening and (m_settings.max_depth > saved_max_depth);
+        if (not deepen) {
+            m_settings.max_depth = saved_max_depth;
+        }
+        m_canonical = Counter_t(m_atoms, m_settings.max_depth);
+        m_shapes = TreeShapes(m_settings.shape_first ? m_settings.max_depth : 0);
 
         const auto j_count = j.find("count");
         if (j_count == j.end()) {
@@ -240,7 +430,8 @@ class SearchTask
         if (not j_done->is_boolean()) {
             return false;
         }
-        m_done = j_done->get<bool>();
+        const bool saved_done = j_done->get<bool>();
+        m_done = saved_done and (not deepen);
 
         const auto j_suit_threshold = j.find("suit_threshold");
         if (j_suit_threshold == j.end()) {
@@ -296,6 +487,73 @@ class SearchTask
             return false;
         }
 
+        const auto j_rng_state = j.find("rng_state");
+        if (j_rng_state != j.end()) {
+            if (not j_rng_state->is_string()) {
+                return false;
+            }
+            std::istringstream rng_state(j_rng_state->get<std::string>());
+            rng_state >> m_rng;
+            if (rng_state.fail()) {
+                return false;
+            }
+        }
+
+        const auto j_dag = j.find("current_dag");
+        if (j_dag != j.end()) {
+            if (not j_dag->is_object()) {
+                return false;
+            }
+            if (not m_dag.FromJSON(*j_dag)) {
+                return false;
+            }
+        }
+
+        const auto j_shape = j.find("shape");
+        if (j_shape != j.end()) {
+            if (not j_shape->is_object()) {
+                return false;
+            }
+            const auto j_shape_index = j_shape->find("index");
+            if ((j_shape_index == j_shape->end()) or (not j_shape_index->is_number_unsigned())) {
+                return false;
+            }
+            m_shape_index = j_shape_index->get<std::size_t>();
+            m_shape_labels = nullptr;
+            const auto j_shape_fn = j_shape->find("fn");
+            if (j_shape_fn != j_shape->end()) {
+                FN_t fnc{m_atoms};
+                if ((not fnc.FromJSON(*j_shape_fn)) or (not m_shapes.Fits()) or (m_shape_index >= m_shapes.Count())) {
+                    return false;
+                }
+                m_shape_labels = std::make_unique<ShapeLabels_t>(m_atoms, m_shapes.Unrank(m_shape_index),
+                                                                 m_settings.gray_order, m_settings.huge_pages);
+                if (not m_shape_labels->FromTree(fnc)) {
+                    return false;
+                }
+            }
+        }
+
+        // Banks are rebuilt for the saved max_depth by replaying them outside
+        // the lock, deepened, then swapped in; the old bank goes before its budget.
+        if (m_settings.bottom_up) {
+            auto budget = MakeBudget();
+            auto bank = MakeBank(*budget, saved_max_depth);
+            const auto j_bank = j.find("bank");
+            if ((j_bank != j.end()) and ((not j_bank->is_object()) or (not bank->FromJSON(*j_bank)))) {
+                return false;
+            }
+            bank->Deepen(m_settings.max_depth);
+            const std::unique_lock lock{m_mtx};
+            m_budget.swap(budget);
+            m_bank.swap(bank);
+        }
+
+        // Best-first order continues after the current function.
+        if (m_settings.best_first and (m_count > 0)) {
+            m_best_first.Resume(m_fn);
+        }
+
         m_best.clear();
         const auto j_best = j.find("best");
         if (j_best != j.end()) {
@@ -304,22 +562,75 @@ class SearchTask
             }
 
             for (auto& j_best_it : *j_best) {
-                m_best.emplace_back(m_atoms);
-                if (not m_best.back().FromJSON(j_best_it)) {
+                FN_t fnc{m_atoms};
+                if (not fnc.FromJSON(j_best_it)) {
+                    return false;
+                }
+                m_best.emplace_back(m_store, fnc);
+            }
+        }
+
+        m_depths.clear();
+        const auto j_depths = j.find("depths");
+        if (j_depths != j.end()) {
+            if (not j_depths->is_array()) {
+                return false;
+            }
+            for (const auto& j_result : *j_depths) {
+                const auto j_depth = j_result.find("depth");
+                const auto j_depth_count = j_result.find("count");
+                const auto j_depth_best = j_result.find("best");
+                if ((j_depth == j_result.end()) or (not j_depth->is_number_unsigned()) or
+                    (j_depth_count == j_result.end()) or (not j_depth_count->is_number_unsigned()) or
+                    (j_depth_best == j_result.end()) or (not j_depth_best->is_array())) {
                     return false;
                 }
+                DepthResult result{
+                    .depth = j_depth->get<std::size_t>(), .count = j_depth_count->get<std::size_t>(), .best = {}};
+                for (const auto& j_best_it : *j_depth_best) {
+                    result.best.emplace_back(m_atoms);
+                    if (not result.best.back().FromJSON(j_best_it)) {
+                        return false;
+                    }
+                }
+                m_depths.push_back(std::move(result));
+            }
+        }
+
+        // A completed search continues with the first tree one depth deeper.
+        const bool completed = saved_done or ((not m_depths.empty()) and (m_depths.back().depth >= saved_max_depth));
+        if (deepen and completed and (not m_settings.bottom_up)) {
+            SN_t max_sn{};
+            if (not m_fn.MaxSerialNumber(saved_max_depth, max_sn) or not m_fn.FromSerialNumber(max_sn - 1U)) {
+                return false;
             }
         }
 
         return true;
     }
 
+    /**
+     * @brief Get results of the depths completed by iterative deepening
+     * @return Iteration count and best functions at the end of each depth
+     */
+    [[nodiscard]] std::vector<DepthResult> Depths() const
+    {
+        const std::unique_lock lock{m_mtx};
+        return m_depths;
+    }
+
     /**
      * @brief Check if search has completed
      * @return true if search exhausted all possibilities, false otherwise
      */
     [[nodiscard]] bool Done() const { return m_done; }
 
+    /**
+     * @brief Get the reason the settings are rejected
+     * @return Why the task does not search, empty if the settings are accepted
+     */
+    [[nodiscard]] const std::string& Rejected() const { return m_rejected; }
+
     /**
      * @brief Get current best functions found
      * @return Vector of best function trees, sorted by quality
@@ -332,7 +643,22 @@ class SearchTask
     [[nodiscard]] std::vector<FN_t> Best() const
     {
         std::unique_lock lock{m_mtx};
-        return std::vector<FN_t>(m_best.begin(), m_best.end());
+        std::vector<FN_t> best;
+        best.reserve(m_best.size());
+        for (const auto& shared : m_best) {
+            best.push_back(Materialize(shared));
+        }
+        return best;
+    }
+
+    /**
+     * @brief Get expressions found by the GF(2)-affine stage
+     * @return Target as XOR/AND/shift expressions over enumerated candidates
+     */
+    [[nodiscard]] std::vector<std::string> AffineFunctions() const
+    {
+        std::unique_lock lock{m_mtx};
+        return m_affine_found;
     }
 
     /**
@@ -345,71 +671,171 @@ class SearchTask
      * - Iterations per second
      * - List of best functions with their scores
      */
-    std::string Status()
-    {
-        const std::unique_lock lock{m_mtx};
-        const auto snum = m_fn.SerialNumber();
-        const auto max_sn = m_fn.MaxSerialNumber(m_settings.max_depth);
-        const float done_percent = (snum * 100.0F) / max_sn;
-
-        const auto elapsed = std::chrono::steady_clock::now() - m_tm_start;
-        const auto d = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
-        const std::size_t c_per_sec = m_count * 1000 / d;
-
-        const auto sn_per_sec = snum * 1000 / d;
-        const auto remaining_sn = max_sn - snum;
-        const auto remaining = std::chrono::seconds(remaining_sn / sn_per_sec);
-
-        const auto remaining_h = std::chrono::duration_cast<std::chrono::hours>(remaining);
-        const auto remaining_m = std::chrono::duration_cast<std::chrono::minutes>(remaining % std::chrono::hours(1));
-        const auto remaining_s = std::chrono::duration_cast<std::chrono::seconds>(remaining % std::chrono::minutes(1));
-
-        const auto elapsed_h = std::chrono::duration_cast<std::chrono::hours>(elapsed);
-        const auto elapsed_m = std::chrono::duration_cast<std::chrono::minutes>(elapsed % std::chrono::hours(1));
-        const auto elapsed_s = std::chrono::duration_cast<std::chrono::seconds>(elapsed % std::chrono::minutes(1));
-
-        auto status = std::format(
-            "iteration {}; func sn {} from max {}; progress {}%; speed {} ips; elapsed: {}:{:02d}:{:02d}; remaining: "
-            "{}:{:02d}:{:02d}; function {}\n",
-            format_with_si_prefix(m_count), format_with_si_prefix(snum), format_with_si_prefix(max_sn), done_percent,
-            format_with_si_prefix(c_per_sec), elapsed_h.count(), elapsed_m.count(), elapsed_s.count(),
-            remaining_h.count(), remaining_m.count(), remaining_s.count(), m_fn.Repr());
-
-        status += std::format("|  dist  | lvl | fnc | fnu | {:48}| coincidences\n", "function");
-        for (auto& best : m_best) {
-            const auto suit = CalcDist(best);
-            status += std::format("| {:6} | {:3} | {:3} | {:3} | {:48}| {} \n", suit.distance(), suit.max_level(),
-                                  suit.functions_count(), suit.functions_unique(), best.Repr(),
-                                  m_target->MatchPositions(best.Calculate()).Str());
-        }
-        return status;
-    }
+    std::string Status() { return GetStatus().to_string(); }
 
+    /**
+     * @brief Collect search progress and best functions
+     * @return Status snapshot
+     * 
+     * Progress and remaining time are based on the rank of the current
+     * tree among canonical (non-pruned) trees, falling back to serial
+     * numbers if the canonical count does not fit SN_t. Serial number
+     * arithmetic is overflow-checked: if the search space does not fit
+     * SN_t, progress is reported as unknown instead of wrapping around.
+     * Serial numbers beyond the status field width are flagged as well,
+     * while the progress ratio stays exact. In size order progress is the
+     * rank of the current tree in cost order. Huge pages are counted
+     * after the state lock is released, at most every HUGE_COUNT_PERIOD.
+     */
     status::Status GetStatus()
     {
         status::Status status;
-        const std::unique_lock lock{m_mtx};
-        status.snum = m_fn.SerialNumber();
-        status.max_sn = m_fn.MaxSerialNumber(m_settings.max_depth);
-        status.done_percent = (status.snum * 100.0F) / status.max_sn;
-
+        std::unique_lock lock{m_mtx};
+        std::vector<HugePageRegion::Extent> extents;
         status.elapsed = std::chrono::steady_clock::now() - m_tm_start;
-        const auto d = std::chrono::duration_cast<std::chrono::milliseconds>(status.elapsed).count();
+        const auto d = std::max<int64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(status.elapsed).count(), 1);
         status.iterations_count = m_count;
+        status.rejected = m_rejected;
         status.iterations_per_sec = status.iterations_count * 1000 / d;
-        status.sn_per_sec = status.snum * 1000 / d;
-        const auto remaining_sn = status.max_sn - status.snum;
-        status.remaining = std::chrono::seconds(remaining_sn / status.sn_per_sec);
-        status.current_function = m_fn.Repr();
+
+        long double ratio = 0;
+        SN_t max_sn{};
+        if (m_settings.dag_steps > 0) {
+            status.progress_order = status::ProgressOrder::Dag;
+            ratio = m_dag.Progress(m_settings.dag_steps);
+        }
+        else if (m_settings.shape_first) {
+            // Approximate: shapes differ in size.
+            status.progress_order = status::ProgressOrder::Shapes;
+            if (m_shapes.Fits()) {
+                const auto in_shape = m_shape_labels ? m_shape_labels->Progress() : 0;
+                ratio = std::min<long double>(
+                    (static_cast<long double>(m_shape_index) + in_shape) / static_cast<long double>(m_shapes.Count()),
+                    1);
+            }
+        }
+        else if (m_settings.bottom_up) {
+            // Approximate: deeper levels are larger.
+            status.progress_order = status::ProgressOrder::BottomUp;
+            ratio = m_bank->Progress();
+        }
+        else if (m_settings.best_first) {
+            // Trees cheaper than the current one are done.
+            status.progress_order = status::ProgressOrder::BestFirst;
+            if (m_size_order.Fits()) {
+                ratio = SerialNumberToFloat(m_size_order.CountBelow(m_fn.Cost())) /
+                        SerialNumberToFloat(m_size_order.Count());
+            }
+            status.queue_size = m_best_first.QueueSize();
+            status.queue_refills = m_best_first.Refills();
+        }
+        else if (m_settings.size_order) {
+            // Trees may be deeper than max_depth, serial numbers do not apply.
+            status.progress_order = status::ProgressOrder::SizeOrder;
+            if (m_size_order.Fits()) {
+                ratio = SerialNumberToFloat(m_size_order.Rank(m_fn)) / SerialNumberToFloat(m_size_order.Count());
+            }
+        }
+        else if (m_settings.random_sampling) {
+            // Draws are independent, so no share of the space is done: only samples are counted.
+            status.progress_order = status::ProgressOrder::Random;
+        }
+        else if (m_fn.MaxSerialNumber(m_settings.max_depth, max_sn)) {
+            status.progress_order = status::ProgressOrder::Depth;
+            const SN_t snum = m_fn.SerialNumber();
+            const auto snum_f = SerialNumberToFloat(snum);
+            ratio = snum_f / SerialNumberToFloat(max_sn);
+            status.sn_per_sec = static_cast<std::size_t>(
+                std::min<long double>(snum_f * 1000 / d, static_cast<long double>(SIZE_MAX)));
+            status.sn_overflow = not(ToSerialNumber128(snum, status.snum) and ToSerialNumber128(max_sn, status.max_sn));
+        }
+        else {
+            status.progress_order = status::ProgressOrder::Depth;
+            status.sn_overflow = true;
+        }
+        if (status.sn_overflow) {
+            status.snum = 0;
+            status.max_sn = 0;
+        }
+
+        // Pruning skips a non-uniform share of serial numbers, so progress
+        // is measured in canonical trees whenever they can be counted.
+        if (m_canonical.Fits() and (status.progress_order == status::ProgressOrder::Depth)) {
+            const SN_t rank = m_canonical.Rank(m_fn);
+            const SN_t count = m_canonical.Count(m_settings.max_depth);
+            ratio = SerialNumberToFloat(rank) / SerialNumberToFloat(count);
+            ToSerialNumber128(rank, status.canonical_rank);
+            ToSerialNumber128(count, status.canonical_count);
+        }
+
+        status.done_percent = static_cast<float>(ratio * 100);
+        if (ratio > 0) {
+            status.remaining = std::chrono::duration_cast<decltype(status.remaining)>(
+                std::chrono::duration<long double, std::nano>(status.elapsed.count() * (1 - ratio) / ratio));
+        }
+
+        if (m_settings.dag_steps > 0) {
+            status.current_function = m_dag.Repr();
+        }
+        else if (m_settings.shape_first and m_shape_labels) {
+            status.current_function = m_shape_labels->Repr();
+            if (m_settings.huge_pages) {
+                status.pool_bytes = m_shape_labels->Buffer().Bytes();
+                extents.push_back(m_shape_labels->Buffer().GetExtent());
+            }
+        }
+        else if (m_settings.bottom_up and m_bank->Started()) {
+            status.current_function = m_bank->Repr();
+        }
+        else {
+            status.current_function = m_fn.Repr();
+        }
+        status.cache_bytes = m_budget->Used();
+        status.cache_limit = m_budget->Limit();
+        status.cache_evictions = m_budget->Evictions();
+        if (m_settings.bottom_up) {
+            status.bank_entries = m_bank->Entries();
+            status.bank_dropped = m_bank->Dropped();
+            status.bank_collisions = m_bank->Collisions();
+            status.spill_bytes = m_bank->SpilledBytes();
+            status.bank_tile = m_bank->Tile();
+            if (m_settings.huge_pages) {
+                status.pool_bytes = m_bank->BlockMemoryBytes();
+                m_bank->BlockExtents(extents);
+            }
+        }
+        status.probe_rejected = m_probe_rejected;
+        status.depths_done = m_depths.size();
+        status.tiled_rejected = m_tiled_rejected;
+        status.evaluated_samples =
+            m_evaluated_samples + m_tiled.EvaluatedSamples() + m_probe_tiles.EvaluatedSamples();
+        status.sample_rejected = m_sample_rejected;
+        if (m_chains) {
+            status.chain_tables = m_chains->Count();
+            status.chain_bytes = m_chains->Bytes();
+        }
+        if (m_kernels and m_settings.fused_kernels) {
+            status.fused_hit_rate = m_kernels->HitRate();
+            for (std::size_t i = 0; i < FUSED_PATTERNS; ++i) {
+                const auto pattern = static_cast<FusedPattern>(i);
+                status.fused_hits.emplace_back(FusedPatternName(pattern), m_kernels->Hits(pattern));
+            }
+        }
+        status.affine_functions = m_affine_found;
 
         status.best_functions.reserve(m_best.size());
-        for (auto& best : m_best) {
+        for (const auto& best : m_best) {
             status::BestFunc best_func;
-            best_func.function = best.Repr();
+            best_func.function = best.Repr(m_atoms);
             best_func.suit = CalcDist(best);
             best_func.match_positions = m_target->MatchPositions(best.Calculate()).Str();
             status.best_functions.push_back(best_func);
         }
+        lock.unlock();
+        if (not extents.empty()) {
+            status.huge_page_bytes = HugeBytes(extents);
+        }
         return status;
     }
 
@@ -418,13 +844,488 @@ class SearchTask
     AtomFuncs<FuncValue_t>* m_atoms = nullptr;                      ///< 🧩 Reference to atomic function library
     Target<FuncValue_t>* m_target = nullptr;                        ///< 🎯 Reference to target specification
     FN_t m_fn;                                                      ///< 🌳 Current function being evaluated
+    Counter_t m_canonical;                                          ///< 📈 Count of canonical trees for progress
+    SizeOrder_t m_size_order;                                       ///< 📏 Cost order of trees (with size_order)
+    BestFirst_t m_best_first;                                       ///< 🥇 Best-first enumerator (with best_first)
+    Dag_t m_dag;                                                    ///< 🕸️ Current DAG program (with dag_steps)
+    TreeShapes m_shapes;                                            ///< 🔷 Tree shapes up to max_depth
+    std::size_t m_shape_index = 0;                                  ///< 🔷 Index of the current shape
+    std::unique_ptr<ShapeLabels_t> m_shape_labels;                  ///< 🔷 Label counter of the current shape
+    std::vector<DepthResult> m_depths;                              ///< 🪜 Results of completed depths
+    std::unique_ptr<MemoryBudget> m_budget;                         ///< 🧮 Memory shared by value caches
+    std::unique_ptr<Bank_t> m_bank;                                 ///< 🧺 Value banks (with bottom_up)
     std::chrono::time_point<std::chrono::steady_clock> m_tm_start;  ///< ⏱️ Search start time
     std::size_t m_count = 0;                                        ///< 🔢 Number of iterations performed
-    std::list<FN_t> m_best;                                         ///< 🏆 Best functions found (maintained in order)
+    NodeStore m_store;                                              ///< 🏆 Hash-consed trees of the best list
+    std::list<Shared_t> m_best;                                     ///< 🏆 Best functions found (maintained in order)
     SuitabilityMetrics m_suit_threshold;                            ///< 📊 Worst distance currently in best list
-    std::mutex m_mtx;                                               ///< 🔐 Mutex for thread-safe state access
+    mutable std::mutex m_mtx;                                       ///< 🔐 Mutex for thread-safe state access
     std::jthread m_thread;                                          ///< 🧵 Background search thread
     std::atomic_bool m_done = false;                                ///< ✅ Completion flag (atomic for thread safety)
+    std::mutex m_huge_mtx;                                          ///< 🐘 Mutex of the huge page count
+    std::chrono::steady_clock::time_point m_huge_time;              ///< 🐘 Time of the last huge page count
+    std::size_t m_huge_bytes = 0;                                   ///< 🐘 Last huge page count in bytes
+    bool m_huge_counted = false;                                    ///< 🐘 Huge pages were counted once
+    std::string m_rejected;                                         ///< 🚫 Why settings are rejected (empty - accepted)
+    std::vector<std::size_t> m_probe;                               ///< 🔬 Sample positions of the first tier
+    std::vector<std::size_t> m_rest;                                ///< 🔬 Sample positions of the second tier
+    std::size_t m_probe_rejected = 0;                               ///< 🔬 Candidates rejected by bounded compare
+    TiledEvaluator<FuncValue_t> m_probe_tiles;                      ///< 🔬 Evaluator of the tiers at their positions
+    bool m_probe_streamed = false;                                  ///< 🔬 Tiers are evaluated by m_probe_tiles
+    std::size_t m_evaluated_samples = 0;                            ///< 🔬 Samples of full candidate evaluations
+    TiledEvaluator<FuncValue_t> m_tiled;                            ///< 🧱 Streaming evaluator over sample tiles
+    bool m_tiled_enabled = false;                                   ///< 🧱 Tiled evaluation is usable
+    TiledScore m_tiled_score;                                       ///< 🧱 Score of the last candidate kept in tiles
+    std::size_t m_tiled_rejected = 0;                               ///< 🧱 Candidates rejected by tiled evaluation
+    std::unique_ptr<UnaryChains<FuncValue_t>> m_chains;             ///< 🔗 Composition tables of unary chains
+    std::unique_ptr<TileKernels<FuncValue_t, FN_t>> m_kernels;      ///< ⚡ Tree kernels of an atom set for tiles
+    std::vector<FuncValue_t> m_affine_target;                       ///< ⊕ Target values for the affine stage
+    std::vector<std::size_t> m_affine_positions;                    ///< ⊕ Sample positions fitted by the affine stage
+    std::vector<std::vector<FuncValue_t>> m_affine_values;          ///< ⊕ Values of candidates already solved
+    std::vector<std::string> m_affine_found;                        ///< ⊕ Affine expressions matching the target
+    std::mt19937_64 m_rng;                                          ///< 🎲 Random engine of this task's search thread
+    std::discrete_distribution<std::size_t> m_depth_dist;           ///< 🎲 Distribution of sampled depths
+    bool m_sample_by_depth = false;                                 ///< 🎲 Depth is drawn first, by depth_weights
+    std::size_t m_sample_rejected = 0;                              ///< 🎲 Drawn trees discarded as pruned
+
+    /**
+     * @brief Seed random engine and prepare depth distribution
+     * 
+     * Each task owns its engine, so tasks running in parallel threads
+     * never share random state. A fixed seed makes sampling reproducible.
+     */
+    void InitSampling()
+    {
+        if (not m_settings.random_sampling) {
+            return;
+        }
+        m_rng.seed((m_settings.random_seed != 0) ? m_settings.random_seed : std::random_device{}());
+        auto weights = m_settings.depth_weights;
+        weights.resize(std::min(weights.size(), m_settings.max_depth + 1));
+        m_sample_by_depth = std::ranges::any_of(weights, [](double w) { return w > 0; });
+        if (m_sample_by_depth) {
+            m_depth_dist = std::discrete_distribution<std::size_t>(weights.begin(), weights.end());
+        }
+    }
+
+    /**
+     * @brief Replace current function by a random tree
+     * @return true if successful, false if the sampled space does not fit SN_t
+     * 
+     * Serial numbers are drawn uniformly from [0, MaxSerialNumber(max_depth)),
+     * or uniformly within a depth chosen by depth_weights, and unranked.
+     * The tree may be one that Iterate() prunes, SearchIterate() discards
+     * those, so sampling is uniform over the trees the enumeration visits.
+     */
+    bool Sample()
+    {
+        const auto depth = m_sample_by_depth ? m_depth_dist(m_rng) : m_settings.max_depth;
+        SN_t first{};
+        SN_t last{};
+        if (not m_fn.MaxSerialNumber(depth, last)) {
+            return false;
+        }
+        if (m_sample_by_depth and (depth > 0)) {
+            first = m_fn.MaxSerialNumber(depth - 1);
+        }
+        return m_fn.FromSerialNumber(first + RandomSerialNumber(m_rng, SN_t(last - first)));
+    }
+
+    /**
+     * @brief Advance current function to the next candidate
+     * @return true if successful, false if search complete
+     * 
+     * Size and best-first orders start from their first tree, while
+     * Iterate() moves past the initial one.
+     */
+    bool Advance()
+    {
+        if (m_settings.random_sampling) {
+            return Sample();
+        }
+        if (m_settings.best_first) {
+            return m_best_first.Next(m_fn);
+        }
+        if (m_settings.size_order) {
+            return m_size_order.Next(m_fn, m_count == 0);
+        }
+        if (m_settings.iterative_deepening) {
+            return Deepen();
+        }
+        return IterateTree();
+    }
+
+    /**
+     * @brief Advance to the next tree in serial number order
+     *
+     * With tiled evaluation, constant values are found tile by tile, so
+     * trees rejected by TiledReject() never get full values.
+     */
+    bool IterateTree()
+    {
+        if (m_tiled_enabled or m_probe_streamed) {
+            auto& tiles = m_tiled_enabled ? m_tiled : m_probe_tiles;
+            const auto constant_values = [this, &tiles](const FN_t& fnc) {
+                return tiles.ConstantValues(fnc, m_kernels.get());
+            };
+            return m_fn.Iterate(m_settings.max_depth, 0, constant_values);
+        }
+        return m_fn.Iterate(m_settings.max_depth);
+    }
+
+    /**
+     * @brief Advance in depth order, recording each completed depth
+     * @return true if next tree exists, false if max_depth is complete
+     *
+     * Trees are visited in serial number order, which is depth order, so
+     * raising max_depth on a checkpoint continues with the next depth and
+     * never revisits shallower trees.
+     */
+    bool Deepen()
+    {
+        const auto depth = m_fn.CurrentMaxLevel();
+        const bool next = IterateTree();
+        if ((not next) or (m_fn.CurrentMaxLevel() > depth)) {
+            RecordDepth(depth);
+        }
+        return next;
+    }
+
+    /**
+     * @brief Advance to the next distinct value, recording each completed level
+     * @return true if found, false if all levels up to max_depth are done
+     *
+     * With iterative_deepening the levels are the depths: a level is
+     * complete once a deeper value is visited, and a level that adds no
+     * value completes all deeper ones.
+     */
+    bool NextBanked()
+    {
+        const bool started = m_bank->Started();
+        const auto level = m_bank->Position().level;
+        const bool next = m_bank->Next();
+        if (m_settings.iterative_deepening and started) {
+            const auto done = next ? m_bank->Position().level : m_bank->MaxDepth() + 1;
+            for (auto depth = level; depth < done; ++depth) {
+                RecordDepth(depth);
+            }
+        }
+        return next;
+    }
+
+    /// @brief Keep iteration count and best list of a completed depth, once
+    void RecordDepth(std::size_t depth)
+    {
+        if ((not m_depths.empty()) and (m_depths.back().depth >= depth)) {
+            return;
+        }
+        DepthResult result{.depth = depth, .count = m_count, .best = {}};
+        for (const auto& best : m_best) {
+            result.best.push_back(Materialize(best));
+        }
+        m_depths.push_back(std::move(result));
+    }
+
+    /**
+     * @brief Evaluate a candidate in its own representation against target
+     * @param program DAG program or shape labelling with Calculate(), Repr() and ToTree()
+     * 
+     * Values are computed by the program, e.g. shared steps once. Only
+     * candidates that can enter the best list go on to CheckBest(): DAG
+     * programs interned step by step, never expanded, others built as a tree.
+     */
+    template <typename Program>
+    void CheckProgram(Program& program)
+    {
+        const auto& values = program.Calculate();
+        if (not m_affine_positions.empty()) {
+            AffineCheck(values, program.Repr());
+        }
+        if ((m_best.size() >= m_settings.max_best) and
+            (m_target->Compare(values) > m_suit_threshold.distance())) {
+            return;
+        }
+        if constexpr (requires { program.Intern(m_store); }) {
+            Shared_t shared{program.Intern(m_store), values};
+            CheckBest(shared, m_settings.max_best);
+        }
+        else {
+            program.ToTree(m_fn);
+            CheckBest(m_fn, m_settings.max_best);
+        }
+    }
+
+    /**
+     * @brief Bytes of value buffers backed by huge pages
+     * @param extents Extents of the buffers, taken under the state lock
+     * @return Count of at most HUGE_COUNT_PERIOD ago
+     *
+     * Counting reads /proc/self/smaps, so it runs outside the state lock,
+     * and status requests in between reuse the last count.
+     */
+    std::size_t HugeBytes(std::span<const HugePageRegion::Extent> extents)
+    {
+        const std::lock_guard lock{m_huge_mtx};
+        const auto now = std::chrono::steady_clock::now();
+        if ((not m_huge_counted) or (now - m_huge_time >= HUGE_COUNT_PERIOD)) {
+            m_huge_bytes = HugePageRegion::HugeBytes(extents);
+            m_huge_time = now;
+            m_huge_counted = true;
+        }
+        return m_huge_bytes;
+    }
+
+    /// @brief Start the budget, and value banks for the current max_depth, from scratch
+    void InitBank()
+    {
+        // The old bank returns its memory to the old budget; evictions start from zero.
+        m_bank = nullptr;
+        m_budget = MakeBudget();
+        if (m_settings.bottom_up) {
+            m_bank = MakeBank(*m_budget, m_settings.max_depth);
+        }
+    }
+
+    /// @brief Create a budget already charged with the unary chain tables
+    [[nodiscard]] std::unique_ptr<MemoryBudget> MakeBudget() const
+    {
+        auto budget = std::make_unique<MemoryBudget>(m_settings.memory_budget);
+        if (m_chains) {
+            budget->Force(m_chains->Bytes());
+        }
+        return budget;
+    }
+
+    /// @brief Create empty value banks charged to a budget
+    [[nodiscard]] std::unique_ptr<Bank_t> MakeBank(MemoryBudget& budget, std::size_t max_depth) const
+    {
+        auto bank = std::make_unique<Bank_t>(m_atoms, max_depth, &budget, m_settings.huge_pages,
+                                             m_settings.spill_dir, m_settings.bank_tile);
+        bank->SetChains(m_chains.get());
+        return bank;
+    }
+
+    /**
+     * @brief Advance to the next labelling, moving through the shapes of this shard
+     * @return true if successful, false if all shapes are done
+     */
+    bool NextShaped()
+    {
+        if (not m_shapes.Fits()) {
+            return false;
+        }
+        while (m_shape_index < m_shapes.Count()) {
+            if (not m_shape_labels) {
+                m_shape_labels = std::make_unique<ShapeLabels_t>(m_atoms, m_shapes.Unrank(m_shape_index),
+                                                                 m_settings.gray_order, m_settings.huge_pages);
+            }
+            if (m_shape_labels->Next()) {
+                return true;
+            }
+            m_shape_labels = nullptr;
+            m_shape_index += std::max<std::size_t>(m_settings.shape_shards, 1);
+        }
+        return false;
+    }
+
+    /**
+     * @brief Prepare target samples for the GF(2)-affine stage
+     * 
+     * The stage is only available for unsigned integer values and
+     * separable targets. Leaves are screened right away in a pre-pass,
+     * the enumeration then feeds every following candidate.
+     */
+    void InitAffine()
+    {
+        if constexpr (GF2Compatible<FuncValue_t>) {
+            if ((not m_settings.affine_stage) or (not m_target->Separable())) {
+                return;
+            }
+            m_affine_target = m_target->Values();
+            m_affine_positions = m_target->SamplePositions();
+            for (const auto* leaf : m_atoms->arg0) {
+                if (not leaf->Constant()) {
+                    AffineCheck(leaf->Calculate(), leaf->Str());
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Try to reach the target by an affine GF(2) map of candidate values
+     * @param values Candidate values
+     * @param repr Candidate representation
+     * 
+     * Most candidates are rejected by the first few inconsistent samples.
+     * A solved candidate is recorded as an XOR/AND/shift expression over
+     * its representation, unless one with the same values was recorded
+     * before. At most max_best expressions are kept.
+     */
+    void AffineCheck(std::span<const FuncValue_t> values, std::string_view repr)
+    {
+        if constexpr (GF2Compatible<FuncValue_t>) {
+            if (m_affine_positions.empty() or (m_affine_found.size() >= m_settings.max_best)) {
+                return;
+            }
+
+            const auto map = SolveAffine<FuncValue_t>(values, m_affine_target, m_affine_positions);
+            if (not map) {
+                return;
+            }
+            const auto equal = [values](const auto& found) { return std::ranges::equal(found, values); };
+            if (std::ranges::any_of(m_affine_values, equal)) {
+                return;
+            }
+            m_affine_values.emplace_back(values.begin(), values.end());
+            m_affine_found.push_back(map->Repr(repr));
+        }
+    }
+
+    /**
+     * @brief Tabulate unary chains for evaluation and charge them to the budget
+     *
+     * Tables exist only for value types of at most 16 bits; the memory is
+     * one table per chain, see UnaryChains. Settings asking for more than
+     * UnaryChains::MAX_TABLES tables, or for more bytes than the budget
+     * allows, are rejected: the task does not search.
+     */
+    void InitChains()
+    {
+        if (m_settings.unary_chains < 2) {
+            return;
+        }
+        using Chains_t = UnaryChains<FuncValue_t>;
+        const auto count = Chains_t::TableCount(m_atoms->arg1.size(), m_settings.unary_chains);
+        const auto bytes = count * Chains_t::TABLE_SIZE * sizeof(FuncValue_t);
+        if (count > Chains_t::MAX_TABLES) {
+            m_rejected = std::format("unary_chains {} needs more than {} tables", m_settings.unary_chains,
+                                     Chains_t::MAX_TABLES);
+            return;
+        }
+        if (not m_budget->Charge(bytes)) {
+            m_rejected = std::format("unary_chains {} needs {}B of tables, beyond the memory budget",
+                                     m_settings.unary_chains, format_with_si_prefix(bytes));
+            return;
+        }
+        m_chains = std::make_unique<Chains_t>(m_atoms, m_settings.unary_chains);
+        if (not m_chains->Available()) {
+            m_budget->Release(bytes);
+            m_chains = nullptr;
+            return;
+        }
+        m_tiled.SetChains(m_chains.get());
+        m_probe_tiles.SetChains(m_chains.get());
+        if (m_bank) {
+            m_bank->SetChains(m_chains.get());
+        }
+    }
+
+    /**
+     * @brief Split target samples into the two evaluation tiers
+     * 
+     * The first tier takes evenly strided positions across the compared
+     * samples of the target, the second tier takes all the others.
+     * Progressive evaluation stays off for non-separable targets.
+     */
+    void InitProbe()
+    {
+        m_probe.clear();
+        m_rest.clear();
+        if ((m_settings.probe_samples == 0) or (not m_target->Separable())) {
+            return;
+        }
+
+        const auto positions = m_target->SamplePositions();
+        if (m_settings.probe_samples >= positions.size()) {
+            return;
+        }
+
+        const auto stride = positions.size() / m_settings.probe_samples;
+        for (std::size_t i = 0; i < positions.size(); ++i) {
+            if ((i % stride == 0) and (m_probe.size() < m_settings.probe_samples)) {
+                m_probe.push_back(positions[i]);
+            }
+            else {
+                m_rest.push_back(positions[i]);
+            }
+        }
+    }
+
+    /**
+     * @brief Check if a candidate can be rejected without full evaluation
+     * @param fnc Candidate function tree
+     * @return true if the candidate is surely worse than the best list threshold
+     * 
+     * The first tier evaluates the tree on the probe samples only and
+     * compares them against the threshold distance; only candidates that
+     * could still beat it are evaluated on the rest of the samples. With
+     * elementwise atoms both tiers gather their samples tile by tile, and
+     * a kept candidate leaves its exact score in m_tiled_score. Otherwise
+     * the tree gets full values and only the comparison is tiered.
+     */
+    bool ProbeReject(FN_t& fnc)
+    {
+        if (m_probe.empty() or (m_best.size() < m_settings.max_best)) {
+            return false;
+        }
+
+        const auto bound = m_suit_threshold.distance();
+        if (m_probe_streamed) {
+            auto& score = m_tiled_score;
+            score.mask.Reset(m_target->Size());
+            const auto probe_dist = m_probe_tiles.EvaluateAt(fnc, m_probe, bound, &score.mask, m_kernels.get());
+            if (probe_dist > bound) {
+                ++m_probe_rejected;
+                return true;
+            }
+            score.distance =
+                probe_dist + m_probe_tiles.EvaluateAt(fnc, m_rest, bound - probe_dist, &score.mask, m_kernels.get());
+            if (score.distance > bound) {
+                ++m_probe_rejected;
+                return true;
+            }
+            return false;
+        }
+
+        const auto& fnc_calc = Values(fnc);
+        const auto probe_dist = m_target->CompareAt(fnc_calc, m_probe, bound);
+        if (probe_dist > bound) {
+            ++m_probe_rejected;
+            return true;
+        }
+
+        const auto rest_dist = m_target->CompareAt(fnc_calc, m_rest, bound - probe_dist);
+        if (probe_dist + rest_dist > bound) {
+            ++m_probe_rejected;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Check if a candidate can be rejected by tiled evaluation
+     * @param fnc Candidate function tree
+     * @return true if the candidate is surely worse than the best list threshold
+     * 
+     * Evaluates the tree tile by tile without materializing node values
+     * and stops at the first tile that pushes distance past the threshold.
+     * A candidate that is kept was evaluated on every tile, so its exact
+     * distance and matching samples are left in m_tiled_score.
+     */
+    bool TiledReject(const FN_t& fnc)
+    {
+        if ((not m_tiled_enabled) or (m_best.size() < m_settings.max_best)) {
+            return false;
+        }
+
+        const auto bound = m_suit_threshold.distance();
+        m_tiled_score.distance = m_tiled.Evaluate(fnc, bound, &m_tiled_score.mask, m_kernels.get());
+        if (m_tiled_score.distance > bound) {
+            ++m_tiled_rejected;
+            return true;
+        }
+        return false;
+    }
 
     /**
      * @brief Calculate composite distance metric for a function
@@ -436,18 +1337,52 @@ class SearchTask
      * 
      * Weights can be adjusted based on preference for accuracy vs simplicity.
      */
-    SuitabilityMetrics CalcDist(FN_t& fnc) const
+    SuitabilityMetrics CalcDist(FN_t& fnc) const { return Suitability(fnc, m_target->Compare(Values(fnc))); }
+
+    /// @brief Suitability of a candidate whose distance is already known
+    template <typename Candidate_t>
+    static SuitabilityMetrics Suitability(const Candidate_t& fnc, Distance distance)
     {
-        const auto fnc_calc = fnc.Calculate();
-        const auto fnc_cmp = m_target->Compare(fnc_calc);
-        std::unordered_set<SerialNumber_t, SerialNumberHash> uniqs{};
-        fnc.UniqFunctionsSerialNumbers(uniqs);
-        return SuitabilityMetrics(fnc_cmp, fnc.CurrentMaxLevel(), fnc.FunctionsCount(), uniqs.size());
+        return SuitabilityMetrics(distance, fnc.CurrentMaxLevel(), fnc.FunctionsCount(), fnc.UniqueFunctions());
+    }
+
+    /// @brief Calculate suitability of a best-list entry from its shared nodes
+    SuitabilityMetrics CalcDist(const Shared_t& best) const
+    {
+        return SuitabilityMetrics(m_target->Compare(best.Calculate()), best.CurrentMaxLevel(), best.FunctionsCount(),
+                                  best.UniqueFunctions());
+    }
+
+    /// @brief Values of a candidate tree, with unary chains looked up in their tables
+    std::span<const FuncValue_t> Values(FN_t& fnc) const
+    {
+        return m_chains ? fnc.Calculate(*m_chains) : fnc.Calculate();
+    }
+
+    /// @brief Values of a candidate evaluated its own way, e.g. a DAG program
+    template <typename Candidate_t>
+    static std::span<const FuncValue_t> Values(Candidate_t& fnc)
+    {
+        return fnc.Calculate();
+    }
+
+    /// @brief Intern a candidate tree for the best list
+    Shared_t Share(FN_t& fnc) { return Shared_t{m_store, fnc}; }
+
+    /// @brief Candidate already interned, e.g. a DAG program
+    static const Shared_t& Share(const Shared_t& fnc) { return fnc; }
+
+    /// @brief Build a FuncNode copy of a best-list entry
+    FN_t Materialize(const Shared_t& best) const
+    {
+        FN_t fnc{m_atoms};
+        best.ToTree(fnc);
+        return fnc;
     }
 
     /**
      * @brief Evaluate and potentially add function to best list
-     * @param fnc Candidate function tree
+     * @param fnc Candidate function tree, FN_t or an already interned Shared_t
      * @param max_best Maximum size of best list
      * 
      * Algorithm:
@@ -457,17 +1392,24 @@ class SearchTask
      * 4. Insert in sorted position
      * 5. Trim list if exceeds max_best
      * 6. Update distance threshold
+     *
+     * Entries are hash-consed in m_store, so inserting copies only the
+     * nodes not yet shared and moving entries around is O(1).
+     *
+     * With a score from a complete tiled evaluation the candidate is not
+     * compared again, and its values are calculated only to insert it.
      */
-    void CheckBest(FN_t& fnc, std::size_t max_best = 10)
+    template <typename Candidate_t>
+    void CheckBest(Candidate_t& fnc, std::size_t max_best = 10, const TiledScore* score = nullptr)
     {
         if (m_best.empty()) {
-            m_best.push_back(fnc);
+            m_best.push_back(Share(fnc));
             return;
         }
 
-        const auto fnc_calc = fnc.Calculate();
-        const auto fnc_ranges = m_target->MatchPositions(fnc_calc);
-        const auto new_dist = CalcDist(fnc);
+        const auto fnc_ranges =
+            (score != nullptr) ? score->mask.ToRangeSet() : m_target->MatchPositions(Values(fnc));
+        const auto new_dist = (score != nullptr) ? Suitability(fnc, score->distance) : CalcDist(fnc);
         if (m_best.size() >= max_best) {
             if (new_dist > m_suit_threshold) {
                 return;
@@ -479,11 +1421,12 @@ class SearchTask
             const auto dist = CalcDist(*best_it);
             if (new_dist < dist) {
                 // Check for uniqueness to avoid duplicates
+                const auto fnc_calc = Values(fnc);
                 bool unique_values = true;
-                for (auto& b : m_best) {
-                    const auto b_calc = b.Calculate();
+                for (const auto& b : m_best) {
+                    const auto& b_calc = b.Calculate();
                     const auto b_ranges = m_target->MatchPositions(b_calc);
-                    if (b_calc == fnc_calc) {
+                    if (std::ranges::equal(b_calc, fnc_calc)) {
                         unique_values = false;
                         break;
                     }
@@ -495,7 +1438,7 @@ class SearchTask
                 if (not unique_values) {
                     break;
                 }
-                m_best.insert(best_it, fnc);
+                m_best.insert(best_it, Share(fnc));
                 break;
             }
             ++best_it;
@@ -542,20 +1485,66 @@ class SearchTask
      * @return true if iteration successful, false if search complete
      * 
      * This is the core search operation:
-     * 1. Advance to next function
-     * 2. Evaluate against target
-     * 3. Update best list if warranted
-     * 4. Increment iteration counter
+     * 1. Advance to next function (in depth, size or best-first order, or draw a random one in sampling mode)
+     * 2. Solve target as a GF(2)-affine map of the function, if enabled
+     * 3. Reject by tiled evaluation or bounded compare on probe samples, if enabled
+     * 4. Evaluate against target
+     * 5. Update best list if warranted
+     * 6. Increment iteration counter
      * 
      * Protected by mutex for thread safety when called from Search().
      */
     bool SearchIterate()
     {
         const std::unique_lock lock{m_mtx};
-        if (not m_fn.Iterate(m_settings.max_depth)) {
+        if (not m_rejected.empty()) {
+            return false;
+        }
+        if (m_settings.dag_steps > 0) {
+            if (not m_dag.Iterate(m_settings.dag_steps)) {
+                return false;
+            }
+            CheckProgram(m_dag);
+            ++m_count;
+            return true;
+        }
+        if (m_settings.shape_first) {
+            if (not NextShaped()) {
+                return false;
+            }
+            CheckProgram(*m_shape_labels);
+            ++m_count;
+            return true;
+        }
+        if (m_settings.bottom_up) {
+            if (not NextBanked()) {
+                return false;
+            }
+            CheckProgram(*m_bank);
+            ++m_count;
+            return true;
+        }
+        if (not Advance()) {
             return false;
         }
-        CheckBest(m_fn, m_settings.max_best);
+        if (m_settings.random_sampling and m_fn.Pruned()) {
+            // Redrawn on the next iteration, sampling never runs out of trees
+            ++m_sample_rejected;
+            return true;
+        }
+        if (not m_affine_positions.empty()) {
+            AffineCheck(Values(m_fn), m_fn.Repr());
+        }
+        // The list is full exactly when TiledReject() or a streamed ProbeReject() scores the candidate,
+        // otherwise it gets full values there or in CheckBest().
+        const bool scored = (m_tiled_enabled or m_probe_streamed) and (m_best.size() >= m_settings.max_best);
+        const bool rejected = m_tiled_enabled ? TiledReject(m_fn) : ProbeReject(m_fn);
+        if (not scored) {
+            m_evaluated_samples += m_target->Size();
+        }
+        if (not rejected) {
+            CheckBest(m_fn, m_settings.max_best, scored ? &m_tiled_score : nullptr);
+        }
         ++m_count;
         return true;
     }
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+namespace fw
+{
+
+/// @addtogroup Common
+/// @{
+
+/**
+ * @class BigSerialNumber
+ * @brief Arbitrary-precision unsigned serial number
+ *
+ * The number of trees grows doubly exponentially with depth, so serial
+ * numbers of deep searches do not fit any fixed-width integer. This type
+ * never overflows and can be passed as the SN_t template parameter of
+ * FuncNode and SearchTask; the default SerialNumber_t stays the fast path
+ * when the space fits.
+ *
+ * Stored as little-endian 32-bit limbs without leading zero limbs.
+ */
+class BigSerialNumber
+{
+   public:
+    BigSerialNumber() = default;
+
+    /// @brief Construct from a non-negative integer
+    template <std::integral T>
+    // NOLINTNEXTLINE(google-explicit-constructor, hicpp-explicit-conversions)
+    BigSerialNumber(T value)
+    {
+        assert(value >= 0);
+        auto rest = static_cast<unsigned __int128>(value);
+        while (rest != 0) {
+            m_limbs.push_back(static_cast<uint32_t>(rest));
+            rest >>= LIMB_BITS;
+        }
+    }
+
+    /// @brief Construct from __int128 (not covered by std::integral in strict mode)
+    // NOLINTNEXTLINE(google-explicit-constructor, hicpp-explicit-conversions)
+    BigSerialNumber(__int128 value) : BigSerialNumber(static_cast<uint64_t>(value >> 64U))
+    {
+        assert(value >= 0);
+        *this = (*this << 64U) + BigSerialNumber(static_cast<uint64_t>(value));
+    }
+
+    /// @brief Number of significant bits
+    [[nodiscard]] std::size_t BitWidth() const
+    {
+        if (m_limbs.empty()) {
+            return 0;
+        }
+        return ((m_limbs.size() - 1) * LIMB_BITS) + static_cast<std::size_t>(std::bit_width(m_limbs.back()));
+    }
+
+    /// @brief Low bits of the number (caller checks BitWidth() for range)
+    template <std::integral T>
+    explicit operator T() const
+    {
+        uint64_t low = 0;
+        for (std::size_t i = 0; (i < m_limbs.size()) and (i < 2); ++i) {
+            low |= static_cast<uint64_t>(m_limbs[i]) << (i * LIMB_BITS);
+        }
+        return static_cast<T>(low);
+    }
+
+    /// @brief Approximate floating-point value (for progress and rates)
+    explicit operator long double() const
+    {
+        long double res = 0;
+        for (auto it = m_limbs.rbegin(); it != m_limbs.rend(); ++it) {
+            res = (res * LIMB_BASE) + static_cast<long double>(*it);
+        }
+        return res;
+    }
+
+    /// @brief Decimal representation
+    [[nodiscard]] std::string ToString() const
+    {
+        if (m_limbs.empty()) {
+            return "0";
+        }
+        std::string res;
+        auto rest = *this;
+        while (not rest.m_limbs.empty()) {
+            const auto digit = rest.DivSmall(10);
+            res.push_back(static_cast<char>('0' + digit));
+        }
+        std::ranges::reverse(res);
+        return res;
+    }
+
+    /**
+     * @brief Parse decimal representation
+     * @param str Decimal digits
+     * @param value Parsed number
+     * @return true if successful, false on error
+     */
+    static bool FromString(std::string_view str, BigSerialNumber& value)
+    {
+        if (str.empty()) {
+            return false;
+        }
+        value = {};
+        for (const char c : str) {
+            if ((c < '0') or (c > '9')) {
+                return false;
+            }
+            value = (value * 10U) + static_cast<uint32_t>(c - '0');
+        }
+        return true;
+    }
+
+    friend bool operator==(const BigSerialNumber& a, const BigSerialNumber& b) = default;
+
+    friend std::strong_ordering operator<=>(const BigSerialNumber& a, const BigSerialNumber& b)
+    {
+        if (a.m_limbs.size() != b.m_limbs.size()) {
+            return a.m_limbs.size() <=> b.m_limbs.size();
+        }
+        return std::lexicographical_compare_three_way(a.m_limbs.rbegin(), a.m_limbs.rend(), b.m_limbs.rbegin(),
+                                                      b.m_limbs.rend());
+    }
+
+    friend BigSerialNumber operator+(const BigSerialNumber& a, const BigSerialNumber& b)
+    {
+        BigSerialNumber res;
+        res.m_limbs.resize(std::max(a.m_limbs.size(), b.m_limbs.size()) + 1);
+        uint64_t carry = 0;
+        for (std::size_t i = 0; i < res.m_limbs.size(); ++i) {
+            carry += static_cast<uint64_t>(a.Limb(i)) + b.Limb(i);
+            res.m_limbs[i] = static_cast<uint32_t>(carry);
+            carry >>= LIMB_BITS;
+        }
+        res.Trim();
+        return res;
+    }
+
+    /// @pre a >= b
+    friend BigSerialNumber operator-(const BigSerialNumber& a, const BigSerialNumber& b)
+    {
+        assert(a >= b);
+        BigSerialNumber res;
+        res.m_limbs.resize(a.m_limbs.size());
+        int64_t borrow = 0;
+        for (std::size_t i = 0; i < res.m_limbs.size(); ++i) {
+            int64_t diff = static_cast<int64_t>(a.Limb(i)) - b.Limb(i) - borrow;
+            borrow = (diff < 0) ? 1 : 0;
+            diff += borrow * static_cast<int64_t>(LIMB_BASE);
+            res.m_limbs[i] = static_cast<uint32_t>(diff);
+        }
+        res.Trim();
+        return res;
+    }
+
+    friend BigSerialNumber operator*(const BigSerialNumber& a, const BigSerialNumber& b)
+    {
+        if (a.m_limbs.empty() or b.m_limbs.empty()) {
+            return {};
+        }
+        BigSerialNumber res;
+        res.m_limbs.resize(a.m_limbs.size() + b.m_limbs.size());
+        for (std::size_t i = 0; i < a.m_limbs.size(); ++i) {
+            uint64_t carry = 0;
+            for (std::size_t j = 0; j < b.m_limbs.size(); ++j) {
+                carry += (static_cast<uint64_t>(a.m_limbs[i]) * b.m_limbs[j]) + res.m_limbs[i + j];
+                res.m_limbs[i + j] = static_cast<uint32_t>(carry);
+                carry >>= LIMB_BITS;
+            }
+            res.m_limbs[i + b.m_limbs.size()] = static_cast<uint32_t>(carry);
+        }
+        res.Trim();
+        return res;
+    }
+
+    friend BigSerialNumber operator/(const BigSerialNumber& a, const BigSerialNumber& b)
+    {
+        BigSerialNumber quot;
+        BigSerialNumber rem;
+        DivMod(a, b, quot, rem);
+        return quot;
+    }
+
+    friend BigSerialNumber operator%(const BigSerialNumber& a, const BigSerialNumber& b)
+    {
+        BigSerialNumber quot;
+        BigSerialNumber rem;
+        DivMod(a, b, quot, rem);
+        return rem;
+    }
+
+    friend BigSerialNumber operator<<(const BigSerialNumber& a, std::size_t shift)
+    {
+        if (a.m_limbs.empty()) {
+            return {};
+        }
+        const auto limbs = shift / LIMB_BITS;
+        const auto bits = shift % LIMB_BITS;
+        BigSerialNumber res;
+        res.m_limbs.assign(a.m_limbs.size() + limbs + 1, 0);
+        for (std::size_t i = 0; i < a.m_limbs.size(); ++i) {
+            const auto wide = static_cast<uint64_t>(a.m_limbs[i]) << bits;
+            res.m_limbs[i + limbs] |= static_cast<uint32_t>(wide);
+            res.m_limbs[i + limbs + 1] |= static_cast<uint32_t>(wide >> LIMB_BITS);
+        }
+        res.Trim();
+        return res;
+    }
+
+    BigSerialNumber& operator+=(const BigSerialNumber& other) { return (*this = *this + other); }
+    BigSerialNumber& operator-=(const BigSerialNumber& other) { return (*this = *this - other); }
+    BigSerialNumber& operator*=(const BigSerialNumber& other) { return (*this = *this * other); }
+
+    /// @brief Hash of the number
+    [[nodiscard]] std::size_t Hash() const
+    {
+        std::size_t h = m_limbs.size();
+        for (const auto limb : m_limbs) {
+            h = (h * 0x100000001B3ULL) ^ limb;
+        }
+        return h;
+    }
+
+   private:
+    static constexpr std::size_t LIMB_BITS = 32;
+    static constexpr long double LIMB_BASE = 4294967296.0L;
+
+    std::vector<uint32_t> m_limbs;  ///< Little-endian limbs
+
+    [[nodiscard]] uint32_t Limb(std::size_t i) const { return (i < m_limbs.size()) ? m_limbs[i] : 0; }
+
+    void Trim()
+    {
+        while ((not m_limbs.empty()) and (m_limbs.back() == 0)) {
+            m_limbs.pop_back();
+        }
+    }
+
+    /// @brief Divide in place by a single limb, return remainder
+    uint32_t DivSmall(uint32_t divisor)
+    {
+        uint64_t rem = 0;
+        for (auto it = m_limbs.rbegin(); it != m_limbs.rend(); ++it) {
+            const auto cur = (rem << LIMB_BITS) | *it;
+            *it = static_cast<uint32_t>(cur / divisor);
+            rem = cur % divisor;
+        }
+        Trim();
+        return static_cast<uint32_t>(rem);
+    }
+
+    /// @brief Binary long division
+    static void DivMod(const BigSerialNumber& a, const BigSerialNumber& b, BigSerialNumber& quot,
+                       BigSerialNumber& rem)
+    {
+        assert(not b.m_limbs.empty());
+        quot = {};
+        rem = {};
+        if (b.m_limbs.size() == 1) {
+            quot = a;
+            rem = quot.DivSmall(b.m_limbs[0]);
+            return;
+        }
+        if (a < b) {
+            rem = a;
+            return;
+        }
+
+        const auto bits = a.BitWidth();
+        quot.m_limbs.assign(a.m_limbs.size(), 0);
+        for (std::size_t bit = bits; bit-- > 0;) {
+            rem = rem << 1U;
+            if (((a.m_limbs[bit / LIMB_BITS] >> (bit % LIMB_BITS)) & 1U) != 0) {
+                rem = rem + 1U;
+            }
+            if (rem >= b) {
+                rem -= b;
+                quot.m_limbs[bit / LIMB_BITS] |= uint32_t{1} << (bit % LIMB_BITS);
+            }
+        }
+        quot.Trim();
+    }
+};
+
+/**
+ * @brief Overflow-checked addition of serial numbers
+ * @return true if the result is exact, false on overflow
+ */
+inline bool CheckedAdd(SerialNumber_t a, SerialNumber_t b, SerialNumber_t& res)
+{
+    return not __builtin_add_overflow(a, b, &res);
+}
+
+/**
+ * @brief Overflow-checked multiplication of serial numbers
+ * @return true if the result is exact, false on overflow
+ */
+inline bool CheckedMul(SerialNumber_t a, SerialNumber_t b, SerialNumber_t& res)
+{
+    return not __builtin_mul_overflow(a, b, &res);
+}
+
+inline bool CheckedAdd(const BigSerialNumber& a, const BigSerialNumber& b, BigSerialNumber& res)
+{
+    res = a + b;
+    return true;
+}
+
+inline bool CheckedMul(const BigSerialNumber& a, const BigSerialNumber& b, BigSerialNumber& res)
+{
+    res = a * b;
+    return true;
+}
+
+/**
+ * @brief Convert serial number to the fixed-width type used in status reports
+ * @param sn Serial number
+ * @param res Converted value
+ * @return true if the value fits, false otherwise
+ */
+inline bool ToSerialNumber128(SerialNumber_t sn, SerialNumber_t& res)
+{
+    res = sn;
+    return true;
+}
+
+inline bool ToSerialNumber128(const BigSerialNumber& sn, SerialNumber_t& res)
+{
+    constexpr std::size_t MAX_BITS = 126;
+    if (sn.BitWidth() > MAX_BITS) {
+        return false;
+    }
+    const auto low = static_cast<uint64_t>(sn);
+    const auto high = static_cast<uint64_t>(sn / (BigSerialNumber(1) << 64U));
+    res = (static_cast<SerialNumber_t>(high) << 64U) | low;
+    return true;
+}
+
+/// @brief Number of significant bits of a serial number
+inline std::size_t SerialNumberBitWidth(SerialNumber_t sn)
+{
+    const auto high = static_cast<uint64_t>(sn >> 64U);
+    if (high != 0) {
+        return 64 + static_cast<std::size_t>(std::bit_width(high));
+    }
+    return static_cast<std::size_t>(std::bit_width(static_cast<uint64_t>(sn)));
+}
+
+inline std::size_t SerialNumberBitWidth(const BigSerialNumber& sn) { return sn.BitWidth(); }
+
+/**
+ * @brief Draw a uniformly distributed serial number
+ * @param rng 64-bit random engine
+ * @param bound Exclusive upper bound (positive)
+ * @return Serial number in [0, bound)
+ *
+ * Draws as many random bits as the bound has and rejects draws that are
+ * out of range, so fewer than two draws are needed on average.
+ */
+template <typename SN_t, typename Rng>
+SN_t RandomSerialNumber(Rng& rng, const SN_t& bound)
+{
+    constexpr std::size_t CHUNK_BITS = 32;
+    assert(bound > SN_t{});
+    const auto bits = SerialNumberBitWidth(bound);
+    while (true) {
+        SN_t res{};
+        for (std::size_t left = bits; left > 0;) {
+            const auto take = std::min(left, CHUNK_BITS);
+            const auto chunk = static_cast<uint32_t>(rng()) >> (CHUNK_BITS - take);
+            res = (res * SN_t(uint64_t{1} << take)) + SN_t(chunk);
+            left -= take;
+        }
+        if (res < bound) {
+            return res;
+        }
+    }
+}
+
+/// @brief Serial number as floating point, for progress ratios
+inline long double SerialNumberToFloat(SerialNumber_t sn) { return static_cast<long double>(sn); }
+
+inline long double SerialNumberToFloat(const BigSerialNumber& sn) { return static_cast<long double>(sn); }
+
+/// @} // end of Common group
+
+}  // namespace fw
+
+template <>
+struct std::hash<fw::BigSerialNumber>
+{
+    std::size_t operator()(const fw::BigSerialNumber& sn) const noexcept { return sn.Hash(); }
+};
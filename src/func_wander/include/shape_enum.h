@@ -0,0 +1,561 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <format>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "func_node.h"
+#include "value_pool.h"
+
+namespace fw
+{
+
+/// @addtogroup FunctionNodes
+/// @{
+
+/// Arity skeleton of a tree in preorder
+using TreeShape = std::vector<uint8_t>;
+
+/**
+ * @class TreeShapes
+ * @brief Count and unrank arity skeletons (tree shapes) by depth
+ *
+ * Shapes follow the canonical depth rule of FuncNode serial numbers: a
+ * shape of depth d is a unary node over a shape of depth d-1, or a
+ * binary node whose second operand has depth d-1 and first operand any
+ * depth < d. They are ordered by depth, like Iterate() visits trees, and
+ * unranked on demand, so only counts per depth are stored.
+ */
+class TreeShapes
+{
+   public:
+    /**
+     * @brief Precompute shape counts for all depths
+     * @param max_depth Maximum depth of shapes
+     */
+    explicit TreeShapes(std::size_t max_depth)
+    {
+        m_exact.push_back(1);
+        m_total.push_back(1);
+        for (std::size_t d = 1; d <= max_depth; ++d) {
+            std::size_t exact = 0;
+            std::size_t total = 0;
+            if (__builtin_mul_overflow(m_total[d - 1], m_exact[d - 1], &exact) or
+                __builtin_add_overflow(exact, m_exact[d - 1], &exact) or
+                __builtin_add_overflow(m_total[d - 1], exact, &total)) {
+                m_fits = false;
+                return;
+            }
+            m_exact.push_back(exact);
+            m_total.push_back(total);
+        }
+    }
+
+    /// @brief Check if all counts fit std::size_t
+    [[nodiscard]] bool Fits() const { return m_fits; }
+
+    /// @brief Number of shapes up to the maximum depth
+    [[nodiscard]] std::size_t Count() const { return m_total.back(); }
+
+    /**
+     * @brief Build shape from its position in depth order
+     * @param index Position, less than Count()
+     * @return Shape in preorder
+     */
+    [[nodiscard]] TreeShape Unrank(std::size_t index) const
+    {
+        assert(m_fits and (index < Count()));
+        TreeShape shape;
+        UnrankTotal(m_total.size() - 1, index, shape);
+        return shape;
+    }
+
+   private:
+    std::vector<std::size_t> m_exact;  ///< Shapes of depth exactly d
+    std::vector<std::size_t> m_total;  ///< Shapes of depth ≤ d
+    bool m_fits = true;                ///< All counts fit std::size_t
+
+    void UnrankTotal(std::size_t max_depth, std::size_t index, TreeShape& shape) const
+    {
+        std::size_t depth = 0;
+        while (index >= m_total[depth]) {
+            ++depth;
+        }
+        assert(depth <= max_depth);
+        UnrankExact(depth, index - ((depth > 0) ? m_total[depth - 1] : 0), shape);
+    }
+
+    void UnrankExact(std::size_t depth, std::size_t index, TreeShape& shape) const
+    {
+        if (depth == 0) {
+            shape.push_back(0);
+            return;
+        }
+        if (index < m_exact[depth - 1]) {
+            shape.push_back(1);
+            UnrankExact(depth - 1, index, shape);
+            return;
+        }
+        index -= m_exact[depth - 1];
+
+        // Second operand major, as in serial numbers.
+        shape.push_back(2);
+        UnrankTotal(depth - 1, index % m_total[depth - 1], shape);
+        UnrankExact(depth - 1, index / m_total[depth - 1], shape);
+    }
+};
+
+/**
+ * @class ShapeLabels
+ * @brief Enumeration of atom labels over a fixed tree shape
+ * @tparam FuncValue_t Type of function values
+ * @tparam SKIP_CONSTANT Whether to skip constant expressions
+ * @tparam SKIP_SYMMETRIC Whether to skip symmetric duplicates for commutative ops
+ *
+ * Labels follow a flat mixed-radix counter in preorder, the radix of a
+ * node being the number of atoms of its arity. The root is the fastest
+ * digit: after bumping digit k, at most nodes 0..k changed (digits below
+ * k wrapped to 0). Changed nodes and their ancestors are marked dirty
+ * and re-evaluated in reverse preorder, children before their parent.
+ * Values of all nodes live in one ValuePool allocated once per shape,
+ * a cache-line-aligned slot per preorder position.
+ *
+ * In gray order the labels are the reflected mixed-radix Gray code of
+ * the counter: digit i runs down instead of up when the labels above it
+ * have odd sum, so consecutive labellings differ in exactly one node and
+ * each step re-evaluates one root path. The code is a bijection between
+ * blocks of equal high digits, so pruning skips work the same way, and
+ * labels map back to the counter without extra state.
+ *
+ * A node is pruned by its own subtree only, so a pruned node k skips the
+ * counter straight to the next value of digit k:
+ * - all leaves constant or constant values (SKIP_CONSTANT);
+ * - operands of a commutative atom out of (shape, labels) order (SKIP_SYMMETRIC).
+ *
+ * Shapes are independent of each other, so each can run as a separate job.
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false>
+class ShapeLabels
+{
+   public:
+    /// Vector type for function values
+    using FuncValues_t = std::vector<FuncValue_t>;
+
+    /**
+     * @brief Prepare counter and value buffer for a shape
+     * @param atoms Pointer to atomic function library
+     * @param shape Arity skeleton in preorder
+     * @param gray Visit labels in reflected Gray order instead of counter order
+     * @param huge_pages Back the value buffer by huge pages where possible
+     */
+    ShapeLabels(const AtomFuncs<FuncValue_t>* atoms, TreeShape shape, bool gray = false, bool huge_pages = false)
+        : m_atoms(atoms),
+          m_shape(std::move(shape)),
+          m_labels(m_shape.size()),
+          m_counter(m_shape.size()),
+          m_radix(m_shape.size()),
+          m_gray(gray)
+    {
+        m_samples = m_atoms->arg0.front()->Calculate().size();
+        m_buffer = ValuePool<FuncValue_t>(m_shape.size(), m_samples, huge_pages);
+        m_end.resize(m_shape.size());
+        m_depth.resize(m_shape.size());
+        m_parent.assign(m_shape.size(), NONE);
+        for (std::size_t i = m_shape.size(); i > 0; --i) {
+            const auto node = i - 1;
+            m_radix[node] = (m_shape[node] == 0) ? m_atoms->arg0.size()
+                            : (m_shape[node] == 1) ? m_atoms->arg1.size()
+                                                   : m_atoms->arg2.size();
+            m_end[node] = node + 1;
+            if (m_shape[node] >= 1) {
+                m_end[node] = m_end[node + 1];
+                m_depth[node] = m_depth[node + 1] + 1;
+                m_parent[node + 1] = node;
+            }
+            if (m_shape[node] == 2) {
+                m_parent[m_end[node + 1]] = node;
+                m_end[node] = m_end[m_end[node + 1]];
+                m_depth[node] = std::max(m_depth[node + 1], m_depth[m_end[node + 1]]) + 1;
+            }
+        }
+        m_const.resize(m_shape.size());
+        MarkAll();
+    }
+
+    /// @brief Get shape in preorder
+    [[nodiscard]] const TreeShape& Shape() const { return m_shape; }
+
+    /// @brief Get atom labels in preorder
+    [[nodiscard]] const std::vector<std::size_t>& Labels() const { return m_labels; }
+
+    /// @brief Get value buffer of all nodes
+    [[nodiscard]] const ValuePool<FuncValue_t>& Buffer() const { return m_buffer; }
+
+    /**
+     * @brief Position counter at saved labels
+     * @param labels Labels of the last visited tree, see Labels()
+     * @return true if successful, false if labels do not fit the shape
+     */
+    bool SetLabels(const std::vector<std::size_t>& labels)
+    {
+        if (labels.size() != m_labels.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < labels.size(); ++i) {
+            if (labels[i] >= m_radix[i]) {
+                return false;
+            }
+        }
+        m_labels = labels;
+        std::size_t parity = 0;
+        for (std::size_t i = m_labels.size(); i > 0; --i) {
+            const auto node = i - 1;
+            m_counter[node] = (m_gray and ((parity & 1U) != 0)) ? (m_radix[node] - 1 - m_labels[node]) : m_labels[node];
+            parity += m_labels[node];
+        }
+        MarkAll();
+        m_started = true;
+        return true;
+    }
+
+    /**
+     * @brief Position counter at a tree, the inverse of ToTree()
+     * @param fnc Tree of this shape, e.g. built from a serial number
+     * @return true if successful, false if the tree has another shape
+     */
+    template <typename FN_t>
+    bool FromTree(const FN_t& fnc)
+    {
+        std::vector<std::size_t> labels;
+        labels.reserve(m_shape.size());
+        if (not Preorder(fnc, labels)) {
+            return false;
+        }
+        return SetLabels(labels);
+    }
+
+    /**
+     * @brief Advance to next labelling that is not pruned
+     * @return true if next labelling exists, false if the shape is exhausted
+     */
+    bool Next()
+    {
+        std::size_t digit = 0;
+        if (not m_started) {
+            m_started = true;
+            if (std::ranges::find(m_radix, 0) != m_radix.end()) {
+                return false;
+            }
+        }
+        else if (not Bump(0)) {
+            return false;
+        }
+        while (true) {
+            digit = Pruned();
+            if (digit == NONE) {
+                return true;
+            }
+            if (not Bump(digit)) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief Calculate function values for all inputs
+     * @return Values of the root
+     */
+    const FuncValues_t& Calculate()
+    {
+        Evaluate(0);
+        const auto root = NodeValues(0);
+        m_root.assign(root.begin(), root.end());
+        return m_root;
+    }
+
+    /**
+     * @brief Position in the label space of this shape
+     * @return Fraction of labellings enumerated before the current one
+     */
+    [[nodiscard]] long double Progress() const
+    {
+        long double rank = 0;
+        long double total = 1;
+        for (std::size_t i = m_labels.size(); i > 0; --i) {
+            rank = (rank * static_cast<long double>(m_radix[i - 1])) + static_cast<long double>(m_counter[i - 1]);
+            total *= static_cast<long double>(m_radix[i - 1]);
+        }
+        return rank / total;
+    }
+
+    /// @brief Get string representation in FuncNode::Repr() format
+    [[nodiscard]] std::string Repr() const
+    {
+        std::size_t pos = 0;
+        return NodeRepr(pos);
+    }
+
+    /**
+     * @brief Build equivalent tree
+     * @param fnc Tree rebuilt in place; unchanged subtrees keep cached values
+     */
+    template <typename FN_t>
+    void ToTree(FN_t& fnc) const
+    {
+        std::size_t pos = 0;
+        Build(fnc, pos);
+    }
+
+   private:
+    static constexpr std::size_t NONE = SIZE_MAX;
+
+    const AtomFuncs<FuncValue_t>* m_atoms = nullptr;  ///< Atomic function library
+    TreeShape m_shape;                                ///< Arities in preorder
+    std::vector<std::size_t> m_labels;                ///< Atom index per node
+    std::vector<std::size_t> m_counter;               ///< Mixed-radix digits, equal to labels unless gray
+    std::vector<std::size_t> m_radix;                 ///< Number of atoms per node
+    std::vector<std::size_t> m_end;                   ///< End of the subtree per node in preorder
+    std::vector<std::size_t> m_parent;                ///< Parent per node (NONE for the root)
+    std::vector<uint8_t> m_dirty;                     ///< Subtree changed since last evaluated
+    std::vector<std::size_t> m_depth;                 ///< Depth of the subtree per node
+    std::vector<uint8_t> m_const;                     ///< Subtree has constant leaves only
+    std::size_t m_samples = 0;                        ///< Number of samples
+    ValuePool<FuncValue_t> m_buffer;                  ///< Values of all nodes, one aligned slot per node
+    FuncValues_t m_root;                              ///< Copy of root values for Calculate()
+    std::size_t m_stale = 0;                          ///< Dirty nodes are below this index
+    bool m_gray = false;                              ///< Labels in reflected Gray order
+    bool m_started = false;                           ///< First labelling was visited
+
+    [[nodiscard]] std::span<FuncValue_t> NodeValues(std::size_t node)
+    {
+        return m_buffer.Slot(node);
+    }
+
+    /**
+     * @brief Increment counter at a digit, lower digits reset to 0
+     * @return true if incremented, false on overflow of the last digit
+     */
+    bool Bump(std::size_t digit)
+    {
+        std::fill_n(m_counter.begin(), digit, 0);
+        for (std::size_t k = digit; k < m_counter.size(); ++k) {
+            if (++m_counter[k] < m_radix[k]) {
+                Relabel(k);
+                return true;
+            }
+            m_counter[k] = 0;
+        }
+        return false;
+    }
+
+    /// @brief Update labels of digits 0..top from the counter and mark changed nodes
+    void Relabel(std::size_t top)
+    {
+        std::size_t parity = 0;
+        if (m_gray) {
+            for (std::size_t j = top + 1; j < m_labels.size(); ++j) {
+                parity += m_labels[j];
+            }
+        }
+        for (std::size_t i = top + 1; i > 0; --i) {
+            const auto node = i - 1;
+            const auto label = ((parity & 1U) != 0) ? (m_radix[node] - 1 - m_counter[node]) : m_counter[node];
+            if (label != m_labels[node]) {
+                m_labels[node] = label;
+                Mark(node);
+            }
+            if (m_gray) {
+                parity += label;
+            }
+        }
+    }
+
+    /// @brief Mark a node and its ancestors dirty
+    void Mark(std::size_t node)
+    {
+        m_stale = std::max(m_stale, node + 1);
+        while ((node != NONE) and (m_dirty[node] == 0)) {
+            m_dirty[node] = 1;
+            node = m_parent[node];
+        }
+    }
+
+    void MarkAll()
+    {
+        m_dirty.assign(m_shape.size(), 1);
+        m_stale = m_shape.size();
+    }
+
+    /// @brief Evaluate dirty nodes down to a given one in reverse preorder
+    void Evaluate(std::size_t last)
+    {
+        for (; m_stale > last; --m_stale) {
+            const auto node = m_stale - 1;
+            if (m_dirty[node] == 0) {
+                continue;
+            }
+            m_dirty[node] = 0;
+            auto out = NodeValues(node);
+            const auto label = m_labels[node];
+            switch (m_shape[node]) {
+                case 0:
+                    m_atoms->arg0[label]->CalculateTile(0, out);
+                    break;
+                case 1: {
+                    const auto* atom = m_atoms->arg1[label];
+                    const auto arg = NodeValues(node + 1);
+                    if (atom->Elementwise()) {
+                        atom->CalculateTile(arg, out);
+                    }
+                    else {
+                        std::ranges::copy(atom->Calculate(FuncValues_t(arg.begin(), arg.end())), out.begin());
+                    }
+                    break;
+                }
+                default: {
+                    const auto* atom = m_atoms->arg2[label];
+                    const auto arg1 = NodeValues(node + 1);
+                    const auto arg2 = NodeValues(m_end[node + 1]);
+                    if (atom->Elementwise()) {
+                        atom->CalculateTile(arg1, arg2, out);
+                    }
+                    else {
+                        std::ranges::copy(atom->Calculate(FuncValues_t(arg1.begin(), arg1.end()),
+                                                          FuncValues_t(arg2.begin(), arg2.end())),
+                                          out.begin());
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Compare subtrees at two nodes by shape, then by labels
+     *
+     * Operands of different depths are never swapped: the mirrored tree
+     * breaks the canonical depth rule, so neither order is a duplicate.
+     */
+    [[nodiscard]] int CompareSubtrees(std::size_t a, std::size_t b) const
+    {
+        if (m_depth[a] != m_depth[b]) {
+            return -1;
+        }
+        const auto size_a = static_cast<std::ptrdiff_t>(m_end[a] - a);
+        const auto size_b = static_cast<std::ptrdiff_t>(m_end[b] - b);
+        const auto shape_a = m_shape.begin() + static_cast<std::ptrdiff_t>(a);
+        const auto shape_b = m_shape.begin() + static_cast<std::ptrdiff_t>(b);
+        const auto shape_cmp =
+            std::lexicographical_compare_three_way(shape_a, shape_a + size_a, shape_b, shape_b + size_b);
+        if (shape_cmp != 0) {
+            return (shape_cmp < 0) ? -1 : 1;
+        }
+        const auto labels_a = m_labels.begin() + static_cast<std::ptrdiff_t>(a);
+        const auto labels_b = m_labels.begin() + static_cast<std::ptrdiff_t>(b);
+        const auto labels_cmp =
+            std::lexicographical_compare_three_way(labels_a, labels_a + size_a, labels_b, labels_b + size_a);
+        return (labels_cmp < 0) ? -1 : ((labels_cmp > 0) ? 1 : 0);
+    }
+
+    /**
+     * @brief Find the last pruned node in preorder among the dirty ones
+     * @return Index of the node, or NONE if the labelling is not pruned
+     *
+     * Clean subtrees did not change since they were last checked.
+     */
+    std::size_t Pruned()
+    {
+        for (std::size_t i = m_stale; i > 0; --i) {
+            const auto node = i - 1;
+            if (m_dirty[node] == 0) {
+                continue;
+            }
+            const auto arity = m_shape[node];
+            const auto label = m_labels[node];
+            if (SKIP_CONSTANT) {
+                m_const[node] = (arity == 0) ? uint8_t{m_atoms->arg0[label]->Constant()}
+                                             : uint8_t{(m_const[node + 1] != 0) and
+                                                       ((arity == 1) or (m_const[m_end[node + 1]] != 0))};
+                if ((arity > 0) and (m_const[node] != 0)) {
+                    return node;
+                }
+            }
+            if (SKIP_SYMMETRIC and (arity == 2) and m_atoms->arg2[label]->Commutative()) {
+                const auto cmp = CompareSubtrees(node + 1, m_end[node + 1]);
+                if (m_atoms->arg2[label]->Idempotent() ? (cmp >= 0) : (cmp > 0)) {
+                    return node;
+                }
+            }
+            if (SKIP_CONSTANT and (arity > 0)) {
+                Evaluate(node);
+                const auto values = NodeValues(node);
+                if (std::ranges::adjacent_find(values, std::ranges::not_equal_to{}) == values.end()) {
+                    return node;
+                }
+            }
+        }
+        return NONE;
+    }
+
+    /// @brief Collect labels of a tree in preorder, false if its shape differs
+    template <typename FN_t>
+    bool Preorder(const FN_t& node, std::vector<std::size_t>& labels) const
+    {
+        const auto index = labels.size();
+        if ((index >= m_shape.size()) or (node.Arity() != m_shape[index])) {
+            return false;
+        }
+        labels.push_back(node.Atom().num);
+        return ((node.Arity() < 1) or Preorder(node.Arg1(), labels)) and
+               ((node.Arity() < 2) or Preorder(node.Arg2(), labels));
+    }
+
+    [[nodiscard]] std::string NodeRepr(std::size_t& pos) const
+    {
+        const auto node = pos++;
+        const auto label = m_labels[node];
+        switch (m_shape[node]) {
+            case 0:
+                return m_atoms->arg0[label]->Str();
+            case 1: {
+                const auto arg = NodeRepr(pos);
+                return std::format("{}({})", m_atoms->arg1[label]->Str(), arg);
+            }
+            default: {
+                const auto arg1 = NodeRepr(pos);
+                const auto arg2 = NodeRepr(pos);
+                return std::format("{}({};{})", m_atoms->arg2[label]->Str(), arg1, arg2);
+            }
+        }
+    }
+
+    /**
+     * @brief Build subtree from preorder position in place
+     * @return true if the subtree changed
+     */
+    template <typename FN_t>
+    bool Build(FN_t& node, std::size_t& pos) const
+    {
+        const auto index = pos++;
+        const auto arity = m_shape[index];
+        bool changed = node.SetAtom(AtomIndex{arity, m_labels[index]});
+        if (arity >= 1) {
+            changed = Build(node.Arg1(), pos) or changed;
+        }
+        if (arity == 2) {
+            changed = Build(node.Arg2(), pos) or changed;
+        }
+        if (changed) {
+            node.ClearCalculated();
+        }
+        return changed;
+    }
+};
+
+/// @} // end of FunctionNodes group
+
+}  // namespace fw
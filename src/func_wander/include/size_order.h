@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "func_node.h"
+#include "serial_number.h"
+
+namespace fw
+{
+
+/// @addtogroup FunctionNodes
+/// @{
+
+/**
+ * @class SizeOrder
+ * @brief Enumeration of function trees ordered by cost instead of depth
+ * @tparam FuncValue_t Type of function values
+ * @tparam SKIP_CONSTANT Whether to skip constant expressions
+ * @tparam SKIP_SYMMETRIC Whether to skip symmetric duplicates for commutative ops
+ * @tparam SN_t Serial number type
+ *
+ * The cost of a tree is the sum of AtomFuncBase::Cost() over its nodes,
+ * i.e. the node count unless atoms are weighted. Small programs are the
+ * likeliest exact solutions, and depth order reaches a deep but small
+ * tree only after every wide shallower one.
+ *
+ * Let T(c) be the number of trees of cost exactly c:
+ * \[
+ * T(c) = |\{a \in A_0 : w_a = c\}| + \sum_{u \in A_1} T(c - w_u)
+ *        + \sum_{b \in A_2} \sum_{i=1}^{c - w_b - 1} T(i) \cdot T(c - w_b - i)
+ * \]
+ * Within a cost, trees are ordered by root arity and atom index, binary
+ * trees then by cost of the left operand, then by left and right operand
+ * ranks. Rank() and Unrank() map trees to positions in this order, so
+ * checkpoints and sharding work as with serial numbers.
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false,
+          typename SN_t = SerialNumber_t>
+class SizeOrder
+{
+   public:
+    using FN_t = FuncNode<FuncValue_t, SKIP_CONSTANT, SKIP_SYMMETRIC, SN_t>;
+
+    /**
+     * @brief Precompute tree counts per cost
+     * @param atoms Pointer to atomic function library
+     * @param max_cost Maximum cost of enumerated trees
+     */
+    SizeOrder(const AtomFuncs<FuncValue_t>* atoms, std::size_t max_cost) : m_atoms(atoms)
+    {
+        m_count.assign(max_cost + 1, SN_t{});
+        m_before.assign(max_cost + 2, SN_t{});
+        for (std::size_t cost = 1; cost <= max_cost; ++cost) {
+            SN_t count = LeavesOfCost(cost);
+            for (const auto* atom : m_atoms->arg1) {
+                if ((atom->Cost() < cost) and not CheckedAdd(count, m_count[cost - atom->Cost()], count)) {
+                    m_fits = false;
+                    return;
+                }
+            }
+            for (const auto* atom : m_atoms->arg2) {
+                SN_t pairs{};
+                if (not Pairs(cost, atom->Cost(), cost, pairs) or not CheckedAdd(count, pairs, count)) {
+                    m_fits = false;
+                    return;
+                }
+            }
+            m_count[cost] = count;
+            if (not CheckedAdd(m_before[cost], count, m_before[cost + 1])) {
+                m_fits = false;
+                return;
+            }
+        }
+    }
+
+    /// @brief Check if all counts fit SN_t
+    [[nodiscard]] bool Fits() const { return m_fits; }
+
+    /// @brief Number of trees up to the maximum cost
+    [[nodiscard]] SN_t Count() const { return m_before.back(); }
+
+    /// @brief Number of trees cheaper than cost
+    [[nodiscard]] SN_t CountBelow(std::size_t cost) const { return m_before[std::min(cost, m_before.size() - 1)]; }
+
+    /**
+     * @brief Position of a tree in cost order
+     * @param fnc Function tree (cost within the maximum)
+     * @return Number of trees before it
+     */
+    [[nodiscard]] SN_t Rank(const FN_t& fnc) const
+    {
+        const auto cost = fnc.Cost();
+        assert(m_fits and (cost + 1 < m_before.size()));
+        return m_before[cost] + LocalRank(fnc, cost);
+    }
+
+    /**
+     * @brief Rebuild tree from its position in cost order
+     * @param rank Position, see Rank()
+     * @param fnc Tree rebuilt in place; unchanged subtrees keep cached values
+     * @return true if successful, false if rank is beyond the maximum cost
+     */
+    bool Unrank(const SN_t& rank, FN_t& fnc) const
+    {
+        if ((not m_fits) or (rank >= Count())) {
+            return false;
+        }
+        std::size_t cost = 1;
+        while (m_before[cost + 1] <= rank) {
+            ++cost;
+        }
+        Build(fnc, cost, rank - m_before[cost]);
+        return true;
+    }
+
+    /**
+     * @brief Advance to the next tree in cost order
+     * @param fnc Current tree, replaced by the next one
+     * @param first Start from the first tree instead of the one after fnc
+     * @return true if next tree exists, false if enumeration complete
+     *
+     * Trees pruned by SKIP_CONSTANT or SKIP_SYMMETRIC are skipped.
+     */
+    bool Next(FN_t& fnc, bool first = false) const
+    {
+        SN_t rank = first ? SN_t{} : (Rank(fnc) + 1U);
+        while (Unrank(rank, fnc)) {
+            if (not fnc.Pruned()) {
+                return true;
+            }
+            rank += 1U;
+        }
+        return false;
+    }
+
+   private:
+    const AtomFuncs<FuncValue_t>* m_atoms = nullptr;  ///< Atomic function library
+    std::vector<SN_t> m_count;                        ///< T(c): trees of cost exactly c
+    std::vector<SN_t> m_before;                       ///< Trees of cost less than c
+    bool m_fits = true;                               ///< All counts fit SN_t
+
+    [[nodiscard]] SN_t LeavesOfCost(std::size_t cost, std::size_t before = SIZE_MAX) const
+    {
+        std::size_t count = 0;
+        for (std::size_t num = 0; (num < m_atoms->arg0.size()) and (num < before); ++num) {
+            if (m_atoms->arg0[num]->Cost() == cost) {
+                ++count;
+            }
+        }
+        return SN_t(count);
+    }
+
+    /**
+     * @brief Count operand pairs of a binary atom with left cost below a limit
+     * @param cost Cost of the binary tree
+     * @param atom_cost Cost of the binary atom
+     * @param left_limit Left operand costs below this are counted
+     * @param pairs Number of pairs
+     * @return true if the count fits SN_t, false on overflow
+     */
+    bool Pairs(std::size_t cost, std::size_t atom_cost, std::size_t left_limit, SN_t& pairs) const
+    {
+        pairs = {};
+        if (atom_cost + 2 > cost) {
+            return true;
+        }
+        const auto rest = cost - atom_cost;
+        for (std::size_t left = 1; (left < rest) and (left < left_limit); ++left) {
+            SN_t block{};
+            if (not CheckedMul(m_count[left], m_count[rest - left], block) or not CheckedAdd(pairs, block, pairs)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] SN_t LocalRank(const FN_t& fnc, std::size_t cost) const
+    {
+        const auto& atom = fnc.Atom();
+        if (atom.arity == 0) {
+            return LeavesOfCost(cost, atom.num);
+        }
+
+        SN_t rank = LeavesOfCost(cost);
+        const auto unary_before = (atom.arity == 1) ? atom.num : m_atoms->arg1.size();
+        for (std::size_t num = 0; num < unary_before; ++num) {
+            const auto w = m_atoms->arg1[num]->Cost();
+            if (w < cost) {
+                rank += m_count[cost - w];
+            }
+        }
+        if (atom.arity == 1) {
+            return rank + LocalRank(fnc.Arg1(), cost - m_atoms->arg1[atom.num]->Cost());
+        }
+
+        for (std::size_t num = 0; num < atom.num; ++num) {
+            SN_t pairs{};
+            Pairs(cost, m_atoms->arg2[num]->Cost(), cost, pairs);
+            rank += pairs;
+        }
+        const auto rest = cost - m_atoms->arg2[atom.num]->Cost();
+        const auto left_cost = fnc.Arg1().Cost();
+        SN_t pairs{};
+        Pairs(cost, m_atoms->arg2[atom.num]->Cost(), left_cost, pairs);
+        return rank + pairs + (LocalRank(fnc.Arg1(), left_cost) * m_count[rest - left_cost]) +
+               LocalRank(fnc.Arg2(), rest - left_cost);
+    }
+
+    /**
+     * @brief Build subtree of given cost and local rank in place
+     * @return true if the subtree changed
+     */
+    bool Build(FN_t& node, std::size_t cost, SN_t local) const
+    {
+        for (std::size_t num = 0; num < m_atoms->arg0.size(); ++num) {
+            if (m_atoms->arg0[num]->Cost() != cost) {
+                continue;
+            }
+            if (local == SN_t{}) {
+                return node.SetAtom(AtomIndex{0, num});
+            }
+            local -= 1U;
+        }
+
+        for (std::size_t num = 0; num < m_atoms->arg1.size(); ++num) {
+            const auto w = m_atoms->arg1[num]->Cost();
+            if (w >= cost) {
+                continue;
+            }
+            if (local < m_count[cost - w]) {
+                bool changed = node.SetAtom(AtomIndex{1, num});
+                changed = Build(node.Arg1(), cost - w, local) or changed;
+                if (changed) {
+                    node.ClearCalculated();
+                }
+                return changed;
+            }
+            local -= m_count[cost - w];
+        }
+
+        for (std::size_t num = 0; num < m_atoms->arg2.size(); ++num) {
+            const auto w = m_atoms->arg2[num]->Cost();
+            if (w + 2 > cost) {
+                continue;
+            }
+            const auto rest = cost - w;
+            for (std::size_t left = 1; left < rest; ++left) {
+                const SN_t block = m_count[left] * m_count[rest - left];
+                if (local < block) {
+                    bool changed = node.SetAtom(AtomIndex{2, num});
+                    changed = Build(node.Arg1(), left, local / m_count[rest - left]) or changed;
+                    changed = Build(node.Arg2(), rest - left, local % m_count[rest - left]) or changed;
+                    if (changed) {
+                        node.ClearCalculated();
+                    }
+                    return changed;
+                }
+                local -= block;
+            }
+        }
+
+        assert(false);
+        return false;
+    }
+};
+
+/// @} // end of FunctionNodes group
+
+}  // namespace fw
@@ -0,0 +1,829 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "atom.h"
+#include "func_node.h"
+#include "value_pool.h"
+
+namespace fw
+{
+
+/// @addtogroup Atoms
+/// @{
+
+/**
+ * @brief Compile-time list of atom kernels
+ * @tparam Ops Kernel types, in registration order
+ */
+template <typename... Ops>
+struct AtomList
+{
+    static constexpr std::size_t SIZE = sizeof...(Ops);  ///< Number of kernels
+};
+
+/**
+ * @brief Elementwise unary kernel: a stateless type with a static per-sample function
+ *
+ * Example:
+ * @code
+ * struct NotKernel
+ * {
+ *     static constexpr std::string_view NAME = "NOT";
+ *     static constexpr bool INVOLUTIVE = true;
+ *     static constexpr uint16_t Apply(uint16_t x) { return static_cast<uint16_t>(~x); }
+ * };
+ * @endcode
+ * An optional static CheckChars(arg_chars) restricts the arguments, as AtomFunc1::CheckChars().
+ */
+template <typename Op, typename FuncValue_t>
+concept UnaryKernel = requires(FuncValue_t x) {
+    { Op::NAME } -> std::convertible_to<std::string_view>;
+    { Op::INVOLUTIVE } -> std::convertible_to<bool>;
+    { Op::Apply(x) } -> std::convertible_to<FuncValue_t>;
+};
+
+/**
+ * @brief Elementwise binary kernel: a stateless type with a static per-sample function
+ *
+ * Needs NAME, COMMUTATIVE, IDEMPOTENT and Apply(x, y); an optional static
+ * CheckChars(arg1_chars, arg2_chars) restricts the arguments, as AtomFunc2::CheckChars().
+ */
+template <typename Op, typename FuncValue_t>
+concept BinaryKernel = requires(FuncValue_t x, FuncValue_t y) {
+    { Op::NAME } -> std::convertible_to<std::string_view>;
+    { Op::COMMUTATIVE } -> std::convertible_to<bool>;
+    { Op::IDEMPOTENT } -> std::convertible_to<bool>;
+    { Op::Apply(x, y) } -> std::convertible_to<FuncValue_t>;
+};
+
+/**
+ * @brief Runtime unary atom made from a kernel
+ * @tparam FuncValue_t Type of function values
+ * @tparam Op Unary kernel
+ */
+template <typename FuncValue_t, UnaryKernel<FuncValue_t> Op>
+class StaticAtom1 final : public AtomFunc1<FuncValue_t>
+{
+   public:
+    /// Vector type for function values
+    using FuncValues_t = std::vector<FuncValue_t>;
+
+    /// @brief Apply the kernel to each sample
+    static void Kernel(std::span<const FuncValue_t> arg, std::span<FuncValue_t> out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<FuncValue_t>(Op::Apply(arg[i]));
+        }
+    }
+
+    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg) const override
+    {
+        FuncValues_t res(arg.size());
+        Kernel(arg, res);
+        return res;
+    }
+
+    [[nodiscard]] bool CheckChars(const Characteristics<FuncValue_t>& arg_chars) const override
+    {
+        if constexpr (requires { Op::CheckChars(arg_chars); }) {
+            return Op::CheckChars(arg_chars);
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool Involutive() const override { return Op::INVOLUTIVE; }
+
+    [[nodiscard]] bool Argument() const override { return false; }
+
+    [[nodiscard]] bool Elementwise() const override { return true; }
+
+    void CalculateTile(std::span<const FuncValue_t> arg, std::span<FuncValue_t> out) const override
+    {
+        Kernel(arg, out);
+    }
+
+    [[nodiscard]] std::string Str() const override { return std::string(Op::NAME); }
+};
+
+/**
+ * @brief Runtime binary atom made from a kernel
+ * @tparam FuncValue_t Type of function values
+ * @tparam Op Binary kernel
+ */
+template <typename FuncValue_t, BinaryKernel<FuncValue_t> Op>
+class StaticAtom2 final : public AtomFunc2<FuncValue_t>
+{
+   public:
+    /// Vector type for function values
+    using FuncValues_t = std::vector<FuncValue_t>;
+
+    /// @brief Apply the kernel to each pair of samples
+    static void Kernel(std::span<const FuncValue_t> arg1, std::span<const FuncValue_t> arg2,
+                       std::span<FuncValue_t> out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<FuncValue_t>(Op::Apply(arg1[i], arg2[i]));
+        }
+    }
+
+    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
+    {
+        FuncValues_t res(arg1.size());
+        Kernel(arg1, arg2, res);
+        return res;
+    }
+
+    [[nodiscard]] bool CheckChars(const Characteristics<FuncValue_t>& arg1_chars,
+                                  const Characteristics<FuncValue_t>& arg2_chars) const override
+    {
+        if constexpr (requires { Op::CheckChars(arg1_chars, arg2_chars); }) {
+            return Op::CheckChars(arg1_chars, arg2_chars);
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool Commutative() const override { return Op::COMMUTATIVE; }
+
+    [[nodiscard]] bool Idempotent() const override { return Op::IDEMPOTENT; }
+
+    [[nodiscard]] bool Elementwise() const override { return true; }
+
+    void CalculateTile(std::span<const FuncValue_t> arg1, std::span<const FuncValue_t> arg2,
+                       std::span<FuncValue_t> out) const override
+    {
+        Kernel(arg1, arg2, out);
+    }
+
+    [[nodiscard]] std::string Str() const override { return std::string(Op::NAME); }
+};
+
+/// @brief Node patterns evaluated by one fused kernel, see StaticEvaluator
+enum class FusedPattern : uint8_t
+{
+    BinaryLeft,       ///< O(I(a, b), c)
+    BinaryRight,      ///< O(a, I(b, c))
+    UnaryLeft,        ///< O(U(a), b)
+    UnaryRight,       ///< O(a, U(b))
+    UnaryOverBinary,  ///< U(I(a, b))
+    UnaryOverUnary,   ///< U(V(a))
+    Registered,       ///< O(L(a, b), R(c, d)), registered per atom triple
+};
+
+/// Number of fused patterns
+constexpr std::size_t FUSED_PATTERNS = 7;
+
+/// @brief Pattern name for reports
+constexpr std::string_view FusedPatternName(FusedPattern pattern)
+{
+    constexpr std::array<std::string_view, FUSED_PATTERNS> NAMES = {
+        "O(I(a,b),c)", "O(a,I(b,c))", "O(U(a),b)", "O(a,U(b))", "U(I(a,b))", "U(V(a))", "O(L(a,b),R(c,d))"};
+    return NAMES[static_cast<std::size_t>(pattern)];
+}
+
+template <typename FuncValue_t, typename Unary, typename Binary>
+class StaticAtomSet;
+
+/**
+ * @class StaticAtomSet
+ * @brief Atom set fixed at compile time, with kernels dispatched by a switch over indices
+ * @tparam FuncValue_t Type of function values
+ * @tparam Unary AtomList of unary kernels
+ * @tparam Binary AtomList of binary kernels
+ *
+ * Register() adds one runtime atom per kernel to an AtomFuncs, so FuncNode,
+ * SearchTask and the other enumerators use the set unchanged. Evaluators
+ * that know the set at compile time call Apply1()/Apply2() instead of the
+ * virtual CalculateTile(): the atom index selects an inlined kernel loop
+ * through a jump table. Atoms of the AtomFuncs that do not belong to the
+ * set (leaves, or atoms added at run time) are left to virtual calls.
+ *
+ * Fused kernels evaluate two or three atoms of the set in one pass over
+ * the samples, without writing the inner results. Kernels of every pair
+ * of atoms are instantiated for the two-atom patterns (see FusedPattern);
+ * three binary atoms O(L(a, b), R(c, d)) would need a cube of them, so
+ * those triples are registered one by one with RegisterFused().
+ */
+template <typename FuncValue_t, typename... Unary, typename... Binary>
+class StaticAtomSet<FuncValue_t, AtomList<Unary...>, AtomList<Binary...>>
+{
+   public:
+    /// Operand values
+    using Arg_t = std::span<const FuncValue_t>;
+    /// Output values
+    using Out_t = std::span<FuncValue_t>;
+    /// Fused kernel of three binary atoms
+    using Kernel4_t = void (*)(Arg_t, Arg_t, Arg_t, Arg_t, Out_t);
+
+    /// Local index of an atom that is not in the set
+    static constexpr std::size_t NONE = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * @brief Add the atoms of the set to a library
+     * @param atoms Library; the kernels get consecutive indices after its current unary and binary atoms
+     *
+     * The set must outlive the library and be registered once.
+     */
+    void Register(AtomFuncs<FuncValue_t>& atoms)
+    {
+        m_first1 = atoms.arg1.size();
+        m_first2 = atoms.arg2.size();
+        std::apply([&atoms](auto&... atom) { (atoms.Add(&atom), ...); }, m_unary);
+        std::apply([&atoms](auto&... atom) { (atoms.Add(&atom), ...); }, m_binary);
+    }
+
+    /**
+     * @brief Apply a unary atom of the library if it belongs to the set
+     * @param num Index of the atom in AtomFuncs::arg1
+     * @return true if applied, false if the atom is not in the set
+     */
+    bool Apply1(std::size_t num, std::span<const FuncValue_t> arg, std::span<FuncValue_t> out) const
+    {
+        return Dispatch1(num - m_first1, arg, out, std::index_sequence_for<Unary...>{});
+    }
+
+    /**
+     * @brief Apply a binary atom of the library if it belongs to the set
+     * @param num Index of the atom in AtomFuncs::arg2
+     * @return true if applied, false if the atom is not in the set
+     */
+    bool Apply2(std::size_t num, std::span<const FuncValue_t> arg1, std::span<const FuncValue_t> arg2,
+                std::span<FuncValue_t> out) const
+    {
+        return Dispatch2(num - m_first2, arg1, arg2, out, std::index_sequence_for<Binary...>{});
+    }
+
+    /// @brief Index in the set of a unary atom of the library (NONE - not in the set)
+    [[nodiscard]] std::size_t Local1(std::size_t num) const
+    {
+        const auto idx = num - m_first1;
+        return (idx < sizeof...(Unary)) ? idx : NONE;
+    }
+
+    /// @brief Index in the set of a binary atom of the library (NONE - not in the set)
+    [[nodiscard]] std::size_t Local2(std::size_t num) const
+    {
+        const auto idx = num - m_first2;
+        return (idx < sizeof...(Binary)) ? idx : NONE;
+    }
+
+    /// @brief out = O(I(a, b), c) for binary atoms of local indices outer and inner
+    static void FuseBinaryLeft(std::size_t outer, std::size_t inner, Arg_t a, Arg_t b, Arg_t c, Out_t out)
+    {
+        static constexpr auto TABLE = Table<Kernel3_t>(
+            []<std::size_t K>() { return &BinaryLeft<Binary_t<K / NB>, Binary_t<K % NB>>; }, Seq<NB * NB>{});
+        TABLE[(outer * NB) + inner](a, b, c, out);
+    }
+
+    /// @brief out = O(a, I(b, c)) for binary atoms of local indices outer and inner
+    static void FuseBinaryRight(std::size_t outer, std::size_t inner, Arg_t a, Arg_t b, Arg_t c, Out_t out)
+    {
+        static constexpr auto TABLE = Table<Kernel3_t>(
+            []<std::size_t K>() { return &BinaryRight<Binary_t<K / NB>, Binary_t<K % NB>>; }, Seq<NB * NB>{});
+        TABLE[(outer * NB) + inner](a, b, c, out);
+    }
+
+    /// @brief out = O(U(a), b) for a binary atom outer and a unary atom inner
+    static void FuseUnaryLeft(std::size_t outer, std::size_t inner, Arg_t a, Arg_t b, Out_t out)
+    {
+        static constexpr auto TABLE = Table<Kernel2_t>(
+            []<std::size_t K>() { return &UnaryLeft<Binary_t<K / NU>, Unary_t<K % NU>>; }, Seq<NB * NU>{});
+        TABLE[(outer * NU) + inner](a, b, out);
+    }
+
+    /// @brief out = O(a, U(b)) for a binary atom outer and a unary atom inner
+    static void FuseUnaryRight(std::size_t outer, std::size_t inner, Arg_t a, Arg_t b, Out_t out)
+    {
+        static constexpr auto TABLE = Table<Kernel2_t>(
+            []<std::size_t K>() { return &UnaryRight<Binary_t<K / NU>, Unary_t<K % NU>>; }, Seq<NB * NU>{});
+        TABLE[(outer * NU) + inner](a, b, out);
+    }
+
+    /// @brief out = U(I(a, b)) for a unary atom outer and a binary atom inner
+    static void FuseUnaryOverBinary(std::size_t outer, std::size_t inner, Arg_t a, Arg_t b, Out_t out)
+    {
+        static constexpr auto TABLE = Table<Kernel2_t>(
+            []<std::size_t K>() { return &UnaryOverBinary<Unary_t<K / NB>, Binary_t<K % NB>>; }, Seq<NU * NB>{});
+        TABLE[(outer * NB) + inner](a, b, out);
+    }
+
+    /// @brief out = U(V(a)) for unary atoms of local indices outer and inner
+    static void FuseUnaryOverUnary(std::size_t outer, std::size_t inner, Arg_t a, Out_t out)
+    {
+        static constexpr auto TABLE = Table<Kernel1_t>(
+            []<std::size_t K>() { return &UnaryOverUnary<Unary_t<K / NU>, Unary_t<K % NU>>; }, Seq<NU * NU>{});
+        TABLE[(outer * NU) + inner](a, out);
+    }
+
+    /**
+     * @brief Register a fused kernel for O(L(a, b), R(c, d))
+     * @tparam O Binary kernel of the set at the top
+     * @tparam L Binary kernel of the set for the first operand
+     * @tparam R Binary kernel of the set for the second operand
+     */
+    template <typename O, typename L, typename R>
+    void RegisterFused()
+    {
+        m_fused.push_back({BinaryIndex<O>(), BinaryIndex<L>(), BinaryIndex<R>(), &Triple<O, L, R>});
+    }
+
+    /**
+     * @brief Find a registered kernel of three binary atoms
+     * @return Kernel, nullptr if not registered
+     */
+    [[nodiscard]] Kernel4_t Registered(std::size_t outer, std::size_t left, std::size_t right) const
+    {
+        const auto it = std::ranges::find_if(m_fused, [&](const Fused& fused) {
+            return (fused.outer == outer) and (fused.left == left) and (fused.right == right);
+        });
+        return (it != m_fused.end()) ? it->kernel : nullptr;
+    }
+
+   private:
+    using Kernel1_t = void (*)(Arg_t, Out_t);
+    using Kernel2_t = void (*)(Arg_t, Arg_t, Out_t);
+    using Kernel3_t = void (*)(Arg_t, Arg_t, Arg_t, Out_t);
+
+    template <std::size_t N>
+    using Seq = std::make_index_sequence<N>;
+
+    template <std::size_t K>
+    using Unary_t = std::tuple_element_t<K, std::tuple<Unary...>>;
+
+    template <std::size_t K>
+    using Binary_t = std::tuple_element_t<K, std::tuple<Binary...>>;
+
+    static constexpr std::size_t NU = sizeof...(Unary);
+    static constexpr std::size_t NB = sizeof...(Binary);
+
+    /// @brief Registered kernel of three binary atoms
+    struct Fused
+    {
+        std::size_t outer = 0;        ///< Local index of the top atom
+        std::size_t left = 0;         ///< Local index of the first operand atom
+        std::size_t right = 0;        ///< Local index of the second operand atom
+        Kernel4_t kernel = nullptr;   ///< Fused kernel
+    };
+
+    std::vector<Fused> m_fused;  ///< Registered kernels of three binary atoms
+
+    std::tuple<StaticAtom1<FuncValue_t, Unary>...> m_unary;    ///< Runtime atoms of the unary kernels
+    std::tuple<StaticAtom2<FuncValue_t, Binary>...> m_binary;  ///< Runtime atoms of the binary kernels
+    std::size_t m_first1 = 0;                                  ///< Library index of the first unary kernel
+    std::size_t m_first2 = 0;                                  ///< Library index of the first binary kernel
+
+    // A fold of index compares over a pack compiles to the same jump table as a written-out switch.
+    template <std::size_t... I>
+    static bool Dispatch1([[maybe_unused]] std::size_t idx, [[maybe_unused]] std::span<const FuncValue_t> arg,
+                          [[maybe_unused]] std::span<FuncValue_t> out, std::index_sequence<I...> /*unused*/)
+    {
+        return ((idx == I ? (StaticAtom1<FuncValue_t, Unary>::Kernel(arg, out), true) : false) or ...);
+    }
+
+    template <std::size_t... I>
+    static bool Dispatch2([[maybe_unused]] std::size_t idx, [[maybe_unused]] std::span<const FuncValue_t> arg1,
+                          [[maybe_unused]] std::span<const FuncValue_t> arg2,
+                          [[maybe_unused]] std::span<FuncValue_t> out, std::index_sequence<I...> /*unused*/)
+    {
+        return ((idx == I ? (StaticAtom2<FuncValue_t, Binary>::Kernel(arg1, arg2, out), true) : false) or ...);
+    }
+
+    /// @brief Array of kernels, element K made by make.template operator()<K>()
+    template <typename Kernel_t, typename Make, std::size_t... K>
+    static constexpr std::array<Kernel_t, sizeof...(K)> Table([[maybe_unused]] Make make,
+                                                              std::index_sequence<K...> /*unused*/)
+    {
+        return {make.template operator()<K>()...};
+    }
+
+    template <typename T>
+    static constexpr std::size_t BinaryIndex()
+    {
+        constexpr std::array<bool, NB> SAME = {std::is_same_v<T, Binary>...};
+        constexpr auto INDEX = static_cast<std::size_t>(std::ranges::find(SAME, true) - SAME.begin());
+        static_assert(INDEX < NB, "kernel is not a binary atom of the set");
+        return INDEX;
+    }
+
+    // Inner results are cast to FuncValue_t, as if stored, so fusion never changes the values.
+
+    template <typename O, typename I>
+    static void BinaryLeft(Arg_t a, Arg_t b, Arg_t c, Out_t out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<FuncValue_t>(O::Apply(static_cast<FuncValue_t>(I::Apply(a[i], b[i])), c[i]));
+        }
+    }
+
+    template <typename O, typename I>
+    static void BinaryRight(Arg_t a, Arg_t b, Arg_t c, Out_t out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<FuncValue_t>(O::Apply(a[i], static_cast<FuncValue_t>(I::Apply(b[i], c[i]))));
+        }
+    }
+
+    template <typename O, typename I>
+    static void UnaryLeft(Arg_t a, Arg_t b, Out_t out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<FuncValue_t>(O::Apply(static_cast<FuncValue_t>(I::Apply(a[i])), b[i]));
+        }
+    }
+
+    template <typename O, typename I>
+    static void UnaryRight(Arg_t a, Arg_t b, Out_t out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<FuncValue_t>(O::Apply(a[i], static_cast<FuncValue_t>(I::Apply(b[i]))));
+        }
+    }
+
+    template <typename O, typename I>
+    static void UnaryOverBinary(Arg_t a, Arg_t b, Out_t out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<FuncValue_t>(O::Apply(static_cast<FuncValue_t>(I::Apply(a[i], b[i]))));
+        }
+    }
+
+    template <typename O, typename I>
+    static void UnaryOverUnary(Arg_t a, Out_t out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<FuncValue_t>(O::Apply(static_cast<FuncValue_t>(I::Apply(a[i]))));
+        }
+    }
+
+    template <typename O, typename L, typename R>
+    static void Triple(Arg_t a, Arg_t b, Arg_t c, Arg_t d, Out_t out)
+    {
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            const auto left = static_cast<FuncValue_t>(L::Apply(a[i], b[i]));
+            const auto right = static_cast<FuncValue_t>(R::Apply(c[i], d[i]));
+            out[i] = static_cast<FuncValue_t>(O::Apply(left, right));
+        }
+    }
+};
+
+/**
+ * @class StaticEvaluator
+ * @brief Tree evaluation with the kernels of a StaticAtomSet dispatched at compile time
+ * @tparam FuncValue_t Type of function values
+ * @tparam Set StaticAtomSet registered in the library
+ *
+ * Evaluates a whole tree into a stack of cache-line-aligned buffers (one
+ * ValuePool slot per stack level) without caching node values; leaves are
+ * read in place. Atoms outside the set fall back to their virtual calls,
+ * so the result always equals FuncNode::Calculate().
+ *
+ * With fusion on, a node whose operand nodes are atoms of the set too is
+ * evaluated by one fused kernel of the set (see FusedPattern), so the
+ * values of the inner nodes are neither stored nor reloaded. Hits are
+ * counted per pattern.
+ *
+ * CalculateTile() and CalculateGather() evaluate a part of the samples
+ * only, as TiledEvaluator does; see StaticTileKernels.
+ */
+template <typename FuncValue_t, typename Set>
+class StaticEvaluator
+{
+   public:
+    /**
+     * @brief Construct evaluator
+     * @param atoms Library the set is registered in
+     * @param set Atom set
+     * @param fuse Evaluate node patterns with fused kernels
+     */
+    StaticEvaluator(const AtomFuncs<FuncValue_t>* atoms, const Set* set, bool fuse = false)
+        : m_atoms(atoms), m_set(set), m_fuse(fuse)
+    {
+        m_samples = m_atoms->arg0.front()->Calculate().size();
+    }
+
+    /**
+     * @brief Evaluate tree
+     * @param fnc Root of the tree
+     * @return Values of the tree, valid until the next call
+     */
+    template <typename FN_t>
+    std::span<const FuncValue_t> Calculate(const FN_t& fnc)
+    {
+        return CalculateRange(fnc, 0, m_samples, {});
+    }
+
+    /**
+     * @brief Evaluate tree for a contiguous tile of samples
+     * @param fnc Root of the tree, with elementwise atoms only
+     * @param first First sample of the tile
+     * @param size Samples in the tile
+     * @return Values of the tile, valid until the next call
+     */
+    template <typename FN_t>
+    std::span<const FuncValue_t> CalculateTile(const FN_t& fnc, std::size_t first, std::size_t size)
+    {
+        return CalculateRange(fnc, first, size, {});
+    }
+
+    /**
+     * @brief Evaluate tree for scattered samples
+     * @param fnc Root of the tree, with elementwise atoms only
+     * @param positions Sample positions, leaves gather their values there
+     * @return Values at the positions, valid until the next call
+     */
+    template <typename FN_t>
+    std::span<const FuncValue_t> CalculateGather(const FN_t& fnc, std::span<const std::size_t> positions)
+    {
+        return CalculateRange(fnc, 0, positions.size(), positions);
+    }
+
+    /// @brief Number of evaluated atom nodes (leaves excluded)
+    [[nodiscard]] std::size_t Nodes() const { return m_nodes; }
+
+    /// @brief Number of atom nodes evaluated inside fused kernels
+    [[nodiscard]] std::size_t FusedNodes() const { return m_fused_nodes; }
+
+    /// @brief Share of atom nodes evaluated inside fused kernels
+    [[nodiscard]] double HitRate() const
+    {
+        return (m_nodes > 0) ? (static_cast<double>(m_fused_nodes) / static_cast<double>(m_nodes)) : 0.0;
+    }
+
+    /// @brief Number of fused kernel calls of a pattern
+    [[nodiscard]] std::size_t Hits(FusedPattern pattern) const { return m_hits[static_cast<std::size_t>(pattern)]; }
+
+   private:
+    using Span_t = std::span<const FuncValue_t>;
+
+    const AtomFuncs<FuncValue_t>* m_atoms = nullptr;    ///< Atomic function library
+    const Set* m_set = nullptr;                         ///< Kernels known at compile time
+    bool m_fuse = false;                                ///< Evaluate node patterns with fused kernels
+    std::size_t m_samples = 0;                          ///< Values per tree
+    std::size_t m_first = 0;                            ///< First sample of the current evaluation
+    std::size_t m_size = 0;                             ///< Samples of the current evaluation
+    std::span<const std::size_t> m_positions;           ///< Gathered sample positions (empty - contiguous)
+    ValuePool<FuncValue_t> m_pool;                      ///< Stack of node buffers
+    std::size_t m_nodes = 0;                            ///< Evaluated atom nodes
+    std::size_t m_fused_nodes = 0;                      ///< Atom nodes inside fused kernels
+    std::array<std::size_t, FUSED_PATTERNS> m_hits{};   ///< Fused kernel calls per pattern
+
+    template <typename FN_t>
+    std::span<const FuncValue_t> CalculateRange(const FN_t& fnc, std::size_t first, std::size_t size,
+                                                std::span<const std::size_t> positions)
+    {
+        // A node at stack level s writes slot s; its operands use the slots above.
+        // Fused operands k tree levels down stay within s + 2k, as unfused ones.
+        const auto slots = (2 * fnc.CurrentMaxLevel()) + 1;
+        if ((m_pool.Slots() < slots) or (m_pool.Samples() < size)) {
+            m_pool.Reset(std::max(slots, m_pool.Slots()), std::max(size, m_pool.Samples()));
+        }
+        m_first = first;
+        m_size = size;
+        m_positions = positions;
+        return EvaluateNode(fnc, 0);
+    }
+
+    template <typename FN_t>
+    std::span<const FuncValue_t> EvaluateNode(const FN_t& fnc, std::size_t level)
+    {
+        const auto& atom = fnc.Atom();
+        const auto out = m_pool.Slot(level).first(m_size);
+        if (atom.arity == 0) {
+            // Leaves are read in place, unless gathered into their own slot.
+            if (m_positions.empty()) {
+                return Span_t(m_atoms->arg0[atom.num]->Calculate()).subspan(m_first, m_size);
+            }
+            m_atoms->arg0[atom.num]->CalculateGather(m_positions, out);
+            return out;
+        }
+        if (m_fuse and EvaluateFused(fnc, level, out)) {
+            return out;
+        }
+        ++m_nodes;
+        if (atom.arity == 1) {
+            const auto arg = EvaluateNode(fnc.Arg1(), level + 1);
+            if (not m_set->Apply1(atom.num, arg, out)) {
+                Fallback(*m_atoms->arg1[atom.num], arg, out);
+            }
+            return out;
+        }
+        const auto arg1 = EvaluateNode(fnc.Arg1(), level + 1);
+        const auto arg2 = EvaluateNode(fnc.Arg2(), level + 2);
+        if (not m_set->Apply2(atom.num, arg1, arg2, out)) {
+            Fallback(*m_atoms->arg2[atom.num], arg1, arg2, out);
+        }
+        return out;
+    }
+
+    /// @brief Local index in the set of an atom node (Set::NONE - leaf or not in the set)
+    template <typename FN_t>
+    std::size_t Local(const FN_t& fnc, std::size_t arity) const
+    {
+        const auto& atom = fnc.Atom();
+        if (atom.arity != arity) {
+            return Set::NONE;
+        }
+        return (arity == 1) ? m_set->Local1(atom.num) : m_set->Local2(atom.num);
+    }
+
+    void Hit(FusedPattern pattern, std::size_t nodes)
+    {
+        ++m_hits[static_cast<std::size_t>(pattern)];
+        m_nodes += nodes;
+        m_fused_nodes += nodes;
+    }
+
+    /**
+     * @brief Evaluate a node and its operand nodes with one fused kernel
+     * @return false if the node starts no fused pattern
+     *
+     * Operands are evaluated so that one k tree levels below the node takes
+     * a slot at most 2k above it, which keeps the unfused slot count.
+     */
+    template <typename FN_t>
+    bool EvaluateFused(const FN_t& fnc, std::size_t level, std::span<FuncValue_t> out)
+    {
+        constexpr auto NONE = Set::NONE;
+        if (fnc.Atom().arity == 1) {
+            const auto outer = Local(fnc, 1);
+            if (outer == NONE) {
+                return false;
+            }
+            const auto& inner_node = fnc.Arg1();
+            if (const auto inner = Local(inner_node, 1); inner != NONE) {
+                const Span_t a = EvaluateNode(inner_node.Arg1(), level + 1);
+                Set::FuseUnaryOverUnary(outer, inner, a, out);
+                Hit(FusedPattern::UnaryOverUnary, 2);
+                return true;
+            }
+            if (const auto inner = Local(inner_node, 2); inner != NONE) {
+                const Span_t a = EvaluateNode(inner_node.Arg1(), level + 1);
+                const Span_t b = EvaluateNode(inner_node.Arg2(), level + 2);
+                Set::FuseUnaryOverBinary(outer, inner, a, b, out);
+                Hit(FusedPattern::UnaryOverBinary, 2);
+                return true;
+            }
+            return false;
+        }
+        const auto outer = Local(fnc, 2);
+        if (outer == NONE) {
+            return false;
+        }
+        const auto& left = fnc.Arg1();
+        const auto& right = fnc.Arg2();
+        const auto left2 = Local(left, 2);
+        const auto right2 = Local(right, 2);
+        if ((left2 != NONE) and (right2 != NONE)) {
+            if (const auto kernel = m_set->Registered(outer, left2, right2); kernel != nullptr) {
+                const Span_t a = EvaluateNode(left.Arg1(), level + 1);
+                const Span_t b = EvaluateNode(left.Arg2(), level + 2);
+                const Span_t c = EvaluateNode(right.Arg1(), level + 3);
+                const Span_t d = EvaluateNode(right.Arg2(), level + 4);
+                kernel(a, b, c, d, out);
+                Hit(FusedPattern::Registered, 3);
+                return true;
+            }
+        }
+        if (left2 != NONE) {
+            const Span_t c = EvaluateNode(right, level + 1);
+            const Span_t a = EvaluateNode(left.Arg1(), level + 2);
+            const Span_t b = EvaluateNode(left.Arg2(), level + 3);
+            Set::FuseBinaryLeft(outer, left2, a, b, c, out);
+            Hit(FusedPattern::BinaryLeft, 2);
+            return true;
+        }
+        if (right2 != NONE) {
+            const Span_t a = EvaluateNode(left, level + 1);
+            const Span_t b = EvaluateNode(right.Arg1(), level + 2);
+            const Span_t c = EvaluateNode(right.Arg2(), level + 3);
+            Set::FuseBinaryRight(outer, right2, a, b, c, out);
+            Hit(FusedPattern::BinaryRight, 2);
+            return true;
+        }
+        if (const auto inner = Local(left, 1); inner != NONE) {
+            const Span_t a = EvaluateNode(left.Arg1(), level + 1);
+            const Span_t b = EvaluateNode(right, level + 2);
+            Set::FuseUnaryLeft(outer, inner, a, b, out);
+            Hit(FusedPattern::UnaryLeft, 2);
+            return true;
+        }
+        if (const auto inner = Local(right, 1); inner != NONE) {
+            const Span_t a = EvaluateNode(left, level + 1);
+            const Span_t b = EvaluateNode(right.Arg1(), level + 2);
+            Set::FuseUnaryRight(outer, inner, a, b, out);
+            Hit(FusedPattern::UnaryRight, 2);
+            return true;
+        }
+        return false;
+    }
+
+    void Fallback(const AtomFunc1<FuncValue_t>& atom, std::span<const FuncValue_t> arg,
+                  std::span<FuncValue_t> out) const
+    {
+        if (atom.Elementwise()) {
+            atom.CalculateTile(arg, out);
+            return;
+        }
+        assert(m_size == m_samples);
+        std::ranges::copy(atom.Calculate(std::vector<FuncValue_t>(arg.begin(), arg.end())), out.begin());
+    }
+
+    void Fallback(const AtomFunc2<FuncValue_t>& atom, std::span<const FuncValue_t> arg1,
+                  std::span<const FuncValue_t> arg2, std::span<FuncValue_t> out) const
+    {
+        if (atom.Elementwise()) {
+            atom.CalculateTile(arg1, arg2, out);
+            return;
+        }
+        assert(m_size == m_samples);
+        std::ranges::copy(atom.Calculate(std::vector<FuncValue_t>(arg1.begin(), arg1.end()),
+                                         std::vector<FuncValue_t>(arg2.begin(), arg2.end())),
+                          out.begin());
+    }
+};
+
+/**
+ * @class TileKernels
+ * @brief Whole-tree evaluation over sample tiles, pluggable into TiledEvaluator
+ * @tparam FuncValue_t Type of function values
+ * @tparam FN_t Function node type
+ *
+ * Hides the atom set type of a StaticTileKernels from the evaluator and
+ * SearchTask, at the cost of one virtual call per tile instead of one per node.
+ */
+template <typename FuncValue_t, typename FN_t>
+class TileKernels
+{
+   public:
+    virtual ~TileKernels() = default;
+
+    /// @brief Evaluate tree for a contiguous tile of samples, see StaticEvaluator::CalculateTile()
+    virtual std::span<const FuncValue_t> CalculateTile(const FN_t& fnc, std::size_t first, std::size_t size) = 0;
+
+    /// @brief Evaluate tree for scattered samples, see StaticEvaluator::CalculateGather()
+    virtual std::span<const FuncValue_t> CalculateGather(const FN_t& fnc,
+                                                         std::span<const std::size_t> positions) = 0;
+
+    /// @brief Share of atom nodes evaluated inside fused kernels
+    [[nodiscard]] virtual double HitRate() const = 0;
+
+    /// @brief Number of fused kernel calls of a pattern
+    [[nodiscard]] virtual std::size_t Hits(FusedPattern pattern) const = 0;
+};
+
+/**
+ * @class StaticTileKernels
+ * @brief TileKernels of a StaticAtomSet, evaluated by a StaticEvaluator
+ * @tparam FuncValue_t Type of function values
+ * @tparam FN_t Function node type
+ * @tparam Set StaticAtomSet registered in the library
+ */
+template <typename FuncValue_t, typename FN_t, typename Set>
+class StaticTileKernels final : public TileKernels<FuncValue_t, FN_t>
+{
+   public:
+    /**
+     * @brief Construct kernels
+     * @param atoms Library the set is registered in
+     * @param set Atom set
+     * @param fuse Evaluate node patterns with fused kernels
+     */
+    StaticTileKernels(const AtomFuncs<FuncValue_t>* atoms, const Set* set, bool fuse) : m_evaluator(atoms, set, fuse)
+    {
+    }
+
+    std::span<const FuncValue_t> CalculateTile(const FN_t& fnc, std::size_t first, std::size_t size) override
+    {
+        return m_evaluator.CalculateTile(fnc, first, size);
+    }
+
+    std::span<const FuncValue_t> CalculateGather(const FN_t& fnc, std::span<const std::size_t> positions) override
+    {
+        return m_evaluator.CalculateGather(fnc, positions);
+    }
+
+    [[nodiscard]] double HitRate() const override { return m_evaluator.HitRate(); }
+
+    [[nodiscard]] std::size_t Hits(FusedPattern pattern) const override { return m_evaluator.Hits(pattern); }
+
+   private:
+    StaticEvaluator<FuncValue_t, Set> m_evaluator;  ///< Evaluator with the kernels of the set
+};
+
+/// @} // end of Atoms group
+
+}  // namespace fw
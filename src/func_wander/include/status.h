@@ -1,6 +1,10 @@
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <utility>
 
 #include "common.h"
 #include "comparison.h"
@@ -10,6 +14,26 @@ namespace fw
 namespace status
 {
 
+/// @brief Order the search visits candidates in, which its progress is measured by
+enum class ProgressOrder : uint8_t
+{
+    Depth,      ///< Serial number (depth) order, progress by canonical rank
+    Random,     ///< Random sampling, no progress
+    SizeOrder,  ///< Tree cost order, progress by rank
+    BestFirst,  ///< Weighted cost order, progress by trees cheaper than the current one
+    Dag,        ///< DAG programs by steps
+    Shapes,     ///< Shapes, then labels per shape
+    BottomUp    ///< Value banks by depth
+};
+
+/// @brief Get short name of a progress order
+constexpr std::string_view ProgressOrderName(ProgressOrder order)
+{
+    constexpr std::array<std::string_view, 7> NAMES = {"depth", "random", "size",     "best-first",
+                                                       "dag",   "shape",  "bottom-up"};
+    return NAMES[static_cast<std::size_t>(order)];
+}
+
 struct BestFunc
 {
     SuitabilityMetrics suit;
@@ -21,14 +45,41 @@ struct Status
 {
     SerialNumber_t snum{};
     SerialNumber_t max_sn{};
+    SerialNumber_t canonical_rank{};
+    SerialNumber_t canonical_count{};
     float done_percent{};
     std::chrono::duration<int64_t, std::nano> elapsed{};
     std::chrono::duration<int64_t, std::nano> remaining{};
     std::size_t iterations_per_sec{};
     std::size_t sn_per_sec{};
     std::size_t iterations_count{};
+    std::size_t probe_rejected{};
+    std::size_t tiled_rejected{};
+    std::size_t sample_rejected{};
+    std::size_t evaluated_samples{};
+    std::size_t chain_tables{};
+    std::size_t chain_bytes{};
+    double fused_hit_rate{};
+    std::vector<std::pair<std::string_view, std::size_t>> fused_hits;
+    std::size_t queue_size{};
+    std::size_t queue_refills{};
+    std::size_t depths_done{};
+    std::size_t pool_bytes{};
+    std::size_t huge_page_bytes{};
+    std::size_t cache_bytes{};
+    std::size_t cache_limit{};
+    std::size_t cache_evictions{};
+    std::size_t bank_entries{};
+    std::size_t bank_dropped{};
+    std::size_t bank_collisions{};
+    std::size_t spill_bytes{};
+    std::size_t bank_tile{};
+    ProgressOrder progress_order{};
+    bool sn_overflow{};
+    std::string rejected;
     std::string current_function;
     std::vector<BestFunc> best_functions;
+    std::vector<std::string> affine_functions;
 
     std::string to_string() const
     {
@@ -40,12 +91,22 @@ struct Status
         const auto elapsed_m = std::chrono::duration_cast<std::chrono::minutes>(elapsed % std::chrono::hours(1));
         const auto elapsed_s = std::chrono::duration_cast<std::chrono::seconds>(elapsed % std::chrono::minutes(1));
 
+        auto sn_str = sn_overflow ? std::string("overflow")
+                                  : std::format("{} from max {}", format_with_si_prefix(snum),
+                                                format_with_si_prefix(max_sn));
+        if (progress_order != ProgressOrder::Depth) {
+            sn_str = std::format("n/a ({} order)", ProgressOrderName(progress_order));
+        }
+        if (not rejected.empty()) {
+            return std::format("settings rejected, not searching: {}\n", rejected);
+        }
         auto str = std::format(
-            "iteration {}; func sn {} from max {}; progress {}%; speed {} ips; elapsed: {}:{:02d}:{:02d}; remaining: "
-            "{}:{:02d}:{:02d}; function {}\n",
-            iterations_count, format_with_si_prefix(snum), format_with_si_prefix(max_sn), done_percent,
-            format_with_si_prefix(iterations_per_sec), elapsed_h.count(), elapsed_m.count(), elapsed_s.count(),
-            remaining_h.count(), remaining_m.count(), remaining_s.count(), current_function);
+            "iteration {}; func sn {}; canonical {} from {}; progress {}%; speed {} ips; elapsed: "
+            "{}:{:02d}:{:02d}; remaining: {}:{:02d}:{:02d}; probe rejected {}; tiled rejected {}; function {}\n",
+            iterations_count, sn_str, format_with_si_prefix(canonical_rank), format_with_si_prefix(canonical_count),
+            done_percent, format_with_si_prefix(iterations_per_sec), elapsed_h.count(), elapsed_m.count(),
+            elapsed_s.count(), remaining_h.count(), remaining_m.count(), remaining_s.count(), probe_rejected,
+            tiled_rejected, current_function);
 
         str += std::format("|  dist  | lvl | fnc | fnu | {:48}| coincidences\n", "function");
         for (auto& best : best_functions) {
@@ -53,6 +114,45 @@ struct Status
                                best.suit.max_level(), best.suit.functions_count(), best.suit.functions_unique(),
                                best.function, best.match_positions);
         }
+        if (evaluated_samples > 0) {
+            str += std::format("evaluated samples {}\n", format_with_si_prefix(evaluated_samples));
+        }
+        if (sample_rejected > 0) {
+            str += std::format("sampled pruned trees discarded {}\n", sample_rejected);
+        }
+        if (chain_tables > 0) {
+            str += std::format("unary chain tables {} ({}B)\n", chain_tables, format_with_si_prefix(chain_bytes));
+        }
+        if (not fused_hits.empty()) {
+            str += std::format("fused nodes {:.1f}%", fused_hit_rate * 100);
+            for (const auto& [pattern, hits] : fused_hits) {
+                str += std::format("; {} {}", pattern, hits);
+            }
+            str += '\n';
+        }
+        if ((queue_size > 0) or (queue_refills > 0)) {
+            str += std::format("best-first queue {}; refills {}\n", queue_size, queue_refills);
+        }
+        if (depths_done > 0) {
+            str += std::format("depths done {}\n", depths_done);
+        }
+        if (pool_bytes > 0) {
+            str += std::format("huge pages {}B of {}B\n", format_with_si_prefix(huge_page_bytes),
+                               format_with_si_prefix(pool_bytes));
+        }
+        if (bank_entries > 0) {
+            str += std::format("value cache {}B of {}; evictions {}; bank entries {}; dropped {}; "
+                               "collisions {}; tile {}\n",
+                               format_with_si_prefix(cache_bytes),
+                               (cache_limit > 0) ? format_with_si_prefix(cache_limit) + "B" : "unlimited",
+                               cache_evictions, bank_entries, bank_dropped, bank_collisions, bank_tile);
+        }
+        if (spill_bytes > 0) {
+            str += std::format("spilled to disk {}B\n", format_with_si_prefix(spill_bytes));
+        }
+        for (const auto& affine : affine_functions) {
+            str += std::format("affine: {}\n", affine);
+        }
         return str;
     }
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include "common.h"
 
 namespace fw
@@ -30,22 +32,333 @@ class Target
      * @param values Output values from candidate function
      * @return Distance metric (0 = perfect match, higher = worse)
      */
-    [[nodiscard]] virtual Distance Compare(const FuncValues_t& values) const = 0;
+    [[nodiscard]] virtual Distance Compare(std::span<const FuncValue_t> values) const = 0;
 
     /**
      * @brief Find positions where candidate matches target
      * @param values Output values from candidate function
      * @return RangeSet of indices where values match target
      */
-    [[nodiscard]] virtual RangeSet<std::size_t> MatchPositions(const FuncValues_t& values) const = 0;
+    [[nodiscard]] virtual RangeSet<std::size_t> MatchPositions(std::span<const FuncValue_t> values) const = 0;
 
     /**
      * @brief Get the target function values
      * @return Vector of desired output values
      */
     [[nodiscard]] virtual FuncValues_t Values() const = 0;
+
+    /**
+     * @brief Get number of samples in the target domain
+     * @return Length of candidate value vectors
+     */
+    [[nodiscard]] virtual std::size_t Size() const { return Values().size(); }
+
+    /**
+     * @brief Check if the distance is a sum of independent per-sample terms
+     * @return true if CompareAt() over disjoint position sets adds up to Compare()
+     * 
+     * Only separable targets take part in progressive (two-tier) evaluation.
+     */
+    [[nodiscard]] virtual bool Separable() const { return false; }
+
+    /**
+     * @brief Get integer weight of a sample
+     * @param pos Sample index
+     * @return Weight of the sample in the distance, 0 for don't-care samples
+     */
+    [[nodiscard]] virtual Weight SampleWeight([[maybe_unused]] std::size_t pos) const { return 1; }
+
+    /**
+     * @brief Get indices of all samples that contribute to the distance
+     * @return Sorted vector of sample positions with non-zero weight
+     */
+    [[nodiscard]] virtual std::vector<std::size_t> SamplePositions() const
+    {
+        std::vector<std::size_t> positions;
+        const auto size = Size();
+        for (std::size_t i = 0; i < size; ++i) {
+            if (SampleWeight(i) != 0) {
+                positions.push_back(i);
+            }
+        }
+        return positions;
+    }
+
+    /**
+     * @brief Bounded compare over selected sample positions
+     * @param values Output values from candidate function
+     * @param positions Sample indices to compare
+     * @param bound Comparison may stop as soon as the distance exceeds this value
+     * @return Partial distance (exact if not greater than bound)
+     * 
+     * Meaningful only for separable targets; the default reports no distance.
+     */
+    [[nodiscard]] virtual Distance CompareAt([[maybe_unused]] std::span<const FuncValue_t> values,
+                                             [[maybe_unused]] std::span<const std::size_t> positions,
+                                             [[maybe_unused]] Distance bound) const
+    {
+        return 0;
+    }
+
+    /**
+     * @brief Compare a contiguous tile of candidate values with target
+     * @param tile Candidate values of samples [first, first + tile.size())
+     * @param first Index of the first sample in the tile
+     * @param mask Optional match mask to mark matching samples in
+     * @return Distance contributed by the tile
+     * 
+     * Meaningful only for separable targets; the default reports no distance.
+     */
+    [[nodiscard]] virtual Distance CompareTile([[maybe_unused]] std::span<const FuncValue_t> tile,
+                                               [[maybe_unused]] std::size_t first,
+                                               [[maybe_unused]] MatchMask* mask) const
+    {
+        return 0;
+    }
+
+    /**
+     * @brief Compare a tile of candidate values gathered from scattered samples
+     * @param tile Candidate values, tile[k] belongs to sample positions[k]
+     * @param positions Sample indices of the tile
+     * @param mask Optional match mask to mark matching samples in
+     * @return Distance contributed by the tile
+     * 
+     * Meaningful only for separable targets; the default reports no distance.
+     */
+    [[nodiscard]] virtual Distance CompareGathered([[maybe_unused]] std::span<const FuncValue_t> tile,
+                                                   [[maybe_unused]] std::span<const std::size_t> positions,
+                                                   [[maybe_unused]] MatchMask* mask) const
+    {
+        return 0;
+    }
+};
+
+/**
+ * @class TargetValues
+ * @brief Target given by a table of sample values with optional mask and weights
+ * @tparam FuncValue_t Type of function values
+ * 
+ * Distance is the weighted number of mismatching samples, so the target is
+ * separable and supports bounded compare. Samples are either owned or
+ * viewed from external storage (e.g. a memory-mapped file). A don't-care
+ * mask is folded into the weights once (weight 0 excludes a sample), so
+ * all compare and match kernels run branch-free over plain arrays.
+ */
+template <typename FuncValue_t>
+class TargetValues : public Target<FuncValue_t>
+{
+   public:
+    using typename Target<FuncValue_t>::FuncValues_t;
+
+    /**
+     * @brief Construct target from sample values compared over [first, last]
+     * @param values Desired output values
+     * @param first First compared sample index
+     * @param last Last compared sample index (clamped to values size)
+     */
+    explicit TargetValues(FuncValues_t values, std::size_t first = 0, std::size_t last = SIZE_MAX)
+        : m_values(std::move(values))
+    {
+        if ((first == 0) and (m_values.empty() or (last >= m_values.size() - 1))) {
+            SetSamples(m_values);  // all samples compared - keep the unweighted fast path
+            return;
+        }
+        std::vector<uint8_t> mask(m_values.size(), 0);
+        for (std::size_t i = first; (i < m_values.size()) and (i <= last); ++i) {
+            mask[i] = 1;
+        }
+        SetSamples(m_values, mask);
+    }
+
+    /**
+     * @brief Construct target from sample values with mask and weights
+     * @param values Desired output values
+     * @param mask Don't-care mask, 0 excludes a sample (empty - all compared)
+     * @param weights Per-sample weights (empty - all equal to 1)
+     * 
+     * Mask and weights are copied, they need not outlive the target.
+     */
+    TargetValues(FuncValues_t values, std::span<const uint8_t> mask, std::span<const Weight> weights = {})
+        : m_values(std::move(values))
+    {
+        if (mask.empty() and (not weights.empty())) {
+            const std::vector<uint8_t> all(m_values.size(), 1);
+            SetSamples(m_values, all, weights);
+            return;
+        }
+        SetSamples(m_values, mask, weights);
+    }
+
+    TargetValues(const TargetValues&) = delete;
+    TargetValues& operator=(const TargetValues&) = delete;
+
+    ~TargetValues() override = default;
+
+    [[nodiscard]] Distance Compare(std::span<const FuncValue_t> values) const override
+    {
+        return MismatchKernel(values.data(), m_samples.data(), WeightsAt(0), m_samples.size());
+    }
+
+    [[nodiscard]] RangeSet<std::size_t> MatchPositions(std::span<const FuncValue_t> values) const override
+    {
+        MatchMask mask;
+        mask.Reset(m_samples.size());
+        MatchKernel(values.data(), 0, m_samples.size(), mask);
+        return mask.ToRangeSet();
+    }
+
+    [[nodiscard]] FuncValues_t Values() const override { return FuncValues_t(m_samples.begin(), m_samples.end()); }
+
+    [[nodiscard]] std::size_t Size() const override { return m_samples.size(); }
+
+    [[nodiscard]] Weight SampleWeight(std::size_t pos) const override { return WeightOf(pos); }
+
+    [[nodiscard]] bool Separable() const override { return true; }
+
+    /**
+     * @brief Bounded compare over selected sample positions
+     * 
+     * Mismatches are accumulated branch-free in blocks; the bound is checked
+     * only between blocks.
+     */
+    [[nodiscard]] Distance CompareAt(std::span<const FuncValue_t> values, std::span<const std::size_t> positions,
+                                     Distance bound) const override
+    {
+        Distance dist{};
+        for (std::size_t block = 0; block < positions.size(); block += BLOCK) {
+            const auto block_end = std::min(block + BLOCK, positions.size());
+            for (std::size_t i = block; i < block_end; ++i) {
+                const auto pos = positions[i];
+                dist += WeightOf(pos) * static_cast<Distance>(values[pos] != m_samples[pos]);
+            }
+            if (dist > bound) {
+                break;
+            }
+        }
+        return dist;
+    }
+
+    [[nodiscard]] Distance CompareTile(std::span<const FuncValue_t> tile, std::size_t first,
+                                       MatchMask* mask) const override
+    {
+        if (mask != nullptr) {
+            MatchKernel(tile.data(), first, tile.size(), *mask);
+        }
+        return MismatchKernel(tile.data(), m_samples.data() + first, WeightsAt(first), tile.size());
+    }
+
+    [[nodiscard]] Distance CompareGathered(std::span<const FuncValue_t> tile, std::span<const std::size_t> positions,
+                                           MatchMask* mask) const override
+    {
+        Distance dist{};
+        for (std::size_t k = 0; k < tile.size(); ++k) {
+            const auto pos = positions[k];
+            const auto weight = WeightOf(pos);
+            const bool equal = (tile[k] == m_samples[pos]);
+            dist += weight * static_cast<Distance>(not equal);
+            if ((mask != nullptr) and equal and (weight != 0)) {
+                mask->Set(pos);
+            }
+        }
+        return dist;
+    }
+
+   protected:
+    static constexpr std::size_t BLOCK = 64;  ///< Samples per kernel block (one match mask word)
+
+    FuncValues_t m_values;                   ///< Owned sample values (empty for external storage)
+    std::span<const FuncValue_t> m_samples;  ///< Desired output values
+    std::vector<Weight> m_folded_weights;    ///< Owned weights with the mask folded in
+    std::span<const Weight> m_weights;       ///< Effective per-sample weights (empty - all equal to 1)
+
+    /// @brief Construct empty target, samples are set later by a derived class
+    TargetValues() = default;
+
+    /**
+     * @brief Set samples to compare with
+     * @param samples Desired output values, must outlive the target
+     * @param mask Optional don't-care mask of the same size (0 excludes a sample)
+     * @param weights Optional per-sample weights of the same size, must outlive the target
+     * 
+     * Without a mask, external weights are used in place without copying.
+     */
+    void SetSamples(std::span<const FuncValue_t> samples, std::span<const uint8_t> mask = {},
+                    std::span<const Weight> weights = {})
+    {
+        assert(mask.empty() or (mask.size() == samples.size()));
+        assert(weights.empty() or (weights.size() == samples.size()));
+        m_samples = samples;
+        m_folded_weights.clear();
+        m_weights = weights;
+        if (mask.empty()) {
+            return;
+        }
+
+        m_folded_weights.resize(samples.size());
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            const Weight weight = weights.empty() ? 1 : weights[i];
+            m_folded_weights[i] = (mask[i] != 0) ? weight : 0;
+        }
+        m_weights = m_folded_weights;
+    }
+
+   private:
+    /// @brief Effective weight of a sample (non-virtual, for kernels)
+    [[nodiscard]] Weight WeightOf(std::size_t pos) const { return m_weights.empty() ? 1 : m_weights[pos]; }
+
+    /// @brief Pointer to effective weights from a sample, nullptr if unweighted
+    [[nodiscard]] const Weight* WeightsAt(std::size_t first) const
+    {
+        return m_weights.empty() ? nullptr : m_weights.data() + first;
+    }
+
+    /**
+     * @brief Weighted mismatch count over contiguous arrays
+     * 
+     * Both variants are plain loops without branches, so the compiler
+     * vectorizes them.
+     */
+    static Distance MismatchKernel(const FuncValue_t* values, const FuncValue_t* samples, const Weight* weights,
+                                   std::size_t count)
+    {
+        Distance dist{};
+        if (weights == nullptr) {
+            for (std::size_t i = 0; i < count; ++i) {
+                dist += static_cast<Distance>(values[i] != samples[i]);
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < count; ++i) {
+                dist += weights[i] * static_cast<Distance>(values[i] != samples[i]);
+            }
+        }
+        return dist;
+    }
+
+    /**
+     * @brief Mark matching samples with non-zero weight in a match mask
+     * @param values Candidate values, values[k] belongs to sample first + k
+     * @param first First sample position
+     * @param count Number of samples
+     * @param mask Match mask to fill
+     * 
+     * Match bits are packed into 64-bit words and merged a word at a time.
+     */
+    void MatchKernel(const FuncValue_t* values, std::size_t first, std::size_t count, MatchMask& mask) const
+    {
+        for (std::size_t block = 0; block < count; block += BLOCK) {
+            const auto block_len = std::min(BLOCK, count - block);
+            uint64_t bits = 0;
+            for (std::size_t j = 0; j < block_len; ++j) {
+                const auto k = block + j;
+                const bool match = (values[k] == m_samples[first + k]) and (WeightOf(first + k) != 0);
+                bits |= static_cast<uint64_t>(match) << j;
+            }
+            mask.Merge(first + block, bits, block_len);
+        }
+    }
 };
 
 /// @} // end of Targets group
 
-}  // namespace fw
\ No newline at end of file
+}  // namespace fw
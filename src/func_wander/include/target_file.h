@@ -0,0 +1,214 @@
+#pragma once
+
+#include <charconv>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "mapped_file.h"
+#include "target.h"
+
+namespace fw
+{
+
+/// @addtogroup Targets
+/// @{
+
+/**
+ * @class FileTarget
+ * @brief Target loaded at run time from a binary or CSV sample file
+ * @tparam FuncValue_t Type of function values
+ *
+ * Binary files hold raw samples in native byte order and are memory-mapped,
+ * so even very large targets load instantly and are never copied. An
+ * optional mask file holds one byte per sample (0 - don't care) and an
+ * optional weights file holds one Weight per sample.
+ *
+ * CSV files are streamed line by line. Each line is
+ * `value[,care[,weight]]`; a non-numeric first line is treated as a header
+ * and lines starting with '#' are comments.
+ */
+template <typename FuncValue_t>
+class FileTarget : public TargetValues<FuncValue_t>
+{
+   public:
+    FileTarget() = default;
+    ~FileTarget() override = default;
+
+    /**
+     * @brief Load target from file, choosing the format by extension
+     * @param path Path to sample file (".csv" - CSV, otherwise binary)
+     * @param mask_path Optional path to binary don't-care mask
+     * @param weights_path Optional path to binary weights
+     * @return true if successful, false on error
+     */
+    bool Load(const std::string& path, const std::string& mask_path = {}, const std::string& weights_path = {})
+    {
+        if (path.ends_with(".csv")) {
+            return (mask_path.empty() and weights_path.empty() and LoadCSV(path));
+        }
+        return LoadBinary(path, mask_path, weights_path);
+    }
+
+    /**
+     * @brief Memory-map raw binary sample files
+     * @param path Path to samples, sizeof(FuncValue_t) bytes each
+     * @param mask_path Optional path to mask, one byte per sample
+     * @param weights_path Optional path to weights, one Weight per sample
+     * @return true if successful, false on error
+     */
+    bool LoadBinary(const std::string& path, const std::string& mask_path = {},
+                    const std::string& weights_path = {})
+    {
+        Clear();
+
+        if (not m_samples_file.Open(path)) {
+            return false;
+        }
+        if (m_samples_file.Size() % sizeof(FuncValue_t) != 0) {
+            return false;
+        }
+        const auto samples = m_samples_file.As<FuncValue_t>();
+
+        std::span<const uint8_t> mask;
+        if (not mask_path.empty()) {
+            if (not m_mask_file.Open(mask_path)) {
+                return false;
+            }
+            mask = m_mask_file.As<uint8_t>();
+            if (mask.size() != samples.size()) {
+                return false;
+            }
+        }
+
+        std::span<const Weight> weights;
+        if (not weights_path.empty()) {
+            if (not m_weights_file.Open(weights_path)) {
+                return false;
+            }
+            weights = m_weights_file.As<Weight>();
+            if ((m_weights_file.Size() % sizeof(Weight) != 0) or (weights.size() != samples.size())) {
+                return false;
+            }
+        }
+
+        this->SetSamples(samples, mask, weights);
+        return true;
+    }
+
+    /**
+     * @brief Stream samples from CSV file
+     * @param path Path to CSV file
+     * @return true if successful, false on error
+     */
+    bool LoadCSV(const std::string& path)
+    {
+        Clear();
+
+        std::ifstream file(path);
+        if (not file) {
+            return false;
+        }
+
+        bool has_mask = false;
+        bool has_weights = false;
+        bool first_line = true;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::string_view rest{line};
+            if (rest.empty() or rest.starts_with('#')) {
+                continue;
+            }
+
+            FuncValue_t value{};
+            if (not ParseField(NextField(rest), value)) {
+                if (first_line) {
+                    first_line = false;
+                    continue;
+                }
+                return false;
+            }
+            first_line = false;
+
+            uint8_t care = 1;
+            Weight weight = 1;
+            if (not rest.empty()) {
+                has_mask = true;
+                if (not ParseField(NextField(rest), care)) {
+                    return false;
+                }
+            }
+            if (not rest.empty()) {
+                has_weights = true;
+                if (not ParseField(NextField(rest), weight)) {
+                    return false;
+                }
+            }
+
+            this->m_values.push_back(value);
+            m_mask.push_back(care);
+            m_weights.push_back(weight);
+        }
+
+        if (this->m_values.empty()) {
+            return false;
+        }
+
+        std::span<const uint8_t> mask;
+        if (has_mask) {
+            mask = m_mask;
+        }
+        std::span<const Weight> weights;
+        if (has_weights) {
+            weights = m_weights;
+        }
+        this->SetSamples(this->m_values, mask, weights);
+        return true;
+    }
+
+   private:
+    MappedFile m_samples_file;      ///< Mapped binary samples
+    MappedFile m_mask_file;         ///< Mapped binary mask
+    MappedFile m_weights_file;      ///< Mapped binary weights
+    std::vector<uint8_t> m_mask;    ///< Mask parsed from CSV
+    std::vector<Weight> m_weights;  ///< Weights parsed from CSV
+
+    void Clear()
+    {
+        this->SetSamples({});
+        this->m_values.clear();
+        m_mask.clear();
+        m_weights.clear();
+        m_samples_file.Close();
+        m_mask_file.Close();
+        m_weights_file.Close();
+    }
+
+    /// @brief Cut next comma-separated field off the line
+    static std::string_view NextField(std::string_view& rest)
+    {
+        const auto comma = rest.find(',');
+        auto field = rest.substr(0, comma);
+        rest = (comma == std::string_view::npos) ? std::string_view{} : rest.substr(comma + 1);
+
+        const auto begin = field.find_first_not_of(" \t\r");
+        const auto end = field.find_last_not_of(" \t\r");
+        return (begin == std::string_view::npos) ? std::string_view{} : field.substr(begin, end - begin + 1);
+    }
+
+    /// @brief Parse whole field as a number
+    template <typename T>
+    static bool ParseField(std::string_view field, T& value)
+    {
+        if (field.empty()) {
+            return false;
+        }
+        const auto* end = field.data() + field.size();
+        const auto result = std::from_chars(field.data(), end, value);
+        return ((result.ec == std::errc{}) and (result.ptr == end));
+    }
+};
+
+/// @} // end of Targets group
+
+}  // namespace fw
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#include "common.h"
+#include "func_node.h"
+#include "lut_atoms.h"
+#include "static_atoms.h"
+#include "target.h"
+#include "value_pool.h"
+
+namespace fw
+{
+
+/// @addtogroup Search
+/// @{
+
+/**
+ * @class TiledEvaluator
+ * @brief Streaming evaluation of function trees over cache-sized sample tiles
+ * @tparam FuncValue_t Type of function values
+ *
+ * Instead of keeping a full value vector per tree node, the domain is cut
+ * into tiles of a fixed number of samples. Each tile is evaluated
+ * depth-first through the tree using a small stack of tile buffers (slots
+ * of one cache-line-aligned ValuePool, indexed by stack level), then
+ * compared with the target right away. Distance and match mask are
+ * accumulated per tile, and evaluation stops as soon as the distance
+ * exceeds the given bound.
+ *
+ * Don't-care samples are dropped from evaluation entirely: when the target
+ * excludes some samples, tiles run over the compacted list of cared sample
+ * positions and leaves gather their values at those positions. The same
+ * gathered passes evaluate a tree on a chosen subset of the samples, see
+ * EvaluateAt().
+ *
+ * Chains of unary atoms with composition tables (see SetChains()) are
+ * evaluated with one gather per sample. Given TileKernels, whole trees are
+ * evaluated by those instead, e.g. by the fused kernels of a StaticAtomSet.
+ *
+ * Requires all unary and binary atoms to be elementwise and the target
+ * to be separable; see Available().
+ */
+template <typename FuncValue_t>
+class TiledEvaluator
+{
+   public:
+    /**
+     * @brief Construct evaluator
+     * @param atoms Pointer to atomic function library
+     * @param target Pointer to target specification
+     * @param tile_size Number of samples per tile
+     */
+    TiledEvaluator(const AtomFuncs<FuncValue_t>* atoms, const Target<FuncValue_t>* target, std::size_t tile_size)
+        : m_atoms(atoms), m_target(target), m_tile_size(tile_size)
+    {
+        if ((m_tile_size > 0) and m_target->Separable()) {
+            m_positions = m_target->SamplePositions();
+            if (m_positions.size() == m_target->Size()) {
+                m_positions.clear();
+            }
+        }
+    }
+
+    /**
+     * @brief Check if the atoms and the target allow tiled evaluation
+     * @return true if every non-leaf atom is elementwise and the target is separable
+     */
+    [[nodiscard]] bool Available() const
+    {
+        if ((m_tile_size == 0) or (not m_target->Separable())) {
+            return false;
+        }
+        const auto elementwise = [](const auto* atom) { return atom->Elementwise(); };
+        return (std::ranges::all_of(m_atoms->arg1, elementwise) and std::ranges::all_of(m_atoms->arg2, elementwise));
+    }
+
+    /**
+     * @brief Evaluate unary chains by their composition tables
+     * @param chains Tables, must outlive the evaluator (nullptr or unavailable - node by node)
+     */
+    void SetChains(const UnaryChains<FuncValue_t>* chains)
+    {
+        m_chains = ((chains != nullptr) and chains->Available()) ? chains : nullptr;
+    }
+
+    /**
+     * @brief Evaluate tree tile by tile and compare with target
+     * @param fnc Function tree to evaluate
+     * @param bound Evaluation stops as soon as the distance exceeds this value
+     * @param mask Optional match mask, reset and filled for evaluated tiles
+     * @param kernels Optional tree evaluator per tile (nullptr - node by node)
+     * @return Distance to target (exact if not greater than bound)
+     */
+    template <typename FN_t>
+    Distance Evaluate(const FN_t& fnc, Distance bound, MatchMask* mask = nullptr,
+                      TileKernels<FuncValue_t, FN_t>* kernels = nullptr)
+    {
+        if (mask != nullptr) {
+            mask->Reset(m_target->Size());
+        }
+        return Stream(fnc, m_positions, m_positions.empty() ? m_target->Size() : m_positions.size(), bound, mask,
+                      kernels);
+    }
+
+    /**
+     * @brief Evaluate tree at given sample positions tile by tile and compare with target
+     * @param fnc Function tree to evaluate
+     * @param positions Sample positions, leaves gather their values there
+     * @param bound Evaluation stops as soon as the distance exceeds this value
+     * @param mask Optional match mask, filled (not reset) for evaluated tiles
+     * @param kernels Optional tree evaluator per tile (nullptr - node by node)
+     * @return Distance to target over the positions (exact if not greater than bound)
+     *
+     * Disjoint position sets of a separable target add up, so passes over
+     * them may share one mask and split the bound between them.
+     */
+    template <typename FN_t>
+    Distance EvaluateAt(const FN_t& fnc, std::span<const std::size_t> positions, Distance bound,
+                        MatchMask* mask = nullptr, TileKernels<FuncValue_t, FN_t>* kernels = nullptr)
+    {
+        return Stream(fnc, positions, positions.size(), bound, mask, kernels);
+    }
+
+    /// @brief Number of samples trees were evaluated on by Evaluate() and EvaluateAt()
+    [[nodiscard]] std::size_t EvaluatedSamples() const { return m_evaluated; }
+
+    /**
+     * @brief Check if a tree has the same value for every sample, tile by tile
+     * @param fnc Function tree to evaluate
+     * @param kernels Optional tree evaluator per tile (nullptr - node by node)
+     * @return true if all values are equal
+     *
+     * All samples count, cared for or not, as for the SKIP_CONSTANT pruning
+     * of FuncNode::Iterate(). Stops at the first tile holding a second
+     * value, usually the first one, so the values are never materialized.
+     */
+    template <typename FN_t>
+    bool ConstantValues(const FN_t& fnc, TileKernels<FuncValue_t, FN_t>* kernels = nullptr)
+    {
+        const auto size = m_target->Size();
+        FuncValue_t value{};
+        m_gather = {};
+        for (std::size_t first = 0; first < size; first += m_tile_size) {
+            m_tile_first = first;
+            m_tile_len = std::min(m_tile_size, size - first);
+            const auto tile = EvaluateTile(fnc, kernels);
+            if (first == 0) {
+                value = tile.front();
+            }
+            if (std::ranges::any_of(tile, [value](FuncValue_t v) { return v != value; })) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+   private:
+    const AtomFuncs<FuncValue_t>* m_atoms = nullptr;     ///< Atomic function library
+    const Target<FuncValue_t>* m_target = nullptr;       ///< Target specification
+    std::size_t m_tile_size = 0;                         ///< Samples per tile
+    std::vector<std::size_t> m_positions;                ///< Cared sample positions (empty - all samples)
+    std::size_t m_tile_first = 0;                        ///< First sample (or position index) of the current tile
+    std::size_t m_tile_len = 0;                          ///< Samples in the current tile
+    std::span<const std::size_t> m_gather;               ///< Sample positions of the current pass (empty - all)
+    std::size_t m_evaluated = 0;                         ///< Samples evaluated for comparison
+    std::size_t m_top = 0;                               ///< Number of tile buffers in use
+    ValuePool<FuncValue_t> m_pool;                       ///< Tile buffers
+    std::vector<std::size_t> m_buffers;                  ///< Pool slot per stack level
+    const UnaryChains<FuncValue_t>* m_chains = nullptr;  ///< Composition tables of unary chains
+
+    [[nodiscard]] std::span<FuncValue_t> Tile(std::size_t idx) { return m_pool.Slot(m_buffers[idx]).first(m_tile_len); }
+
+    [[nodiscard]] std::span<const std::size_t> TilePositions() const
+    {
+        return m_gather.subspan(m_tile_first, m_tile_len);
+    }
+
+    /// @brief Evaluate tiles of a pass over all samples or gathered positions, see Evaluate()
+    template <typename FN_t>
+    Distance Stream(const FN_t& fnc, std::span<const std::size_t> positions, std::size_t size, Distance bound,
+                    MatchMask* mask, TileKernels<FuncValue_t, FN_t>* kernels)
+    {
+        m_gather = positions;
+        Distance dist{};
+        for (std::size_t first = 0; first < size; first += m_tile_size) {
+            m_tile_first = first;
+            m_tile_len = std::min(m_tile_size, size - first);
+            m_evaluated += m_tile_len;
+            const auto tile = EvaluateTile(fnc, kernels);
+            if (not m_gather.empty()) {
+                dist += m_target->CompareGathered(tile, TilePositions(), mask);
+            }
+            else {
+                dist += m_target->CompareTile(tile, first, mask);
+            }
+            if (dist > bound) {
+                break;
+            }
+        }
+        return dist;
+    }
+
+    /// @brief Take a tile buffer from the top of the stack
+    std::size_t Push()
+    {
+        if (m_top == m_buffers.size()) {
+            if (m_buffers.empty()) {
+                m_pool.Reset(0, m_tile_size);
+            }
+            m_buffers.push_back(m_buffers.size());
+            m_pool.Reserve(m_buffers.size());
+        }
+        return m_top++;
+    }
+
+    /// @brief Evaluate tree for the current tile
+    template <typename FN_t>
+    std::span<const FuncValue_t> EvaluateTile(const FN_t& fnc, TileKernels<FuncValue_t, FN_t>* kernels)
+    {
+        if (kernels != nullptr) {
+            return m_gather.empty() ? kernels->CalculateTile(fnc, m_tile_first, m_tile_len)
+                                    : kernels->CalculateGather(fnc, TilePositions());
+        }
+        m_top = 0;
+        return Tile(EvaluateNode(fnc));
+    }
+
+    /**
+     * @brief Evaluate subtree for the current tile
+     * @return Index of the stack buffer holding the result
+     *
+     * Children results are consumed by the parent and their buffers are
+     * released, so the stack never grows beyond twice the tree depth.
+     */
+    template <typename FN_t>
+    std::size_t EvaluateNode(const FN_t& fnc)
+    {
+        const auto& atom = fnc.Atom();
+        switch (atom.arity) {
+            case 0: {
+                const auto res = Push();
+                if (m_gather.empty()) {
+                    m_atoms->arg0[atom.num]->CalculateTile(m_tile_first, Tile(res));
+                }
+                else {
+                    m_atoms->arg0[atom.num]->CalculateGather(TilePositions(), Tile(res));
+                }
+                return res;
+            }
+            case 1: {
+                const FN_t* operand = nullptr;
+                const auto table =
+                    (m_chains != nullptr) ? m_chains->Match(fnc, operand) : std::span<const FuncValue_t>{};
+                const auto arg = EvaluateNode(table.empty() ? fnc.Arg1() : *operand);
+                const auto res = Push();
+                if (table.empty()) {
+                    m_atoms->arg1[atom.num]->CalculateTile(Tile(arg), Tile(res));
+                }
+                else {
+                    UnaryChains<FuncValue_t>::Apply(table, Tile(arg), Tile(res));
+                }
+                std::swap(m_buffers[arg], m_buffers[res]);
+                m_top = arg + 1;
+                return arg;
+            }
+            case 2: {
+                const auto arg1 = EvaluateNode(fnc.Arg1());
+                const auto arg2 = EvaluateNode(fnc.Arg2());
+                const auto res = Push();
+                m_atoms->arg2[atom.num]->CalculateTile(Tile(arg1), Tile(arg2), Tile(res));
+                std::swap(m_buffers[arg1], m_buffers[res]);
+                m_top = arg1 + 1;
+                return arg1;
+            }
+            default:
+                assert(false);
+        }
+        return 0;
+    }
+};
+
+/// @} // end of Search group
+
+}  // namespace fw
@@ -0,0 +1,970 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <span>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+#include "common.h"
+#include "func_node.h"
+#include "huge_pages.h"
+#include "lut_atoms.h"
+#include "mapped_file.h"
+#include "memory_budget.h"
+#include "value_pool.h"
+
+namespace fw
+{
+
+/// @addtogroup FunctionNodes
+/// @{
+
+/**
+ * @class ValueBank
+ * @brief Bottom-up enumeration of distinct function values, one bank per depth
+ * @tparam FuncValue_t Type of function values
+ * @tparam SKIP_CONSTANT Whether to skip constant expressions
+ * @tparam SKIP_SYMMETRIC Whether to skip symmetric duplicates for commutative ops
+ *
+ * Level 0 holds the leaves. Level d combines the levels below it: a
+ * unary atom over level d-1, or a binary atom over any pair of entries
+ * below d with at least one operand from level d-1. A candidate with the
+ * values of an earlier entry is skipped, so each value is visited once,
+ * by its shallowest tree, and only distinct values are combined further.
+ * Entries are looked up by a 64-bit fingerprint and compared value by
+ * value (an evicted entry is recomputed for it), so a fingerprint
+ * collision never hides a value; collisions are counted, see
+ * Collisions(). Replacing subtrees by shallower ones of
+ * equal value never deepens a tree, so every value of a tree of depth
+ * up to max_depth is reached.
+ *
+ * The pairs of a binary atom form a square of entries, walked in tiles:
+ * a tile of second operands against a tile of first operands, with all
+ * binary atoms applied to one pair of tiles before the next. Both sets of
+ * values stay in L2 while each is used a tile's width of times per atom,
+ * and each candidate is fingerprinted (and checked by the caller) while
+ * its values are still in L1. The tile size is chosen from the L2 size
+ * unless given.
+ *
+ * Values live in blocks of whole huge pages, split into cache-line-
+ * aligned slots, so huge pages can back every block rather than only
+ * those of at least a page. Blocks, entries and fingerprints are
+ * charged to a MemoryBudget; when it is exhausted, values are evicted
+ * in batches of an eighth of the resident ones. Eviction keeps
+ * frequently used, shallow entries: values go in order of
+ * (uses + 1) / level. Leaf values belong to their atoms and are never
+ * stored. An evicted value is recomputed from its operands (kept by the
+ * entry) when next used. If even the entries do not fit, value blocks
+ * are given back, and as a last resort new values are still visited but
+ * not banked, see Dropped().
+ *
+ * With a spill directory, blocks beyond the budget go to disk instead,
+ * and nothing is evicted; when entries need the memory, the last blocks
+ * held in memory move to disk, so the shallow levels stay in memory
+ * longest. Each level has one scratch file, grown and memory-mapped in
+ * extents of SPILL_EXTENT_BLOCKS blocks. Slots are taken in entry order,
+ * so a level is a contiguous run of blocks, the tiles of the binary
+ * combination loop read their operands as sequential runs of slots, and
+ * a spilled tile is read once per tile of the other operand.
+ */
+template <typename FuncValue_t, bool SKIP_CONSTANT = false, bool SKIP_SYMMETRIC = false>
+class ValueBank
+{
+   public:
+    /// Vector type for function values
+    using FuncValues_t = std::vector<FuncValue_t>;
+    /// Composition tables of unary chains
+    using Chains_t = UnaryChains<FuncValue_t>;
+
+    /// @brief Position of a candidate in enumeration order
+    struct Cursor
+    {
+        /// @brief Field order (enumeration order only for untiled banks, see Order())
+        auto operator<=>(const Cursor& other) const = default;
+
+        std::size_t level = 0;  ///< Depth being built
+        std::size_t op = 0;     ///< Leaf at level 0; unary, then binary atoms above
+        std::size_t right = 0;  ///< Entry of the only (unary) or second (binary) operand
+        std::size_t left = 0;   ///< Entry of the first operand of a binary atom
+    };
+
+    /**
+     * @brief Construct empty bank
+     * @param atoms Pointer to atomic function library
+     * @param max_depth Maximum depth of banked trees
+     * @param budget Memory budget charged for values, entries and fingerprints
+     * @param huge_pages Back value blocks by huge pages where possible
+     * @param spill_dir Directory for value blocks beyond the budget (empty - evict instead)
+     * @param tile Entries per side of a binary combination tile (0 - auto from the L2 size)
+     */
+    ValueBank(const AtomFuncs<FuncValue_t>* atoms, std::size_t max_depth, MemoryBudget* budget,
+              bool huge_pages = false, std::string spill_dir = {}, std::size_t tile = 0)
+        : m_atoms(atoms),
+          m_max_depth(max_depth),
+          m_budget(budget),
+          m_huge_pages(huge_pages),
+          m_spill_dir(std::move(spill_dir)),
+          m_tile(tile)
+    {
+        m_samples = m_atoms->arg0.front()->Calculate().size();
+        m_stride = ValuePool<FuncValue_t>::SlotStride(m_samples);
+        // Blocks are whole huge pages, so each can be backed by them.
+        const auto slot_bytes = m_stride * sizeof(FuncValue_t);
+        const auto pages = (MIN_BLOCK_SLOTS * slot_bytes + HugePageRegion::HUGE_PAGE - 1) / HugePageRegion::HUGE_PAGE;
+        m_block_bytes = pages * HugePageRegion::HUGE_PAGE;
+        m_block_slots = m_block_bytes / slot_bytes;
+        if (m_tile == 0) {
+            // Two tiles of operands fill half of L2, leaving room for the rest of the search.
+            m_tile = std::max<std::size_t>(CacheBytes() / 4 / (m_stride * sizeof(FuncValue_t)), 1);
+        }
+    }
+
+    ValueBank(const ValueBank&) = delete;
+    ValueBank& operator=(const ValueBank&) = delete;
+    ValueBank(ValueBank&&) = delete;
+    ValueBank& operator=(ValueBank&&) = delete;
+
+    /// @brief Return all charged memory to the budget
+    ~ValueBank()
+    {
+        const auto in_memory = m_blocks.size() - (m_spilled / BlockBytes());
+        m_budget->Release((m_entries.size() * ENTRY_BYTES) + (in_memory * BlockBytes()));
+    }
+
+    /**
+     * @brief Advance to the next distinct value
+     * @return true if found, false if all levels up to max_depth are done
+     */
+    bool Next()
+    {
+        while ((not m_finished) and Step()) {
+            if (Candidate()) {
+                Admit();
+                return true;
+            }
+        }
+        m_finished = true;
+        return false;
+    }
+
+    /**
+     * @brief Calculate function values for all inputs
+     * @return Values of the current candidate
+     */
+    [[nodiscard]] const FuncValues_t& Calculate() const { return m_values; }
+
+    /**
+     * @brief Recompute evicted unary chains by their composition tables
+     * @param chains Tables, must outlive the bank (nullptr or unavailable - atom by atom)
+     */
+    void SetChains(const Chains_t* chains)
+    {
+        m_chains = ((chains != nullptr) and chains->Available()) ? chains : nullptr;
+    }
+
+    /// @brief Get string representation of the current candidate in FuncNode::Repr() format
+    [[nodiscard]] std::string Repr() const { return EntryRepr(m_current); }
+
+    /**
+     * @brief Build tree of the current candidate
+     * @param fnc Tree rebuilt in place; unchanged subtrees keep cached values
+     */
+    template <typename FN_t>
+    void ToTree(FN_t& fnc) const
+    {
+        Build(fnc, m_current);
+    }
+
+    /**
+     * @brief Position in enumeration order
+     * @return Fraction of candidates visited, approximate: levels count equally
+     */
+    [[nodiscard]] long double Progress() const
+    {
+        if (m_finished) {
+            return 1;
+        }
+        const auto levels = static_cast<long double>(m_max_depth + 1);
+        const auto& c = m_cursor;
+        if (c.level == 0) {
+            return static_cast<long double>(c.op) / static_cast<long double>(m_atoms->arg0.size()) / levels;
+        }
+        const auto unary = static_cast<long double>(m_atoms->arg1.size());
+        const auto binary = static_cast<long double>(m_atoms->arg2.size());
+        const auto first = static_cast<long double>(m_levels[c.level - 1]);
+        const auto below = static_cast<long double>(m_levels[c.level]);
+        // Pairs of old operands are skipped but counted, to keep the tile walk simple.
+        const auto pairs = below * below;
+        const auto total = (unary * (below - first)) + (binary * pairs);
+        const auto op = static_cast<long double>(c.op);
+        long double pos = 0;
+        if (op < unary) {
+            pos = (op * (below - first)) + (static_cast<long double>(c.right) - first);
+        }
+        else {
+            const auto tile_right = static_cast<long double>(c.right - (c.right % m_tile));
+            const auto tile_left = static_cast<long double>(c.left - (c.left % m_tile));
+            const auto rows = std::min(static_cast<long double>(m_tile), below - tile_right);
+            const auto cols = std::min(static_cast<long double>(m_tile), below - tile_left);
+            // All binary atoms pass over a pair of tiles before the next one.
+            pos = (unary * (below - first)) + (binary * ((tile_right * below) + (tile_left * rows))) +
+                  ((op - unary) * rows * cols) + ((static_cast<long double>(c.right) - tile_right) * cols) +
+                  (static_cast<long double>(c.left) - tile_left);
+        }
+        return (static_cast<long double>(c.level) + (pos / total)) / levels;
+    }
+
+    /// @brief Position of the current candidate
+    [[nodiscard]] const Cursor& Position() const { return m_cursor; }
+
+    /// @brief Maximum depth of banked trees
+    [[nodiscard]] std::size_t MaxDepth() const { return m_max_depth; }
+
+    /**
+     * @brief Raise the maximum depth, keeping the banks built so far
+     * @param max_depth New maximum depth (a lower one is ignored)
+     *
+     * A finished bank continues with the next level, combining the
+     * levels it already holds instead of rebuilding them.
+     */
+    void Deepen(std::size_t max_depth)
+    {
+        if (max_depth <= m_max_depth) {
+            return;
+        }
+        m_max_depth = max_depth;
+        m_deepened = m_finished;
+        m_finished = false;
+    }
+
+    /// @brief Check if a candidate was visited
+    [[nodiscard]] bool Started() const { return m_started; }
+
+    /**
+     * @brief Rebuild the bank up to a saved position
+     * @param position Position of a candidate visited before
+     * @return true if the position was reached
+     *
+     * The enumeration is deterministic for the same atoms and budget, so
+     * the bank is rebuilt by replaying it; candidates are not reported.
+     */
+    bool Seek(const Cursor& position)
+    {
+        while (Next()) {
+            if (m_cursor == position) {
+                return true;
+            }
+            if (Order(position) < Order(m_cursor)) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Convert position to JSON representation
+     * @return JSON object with the cursor fields and the settings the order depends on
+     */
+    [[nodiscard]] json ToJSON() const
+    {
+        json j;
+        j["level"] = m_cursor.level;
+        j["op"] = m_cursor.op;
+        j["right"] = m_cursor.right;
+        j["left"] = m_cursor.left;
+        j["tile"] = m_tile;
+        j["budget"] = m_budget->Limit();
+        j["spill"] = not m_spill_dir.empty();
+        j["finished"] = m_finished;
+        return j;
+    }
+
+    /**
+     * @brief Restore position from JSON representation, see Seek()
+     * @param j_root JSON object with the cursor fields
+     * @return true if successful, false on error
+     *
+     * The saved tile size replaces the current one, as it defines the
+     * order; without one the position is from an untiled bank. Which
+     * values are banked depends on the budget limit and on spilling, so
+     * a position saved with others is rejected. A finished bank is
+     * replayed to the end.
+     */
+    bool FromJSON(const json& j_root)
+    {
+        const auto j_level = j_root.find("level");
+        const auto j_op = j_root.find("op");
+        const auto j_right = j_root.find("right");
+        const auto j_left = j_root.find("left");
+        if ((j_level == j_root.end()) or (j_op == j_root.end()) or (j_right == j_root.end()) or
+            (j_left == j_root.end())) {
+            return false;
+        }
+        if (not(j_level->is_number_unsigned() and j_op->is_number_unsigned() and j_right->is_number_unsigned() and
+                j_left->is_number_unsigned())) {
+            return false;
+        }
+        const auto j_tile = j_root.find("tile");
+        if ((j_tile != j_root.end()) and ((not j_tile->is_number_unsigned()) or (j_tile->get<std::size_t>() == 0))) {
+            return false;
+        }
+        const auto j_budget = j_root.find("budget");
+        const auto j_spill = j_root.find("spill");
+        const auto j_finished = j_root.find("finished");
+        if ((j_budget == j_root.end()) or (j_spill == j_root.end()) or (j_finished == j_root.end())) {
+            return false;
+        }
+        if (not(j_budget->is_number_unsigned() and j_spill->is_boolean() and j_finished->is_boolean())) {
+            return false;
+        }
+        if ((j_budget->get<std::size_t>() != m_budget->Limit()) or (j_spill->get<bool>() == m_spill_dir.empty())) {
+            return false;
+        }
+        if (m_started) {
+            return false;
+        }
+        m_tile = (j_tile != j_root.end()) ? j_tile->get<std::size_t>() : std::numeric_limits<std::size_t>::max();
+        Cursor position;
+        position.level = j_level->get<std::size_t>();
+        position.op = j_op->get<std::size_t>();
+        position.right = j_right->get<std::size_t>();
+        position.left = j_left->get<std::size_t>();
+        if (j_finished->get<bool>()) {
+            while (Next()) {
+            }
+            return true;
+        }
+        return Seek(position);
+    }
+
+    /// @brief Number of banked values, leaves included
+    [[nodiscard]] std::size_t Entries() const { return m_entries.size(); }
+
+    /// @brief Number of values held in memory
+    [[nodiscard]] std::size_t Resident() const { return (m_blocks.size() * m_block_slots) - m_free.size(); }
+
+    /// @brief Number of distinct values visited but not banked for lack of memory
+    [[nodiscard]] std::size_t Dropped() const { return m_dropped; }
+
+    /// @brief Number of new values whose fingerprint was that of a banked value
+    [[nodiscard]] std::size_t Collisions() const { return m_collisions; }
+
+    /// @brief Bytes of value blocks spilled to scratch files
+    [[nodiscard]] std::size_t SpilledBytes() const { return m_spilled; }
+
+    /// @brief Bytes of value blocks held in memory
+    [[nodiscard]] std::size_t BlockMemoryBytes() const { return (m_blocks.size() * BlockBytes()) - m_spilled; }
+
+    /**
+     * @brief Add the extents of value blocks held in memory
+     * @param extents Extents to count huge pages of, see HugePageRegion::HugeBytes()
+     */
+    void BlockExtents(std::vector<HugePageRegion::Extent>& extents) const
+    {
+        for (const auto& block : m_blocks) {
+            if (not block.spilled) {
+                extents.push_back(block.region.GetExtent());
+            }
+        }
+    }
+
+    /// @brief Entries per side of a binary combination tile
+    [[nodiscard]] std::size_t Tile() const { return m_tile; }
+
+   private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr std::size_t MIN_BLOCK_SLOTS = 64;
+    static constexpr std::size_t EVICT_SHARE = 8;
+    /// Blocks per extent of a scratch file
+    static constexpr std::size_t SPILL_EXTENT_BLOCKS = 16;
+    /// Estimated fingerprint map cost per value: hash node plus bucket
+    static constexpr std::size_t FINGERPRINT_BYTES = 32;
+
+    /// @brief Banked value: how it is computed and where it is stored
+    struct Entry
+    {
+        AtomIndex atom;         ///< Atomic function
+        uint32_t arg1 = 0;      ///< First operand entry (for arity >= 1)
+        uint32_t arg2 = 0;      ///< Second operand entry (for arity = 2)
+        uint32_t slot = NONE;   ///< Value slot (NONE - leaf or evicted)
+        uint32_t uses = 0;      ///< Times read as an operand
+        uint16_t pins = 0;      ///< Operand reads in progress, not evictable
+        uint8_t level = 0;      ///< Depth of the tree
+        bool constant = false;  ///< All leaves constant
+    };
+
+    static constexpr std::size_t ENTRY_BYTES = sizeof(Entry) + FINGERPRINT_BYTES;
+
+    /// Entries by fingerprint; entries of colliding values share a key
+    using Fingerprints_t = std::unordered_multimap<std::size_t, uint32_t>;
+
+    /// @brief Slots of values, in memory or in the scratch file of a level
+    struct Block
+    {
+        HugePageRegion region;        ///< Memory storage (unless spilled)
+        FuncValue_t* data = nullptr;  ///< First slot
+        std::size_t level = 0;        ///< Level being built when the block was added
+        bool spilled = false;         ///< Stored in a scratch file
+    };
+
+    const AtomFuncs<FuncValue_t>* m_atoms = nullptr;  ///< Atomic function library
+    std::size_t m_max_depth = 0;                      ///< Maximum depth of banked trees
+    MemoryBudget* m_budget = nullptr;                 ///< Budget shared with other caches
+    bool m_huge_pages = false;                        ///< Back value blocks by huge pages
+    std::string m_spill_dir;                          ///< Directory of scratch files (empty - no spilling)
+    std::size_t m_tile = 0;                           ///< Entries per side of a binary combination tile
+    const Chains_t* m_chains = nullptr;               ///< Composition tables of unary chains
+    std::vector<std::size_t> m_chain;                 ///< Atoms of the chain being recomputed
+    std::size_t m_samples = 0;                        ///< Values per slot
+    std::size_t m_stride = 0;                         ///< Values between slot starts
+    std::size_t m_block_slots = 0;                    ///< Slots per block
+    std::size_t m_block_bytes = 0;                    ///< Bytes per block, whole huge pages
+    std::vector<Entry> m_entries;                     ///< Banked values in enumeration order
+    std::vector<std::size_t> m_levels{0};             ///< First entry per level
+    Fingerprints_t m_fingerprints;                    ///< Entries by fingerprint of their values
+    std::vector<Block> m_blocks;                      ///< Value storage; slots keep their block
+    std::vector<ScratchFile> m_spill;                 ///< Scratch file per level (with spilling)
+    std::vector<uint32_t> m_owner;                    ///< Entry per slot (NONE - free)
+    std::vector<uint32_t> m_free;                     ///< Free slots
+    Cursor m_cursor;                                  ///< Position of the current candidate
+    Entry m_current;                                  ///< Current candidate
+    FuncValues_t m_values;                            ///< Values of the current candidate
+    FuncValues_t m_recomputed;                        ///< Values of an evicted entry to compare with
+    std::size_t m_fingerprint = 0;                    ///< Fingerprint of the current candidate
+    std::size_t m_dropped = 0;                        ///< Values visited but not banked
+    std::size_t m_collisions = 0;                     ///< New values with the fingerprint of banked ones
+    std::size_t m_spilled = 0;                        ///< Bytes of spilled blocks
+    bool m_started = false;                           ///< First candidate was visited
+    bool m_finished = false;                          ///< All levels done
+    bool m_deepened = false;                          ///< Finished, then max_depth was raised
+
+    [[nodiscard]] std::size_t BlockBytes() const { return m_block_bytes; }
+
+    [[nodiscard]] std::size_t LevelSize(std::size_t level) const { return m_levels[level + 1] - m_levels[level]; }
+
+    [[nodiscard]] std::span<FuncValue_t> SlotValues(std::size_t slot)
+    {
+        return {m_blocks[slot / m_block_slots].data + ((slot % m_block_slots) * m_stride), m_samples};
+    }
+
+    /**
+     * @brief Move cursor to the next raw combination
+     * @return true if moved, false if max_depth is done or a level came out empty
+     */
+    bool Step()
+    {
+        if (not m_started) {
+            m_started = true;
+            return true;
+        }
+        if (m_deepened) {
+            // The cursor is past the end of the last level built.
+            m_deepened = false;
+            return NextLevel();
+        }
+        auto& c = m_cursor;
+        if (c.level == 0) {
+            return (++c.op < m_atoms->arg0.size()) or NextLevel();
+        }
+        const auto first = m_levels[c.level - 1];
+        const auto below = m_levels[c.level];
+        if (c.op < m_atoms->arg1.size()) {
+            if (++c.right < below) {
+                return true;
+            }
+            ++c.op;
+            return StartOp() or NextLevel();
+        }
+        return NextPair(first, below) or NextLevel();
+    }
+
+    /**
+     * @brief Move cursor to the next pair of operands of the binary atoms
+     * @return false if all pairs are done
+     *
+     * Tiles are walked row by row: the tiles of first operands for a tile
+     * of second operands. Every binary atom is applied to a pair of tiles
+     * before the next one, each to all its pairs, row by row, so a tile is
+     * read (from disk, if spilled) once per tile of the other operand, not
+     * once per atom. Pairs of operands both from below level d-1 are skipped.
+     */
+    bool NextPair(std::size_t first, std::size_t below)
+    {
+        auto& c = m_cursor;
+        const auto unary = m_atoms->arg1.size();
+        do {
+            const auto tile_right = c.right - (c.right % m_tile);
+            const auto tile_left = c.left - (c.left % m_tile);
+            const auto right_end = tile_right + std::min(m_tile, below - tile_right);
+            const auto left_end = tile_left + std::min(m_tile, below - tile_left);
+            if ((c.right < first) and (c.left + 1 < first)) {
+                // At least one operand is from the previous level.
+                c.left = std::min(first, left_end) - 1;
+            }
+            if (++c.left < left_end) {
+                continue;
+            }
+            if (++c.right < right_end) {
+                c.left = tile_left;
+                continue;
+            }
+            if (++c.op < unary + m_atoms->arg2.size()) {
+                c.right = tile_right;
+                c.left = tile_left;
+                continue;
+            }
+            c.op = unary;
+            if (left_end < below) {
+                c.right = tile_right;
+                c.left = left_end;
+            }
+            else if (right_end < below) {
+                c.right = right_end;
+                c.left = 0;
+            }
+            else {
+                return false;
+            }
+        } while ((c.right < first) and (c.left < first));
+        return true;
+    }
+
+    /// @brief Sort key of a position in the tiled enumeration order: unary atoms, then tile pairs
+    [[nodiscard]] auto Order(const Cursor& c) const
+    {
+        if ((c.level == 0) or (c.op < m_atoms->arg1.size())) {
+            return std::tuple(c.level, c.op, std::size_t{0}, std::size_t{0}, std::size_t{0}, c.right, c.left);
+        }
+        return std::tuple(c.level, m_atoms->arg1.size(), c.right / m_tile, c.left / m_tile, c.op, c.right, c.left);
+    }
+
+    /// @brief Size of the L2 cache in bytes, 1 MiB if unknown
+    [[nodiscard]] static std::size_t CacheBytes()
+    {
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+        if (const auto bytes = ::sysconf(_SC_LEVEL2_CACHE_SIZE); bytes > 0) {
+            return static_cast<std::size_t>(bytes);
+        }
+#endif
+        std::ifstream size_file("/sys/devices/system/cpu/cpu0/cache/index2/size");
+        std::size_t kib = 0;
+        if (size_file >> kib) {
+            return kib * 1024;
+        }
+        return std::size_t{1} << 20U;
+    }
+
+    /**
+     * @brief Move cursor to the first combination of its atom
+     * @return false if all atoms of the level are done
+     */
+    bool StartOp()
+    {
+        auto& c = m_cursor;
+        if (c.op >= m_atoms->arg1.size() + m_atoms->arg2.size()) {
+            return false;
+        }
+        const auto first = m_levels[c.level - 1];
+        if (c.op < m_atoms->arg1.size()) {
+            c.right = first;
+            c.left = 0;
+            return true;
+        }
+        c.right = 0;
+        c.left = 0;
+        return (first == 0) or NextPair(first, m_levels[c.level]);
+    }
+
+    bool NextLevel()
+    {
+        if (m_cursor.level >= m_max_depth) {
+            return false;
+        }
+        m_levels.push_back(m_entries.size());
+        const auto level = m_cursor.level + 1;
+        m_cursor = Cursor{};
+        m_cursor.level = level;
+        return (LevelSize(level - 1) > 0) and StartOp();
+    }
+
+    /**
+     * @brief Evaluate the combination at the cursor
+     * @return true if it is canonical and its values are new
+     */
+    bool Candidate()
+    {
+        const auto& c = m_cursor;
+        m_current = Entry{};
+        m_current.level = static_cast<uint8_t>(c.level);
+        if (c.level == 0) {
+            const auto* leaf = m_atoms->arg0[c.op];
+            m_current.atom = AtomIndex{0, c.op};
+            m_current.constant = leaf->Constant();
+            m_values = leaf->Calculate();
+        }
+        else {
+            const auto unary = m_atoms->arg1.size();
+            const auto right = static_cast<uint32_t>(c.right);
+            if (c.op < unary) {
+                m_current.atom = AtomIndex{1, c.op};
+                m_current.arg1 = right;
+                m_current.constant = m_entries[right].constant;
+            }
+            else {
+                const auto* atom = m_atoms->arg2[c.op - unary];
+                m_current.atom = AtomIndex{2, c.op - unary};
+                m_current.arg1 = static_cast<uint32_t>(c.left);
+                m_current.arg2 = right;
+                m_current.constant = m_entries[c.left].constant and m_entries[right].constant;
+                // Pairs (new, old) mirror pairs (old, new); new pairs are kept in one order.
+                const auto first = m_levels[c.level - 1];
+                if (SKIP_SYMMETRIC and atom->Commutative() and
+                    ((c.right < first) or
+                     ((c.left >= first) and (atom->Idempotent() ? (c.left >= right) : (c.left > right))))) {
+                    return false;
+                }
+            }
+            if (SKIP_CONSTANT and m_current.constant) {
+                return false;
+            }
+            m_values.resize(m_samples);
+            Evaluate(m_current, m_values);
+            if (SKIP_CONSTANT and
+                (std::ranges::adjacent_find(m_values, std::ranges::not_equal_to{}) == m_values.end())) {
+                return false;
+            }
+        }
+        m_fingerprint = Fingerprint(m_values);
+        const auto [first, last] = m_fingerprints.equal_range(m_fingerprint);
+        if (first == last) {
+            return true;
+        }
+        for (auto it = first; it != last; ++it) {
+            if (std::ranges::equal(Banked(it->second), m_values)) {
+                return false;
+            }
+        }
+        ++m_collisions;
+        return true;
+    }
+
+    /**
+     * @brief Get values of an entry to compare a candidate with
+     *
+     * Unlike Values(), counts no use of the entry and takes no slot for
+     * it: an evicted value is recomputed into a scratch buffer.
+     */
+    std::span<const FuncValue_t> Banked(std::size_t index)
+    {
+        const auto& entry = m_entries[index];
+        if (entry.atom.arity == 0) {
+            return m_atoms->arg0[entry.atom.num]->Calculate();
+        }
+        if (entry.slot != NONE) {
+            return SlotValues(entry.slot);
+        }
+        m_recomputed.resize(m_samples);
+        Evaluate(entry, m_recomputed);
+        return m_recomputed;
+    }
+
+    /// @brief Bank the current candidate
+    void Admit()
+    {
+        if ((m_entries.size() >= NONE) or (not ChargeEntry())) {
+            ++m_dropped;
+            return;
+        }
+        m_fingerprints.emplace(m_fingerprint, static_cast<uint32_t>(m_entries.size()));
+        auto entry = m_current;
+        if (entry.atom.arity > 0) {
+            entry.slot = AllocSlot();
+            std::ranges::copy(m_values, SlotValues(entry.slot).begin());
+            m_owner[entry.slot] = static_cast<uint32_t>(m_entries.size());
+        }
+        m_entries.push_back(entry);
+    }
+
+    /**
+     * @brief Get values of an entry as an operand
+     *
+     * Counts the use and recomputes an evicted value.
+     */
+    std::span<const FuncValue_t> Values(std::size_t index)
+    {
+        auto& entry = m_entries[index];
+        entry.uses += (entry.uses < NONE) ? 1U : 0U;
+        if (entry.atom.arity == 0) {
+            return m_atoms->arg0[entry.atom.num]->Calculate();
+        }
+        if (entry.slot == NONE) {
+            const auto slot = static_cast<uint32_t>(AllocSlot());
+            Evaluate(entry, SlotValues(slot));
+            entry.slot = slot;
+            m_owner[slot] = static_cast<uint32_t>(index);
+        }
+        return SlotValues(entry.slot);
+    }
+
+    /**
+     * @brief Apply the atom of an entry to its operand values
+     * @param entry Unary or binary entry, not necessarily banked
+     * @param out Output buffer; operands are pinned while it is computed
+     *
+     * With chain tables, a unary atom over evicted unary operands is one
+     * lookup into the values of the first operand still banked, instead
+     * of recomputing each evicted value.
+     */
+    void Evaluate(const Entry& entry, std::span<FuncValue_t> out)
+    {
+        if ((entry.atom.arity == 1) and (m_chains != nullptr)) {
+            m_chain.assign(1, entry.atom.num);
+            auto operand = entry.arg1;
+            while ((m_chain.size() < m_chains->MaxLength()) and (m_entries[operand].atom.arity == 1) and
+                   (m_entries[operand].slot == NONE)) {
+                m_chain.push_back(m_entries[operand].atom.num);
+                operand = m_entries[operand].arg1;
+            }
+            if (m_chain.size() >= 2) {
+                // The table is found before the operand values may recompute other chains.
+                const auto table = m_chains->Find(m_chain);
+                Chains_t::Apply(table, Values(operand), out);
+                return;
+            }
+        }
+        if (entry.atom.arity == 1) {
+            const auto* atom = m_atoms->arg1[entry.atom.num];
+            const auto arg = Values(entry.arg1);
+            if (atom->Elementwise()) {
+                atom->CalculateTile(arg, out);
+            }
+            else {
+                std::ranges::copy(atom->Calculate(FuncValues_t(arg.begin(), arg.end())), out.begin());
+            }
+            return;
+        }
+        const auto* atom = m_atoms->arg2[entry.atom.num];
+        const auto arg2 = Values(entry.arg2);
+        ++m_entries[entry.arg2].pins;
+        const auto arg1 = Values(entry.arg1);
+        if (atom->Elementwise()) {
+            atom->CalculateTile(arg1, arg2, out);
+        }
+        else {
+            std::ranges::copy(
+                atom->Calculate(FuncValues_t(arg1.begin(), arg1.end()), FuncValues_t(arg2.begin(), arg2.end())),
+                out.begin());
+        }
+        --m_entries[entry.arg2].pins;
+    }
+
+    /// @brief Take a free slot, growing the storage or evicting values if needed
+    std::size_t AllocSlot()
+    {
+        if (m_free.empty() and (not Grow(m_blocks.empty()))) {
+            Evict();
+            if (m_free.empty()) {
+                // Every resident value is an operand in use.
+                Grow(true);
+            }
+        }
+        const auto slot = m_free.back();
+        m_free.pop_back();
+        return slot;
+    }
+
+    /**
+     * @brief Add a block of slots, in a scratch file if memory is over budget
+     * @param force Charge the budget even beyond its limit
+     * @return true if added
+     */
+    bool Grow(bool force)
+    {
+        Block block;
+        block.level = m_cursor.level;
+        if (force) {
+            m_budget->Force(BlockBytes());
+        }
+        else if (not m_budget->Charge(BlockBytes())) {
+            block.data = SpillSpace(block.level);
+            if (block.data == nullptr) {
+                return false;
+            }
+            block.spilled = true;
+            m_spilled += BlockBytes();
+        }
+        if (not block.spilled) {
+            block.region = HugePageRegion(BlockBytes(), m_huge_pages);
+            block.data = static_cast<FuncValue_t*>(block.region.Data());
+        }
+        m_blocks.push_back(std::move(block));
+        const auto first = m_owner.size();
+        m_owner.resize(first + m_block_slots, NONE);
+        for (auto slot = m_owner.size(); slot > first; --slot) {
+            m_free.push_back(static_cast<uint32_t>(slot - 1));
+        }
+        return true;
+    }
+
+    /// @brief Evict the resident values least worth keeping
+    void Evict()
+    {
+        std::vector<uint32_t> resident;
+        resident.reserve(m_owner.size());
+        for (const auto owner : m_owner) {
+            if ((owner != NONE) and (m_entries[owner].pins == 0)) {
+                resident.push_back(owner);
+            }
+        }
+        if (resident.empty()) {
+            return;
+        }
+        // Lower (uses + 1) / level first, compared without division.
+        const auto first_out = [this](uint32_t a, uint32_t b) {
+            const auto& ea = m_entries[a];
+            const auto& eb = m_entries[b];
+            return ((uint64_t{ea.uses} + 1) * eb.level) < ((uint64_t{eb.uses} + 1) * ea.level);
+        };
+        const auto count = std::max<std::size_t>(resident.size() / EVICT_SHARE, 1);
+        std::ranges::nth_element(resident, resident.begin() + static_cast<std::ptrdiff_t>(count - 1), first_out);
+        for (std::size_t i = 0; i < count; ++i) {
+            auto& entry = m_entries[resident[i]];
+            m_owner[entry.slot] = NONE;
+            m_free.push_back(entry.slot);
+            entry.slot = NONE;
+        }
+        m_budget->Evicted(count);
+    }
+
+    /// @brief Charge a new entry, moving value blocks to disk or giving them back if needed
+    bool ChargeEntry()
+    {
+        while (not m_budget->Charge(ENTRY_BYTES)) {
+            if (not m_spill_dir.empty()) {
+                if (not SpillBlock()) {
+                    return false;
+                }
+                continue;
+            }
+            if (m_blocks.size() <= 1) {
+                return false;
+            }
+            // No operand is pinned between candidates, so the last block can go.
+            const auto first = m_owner.size() - m_block_slots;
+            std::size_t evicted = 0;
+            for (auto slot = first; slot < m_owner.size(); ++slot) {
+                if (m_owner[slot] != NONE) {
+                    m_entries[m_owner[slot]].slot = NONE;
+                    ++evicted;
+                }
+            }
+            m_owner.resize(first);
+            std::erase_if(m_free, [first](uint32_t slot) { return slot >= first; });
+            m_blocks.pop_back();
+            m_budget->Release(BlockBytes());
+            m_budget->Evicted(evicted);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Move the last block held in memory to a scratch file
+     * @return true if moved, false if no block is left in memory or the file failed
+     *
+     * Called between candidates only, when no slot is referenced.
+     */
+    bool SpillBlock()
+    {
+        const auto it = std::ranges::find_if(m_blocks.rbegin(), m_blocks.rend(),
+                                             [](const Block& block) { return not block.spilled; });
+        if (it == m_blocks.rend()) {
+            return false;
+        }
+        auto* values = SpillSpace(it->level);
+        if (values == nullptr) {
+            return false;
+        }
+        std::copy_n(it->data, m_block_slots * m_stride, values);
+        it->region = HugePageRegion();
+        it->data = values;
+        it->spilled = true;
+        m_spilled += BlockBytes();
+        m_budget->Release(BlockBytes());
+        return true;
+    }
+
+    /**
+     * @brief Take room for a block in the scratch file of a level
+     * @return First slot, nullptr without a spill directory or if the file failed
+     */
+    FuncValue_t* SpillSpace(std::size_t level)
+    {
+        if (m_spill_dir.empty()) {
+            return nullptr;
+        }
+        while (m_spill.size() <= level) {
+            m_spill.emplace_back(m_spill_dir, SPILL_EXTENT_BLOCKS * BlockBytes());
+        }
+        return static_cast<FuncValue_t*>(m_spill[level].Append(BlockBytes()));
+    }
+
+    [[nodiscard]] static std::size_t Fingerprint(std::span<const FuncValue_t> values)
+    {
+        std::size_t hash = HashMix(values.size());
+        for (const auto& value : values) {
+            hash = HashMix(hash ^ std::hash<FuncValue_t>{}(value));
+        }
+        return hash;
+    }
+
+    [[nodiscard]] std::string EntryRepr(const Entry& entry) const
+    {
+        switch (entry.atom.arity) {
+            case 0:
+                return m_atoms->arg0[entry.atom.num]->Str();
+            case 1:
+                return std::format("{}({})", m_atoms->arg1[entry.atom.num]->Str(), EntryRepr(m_entries[entry.arg1]));
+            default:
+                return std::format("{}({};{})", m_atoms->arg2[entry.atom.num]->Str(), EntryRepr(m_entries[entry.arg1]),
+                                   EntryRepr(m_entries[entry.arg2]));
+        }
+    }
+
+    /**
+     * @brief Rebuild a tree node from an entry
+     * @return true if the subtree changed
+     */
+    template <typename FN_t>
+    bool Build(FN_t& node, const Entry& entry) const
+    {
+        bool changed = node.SetAtom(entry.atom);
+        if (entry.atom.arity >= 1) {
+            changed = Build(node.Arg1(), m_entries[entry.arg1]) or changed;
+        }
+        if (entry.atom.arity == 2) {
+            changed = Build(node.Arg2(), m_entries[entry.arg2]) or changed;
+        }
+        if (changed) {
+            node.ClearCalculated();
+        }
+        return changed;
+    }
+};
+
+/// @} // end of FunctionNodes group
+
+}  // namespace fw
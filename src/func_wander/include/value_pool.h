@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "huge_pages.h"
+
+namespace fw
+{
+
+/// @addtogroup Common
+/// @{
+
+/**
+ * @class ValuePool
+ * @brief Contiguous, cache-line-aligned value buffers indexed by slot
+ * @tparam FuncValue_t Type of function values (trivially copyable)
+ *
+ * All slots live in one allocation. Each slot starts on a cache line
+ * and its stride is rounded up to whole cache lines, so neighbouring
+ * slots never share a line and vector loads of a slot are aligned.
+ * Evaluators index slots by tree position or stack depth, so the
+ * working set of one evaluation stays small and contiguous; FuncNode
+ * trees take slots node by node from a NodePool.
+ * Pools of at least one huge page can be backed by huge pages, see
+ * HugePageRegion.
+ */
+template <typename FuncValue_t>
+class ValuePool
+{
+    static_assert(std::is_trivially_copyable_v<FuncValue_t>, "pool slots are raw memory");
+
+   public:
+    /// Alignment and stride granularity of slots in bytes
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    ValuePool() = default;
+
+    /**
+     * @brief Allocate zeroed slots
+     * @param slots Number of slots
+     * @param samples Values per slot
+     * @param huge_pages Back large pools by huge pages where possible
+     */
+    ValuePool(std::size_t slots, std::size_t samples, bool huge_pages = false) : m_huge_pages(huge_pages)
+    {
+        Reset(slots, samples);
+    }
+
+    /**
+     * @brief Reshape pool, reusing the allocation if it is large enough
+     * @param slots Number of slots
+     * @param samples Values per slot
+     *
+     * Contents are zeroed.
+     */
+    void Reset(std::size_t slots, std::size_t samples)
+    {
+        m_samples = samples;
+        m_stride = SlotStride(samples);
+        m_slots = slots;
+        if (m_slots * m_stride > m_capacity) {
+            m_capacity = m_slots * m_stride;
+            m_region = HugePageRegion(m_capacity * sizeof(FuncValue_t), m_huge_pages);
+        }
+        std::fill_n(Data(), m_capacity, FuncValue_t{});
+    }
+
+    /**
+     * @brief Make room for more slots, keeping the contents of existing ones
+     * @param slots Minimum number of slots
+     */
+    void Reserve(std::size_t slots)
+    {
+        if (slots <= m_slots) {
+            return;
+        }
+        if (slots * m_stride > m_capacity) {
+            const auto capacity = std::max(slots, 2 * m_slots) * m_stride;
+            HugePageRegion region{capacity * sizeof(FuncValue_t), m_huge_pages};
+            auto* data = static_cast<FuncValue_t*>(region.Data());
+            std::copy_n(Data(), m_slots * m_stride, data);
+            std::fill_n(data + (m_slots * m_stride), capacity - (m_slots * m_stride), FuncValue_t{});
+            m_region = std::move(region);
+            m_capacity = capacity;
+        }
+        m_slots = slots;
+    }
+
+    /// @brief Get values of a slot
+    [[nodiscard]] std::span<FuncValue_t> Slot(std::size_t slot)
+    {
+        return {Data() + (slot * m_stride), m_samples};
+    }
+
+    /// @brief Get values of a slot
+    [[nodiscard]] std::span<const FuncValue_t> Slot(std::size_t slot) const
+    {
+        return {Data() + (slot * m_stride), m_samples};
+    }
+
+    /// @brief Number of slots
+    [[nodiscard]] std::size_t Slots() const { return m_slots; }
+
+    /// @brief Values per slot
+    [[nodiscard]] std::size_t Samples() const { return m_samples; }
+
+    /// @brief Distance between slot starts in values
+    [[nodiscard]] std::size_t Stride() const { return m_stride; }
+
+    /// @brief Allocated bytes
+    [[nodiscard]] std::size_t Bytes() const { return m_region.Size(); }
+
+    /// @brief Allocated bytes actually backed by huge pages
+    [[nodiscard]] std::size_t HugeBytes() const { return m_region.HugeBytes(); }
+
+    /// @brief Address range and backing of the allocation, see HugePageRegion::HugeBytes()
+    [[nodiscard]] HugePageRegion::Extent GetExtent() const { return m_region.GetExtent(); }
+
+    /// @brief Slot stride in values: whole cache lines, unless values do not tile a line
+    [[nodiscard]] static std::size_t SlotStride(std::size_t samples)
+    {
+        if constexpr (ALIGNMENT % sizeof(FuncValue_t) == 0) {
+            constexpr std::size_t PER_LINE = ALIGNMENT / sizeof(FuncValue_t);
+            return std::max<std::size_t>((samples + PER_LINE - 1) / PER_LINE * PER_LINE, 1);
+        }
+        return std::max<std::size_t>(samples, 1);
+    }
+
+   private:
+    HugePageRegion m_region;     ///< All slots
+    std::size_t m_capacity = 0;  ///< Allocated values
+    std::size_t m_slots = 0;     ///< Slots in use
+    std::size_t m_samples = 0;   ///< Values per slot
+    std::size_t m_stride = 0;    ///< Values between slot starts
+    bool m_huge_pages = false;   ///< Try huge pages for large allocations
+
+    [[nodiscard]] FuncValue_t* Data() const { return static_cast<FuncValue_t*>(m_region.Data()); }
+};
+
+/**
+ * @class NodePool
+ * @brief ValuePool whose slots are taken and returned one at a time
+ * @tparam FuncValue_t Type of function values (trivially copyable)
+ *
+ * The nodes of one FuncNode tree share a pool: a calculated node holds
+ * the index of its slot and returns it when the node goes away, so the
+ * values of the whole tree stay in one cache-line-aligned allocation.
+ * The pool grows by doubling and moves the slots then, so a span of a
+ * slot is valid until the next Acquire().
+ */
+template <typename FuncValue_t>
+class NodePool
+{
+   public:
+    /// Index of no slot
+    static constexpr std::size_t NONE = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * @brief Construct empty pool
+     * @param samples Values per slot
+     */
+    explicit NodePool(std::size_t samples) { m_pool.Reset(0, samples); }
+
+    /// @brief Take a free slot, growing the pool if there is none
+    std::size_t Acquire()
+    {
+        if (not m_free.empty()) {
+            const auto slot = m_free.back();
+            m_free.pop_back();
+            return slot;
+        }
+        const auto slot = m_pool.Slots();
+        m_pool.Reserve(slot + 1);
+        return slot;
+    }
+
+    /// @brief Return a slot taken by Acquire()
+    void Release(std::size_t slot) { m_free.push_back(slot); }
+
+    /// @brief Get values of a slot
+    [[nodiscard]] std::span<FuncValue_t> Slot(std::size_t slot) { return m_pool.Slot(slot); }
+
+    /// @brief Get values of a slot
+    [[nodiscard]] std::span<const FuncValue_t> Slot(std::size_t slot) const { return m_pool.Slot(slot); }
+
+    /// @brief Number of slots taken and not returned
+    [[nodiscard]] std::size_t Used() const { return m_pool.Slots() - m_free.size(); }
+
+    /// @brief Allocated bytes
+    [[nodiscard]] std::size_t Bytes() const { return m_pool.Bytes(); }
+
+   private:
+    ValuePool<FuncValue_t> m_pool;    ///< Slots
+    std::vector<std::size_t> m_free;  ///< Returned slots
+};
+
+/// @} // end of Common group
+
+}  // namespace fw
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <bitset>
+#include <bit>
+#include <string_view>
 
 #include <atom.h>
+#include <static_atoms.h>
 
 using fw::AtomFunc0;
 using fw::AtomFunc1;
@@ -68,145 +70,49 @@ class AF_ARG_X : public AtomFunc0<uint16_t>
     Characteristics<uint16_t> m_chars;
 };
 
-class AF_NOT : public AtomFunc1<uint16_t>
-{
-   public:
-    ~AF_NOT() override = default;
-
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg) const override
-    {
-        assert(arg.size() == VALUES_RANGE);
-        FuncValues_t res;
-        res.reserve(VALUES_RANGE);
-        for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
-            res.push_back(~arg[i]);
-        }
-        return res;
-    }
+// Kernels of the elementwise atoms, shared by compile-time atom sets (see fw::StaticAtomSet)
+// and the runtime atoms below, so each atom has a single definition.
 
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<uint16_t>& arg_chars) const override
-    {
-        return true;
-    }
-
-    [[nodiscard]] [[nodiscard]] bool Involutive() const override { return true; }
-    [[nodiscard]] bool Argument() const override { return false; }
-
-    [[nodiscard]] std::string Str() const override { return "NOT"; }
+struct K_NOT
+{
+    static constexpr std::string_view NAME = "NOT";
+    static constexpr bool INVOLUTIVE = true;
+    static constexpr uint16_t Apply(uint16_t x) { return static_cast<uint16_t>(~x); }
 };
 
-class AF_BITCOUNT : public AtomFunc1<uint16_t>
+struct K_BITCOUNT
 {
-   public:
-    ~AF_BITCOUNT() override = default;
-
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg) const override
-    {
-        assert(arg.size() == VALUES_RANGE);
-        FuncValues_t res;
-        res.reserve(VALUES_RANGE);
-        for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
-            res.push_back(std::bitset<16>{arg[i]}.count());
-        }
-        return res;
-    }
-
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<uint16_t>& arg_chars) const override
-    {
-        return true;
-    }
-
-    [[nodiscard]] bool Involutive() const override { return true; }
-    [[nodiscard]] bool Argument() const override { return false; }
-
-    [[nodiscard]] std::string Str() const override { return "BITCOUNT"; }
+    static constexpr std::string_view NAME = "BITCOUNT";
+    static constexpr bool INVOLUTIVE = true;
+    static constexpr uint16_t Apply(uint16_t x) { return static_cast<uint16_t>(std::popcount(x)); }
 };
 
-class AF_SUM : public AtomFunc2<uint16_t>
+struct K_SUM
 {
-   public:
-    ~AF_SUM() override = default;
-
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
-    {
-        assert(arg1.size() == VALUES_RANGE);
-        assert(arg2.size() == VALUES_RANGE);
-        FuncValues_t res;
-        res.reserve(VALUES_RANGE);
-        for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
-            res.push_back(arg1[i] + arg2[i]);
-        }
-        return res;
-    }
-
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<uint16_t>& arg1_chars,
-                                  [[maybe_unused]] const Characteristics<uint16_t>& arg2_chars) const override
-    {
-        return true;
-    }
-
-    [[nodiscard]] bool Commutative() const override { return true; }
-    [[nodiscard]] bool Idempotent() const override { return false; }
-
-    [[nodiscard]] std::string Str() const override { return "SUM"; }
+    static constexpr std::string_view NAME = "SUM";
+    static constexpr bool COMMUTATIVE = true;
+    static constexpr bool IDEMPOTENT = false;
+    static constexpr uint16_t Apply(uint16_t x, uint16_t y) { return static_cast<uint16_t>(x + y); }
 };
 
-class AF_AND : public AtomFunc2<uint16_t>
+struct K_AND
 {
-   public:
-    ~AF_AND() override = default;
-
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
-    {
-        assert(arg1.size() == VALUES_RANGE);
-        assert(arg2.size() == VALUES_RANGE);
-        FuncValues_t res;
-        res.reserve(VALUES_RANGE);
-        for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
-            res.push_back(arg1[i] & arg2[i]);
-        }
-        return res;
-    }
-
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<uint16_t>& arg1_chars,
-                                  [[maybe_unused]] const Characteristics<uint16_t>& arg2_chars) const override
-    {
-        return true;
-    }
-
-    [[nodiscard]] bool Commutative() const override { return true; }
-
-    [[nodiscard]] bool Idempotent() const override { return true; }
-
-    [[nodiscard]] std::string Str() const override { return "AND"; }
+    static constexpr std::string_view NAME = "AND";
+    static constexpr bool COMMUTATIVE = true;
+    static constexpr bool IDEMPOTENT = true;
+    static constexpr uint16_t Apply(uint16_t x, uint16_t y) { return static_cast<uint16_t>(x & y); }
 };
 
-class AF_OR : public AtomFunc2<uint16_t>
+struct K_OR
 {
-   public:
-    ~AF_OR() override = default;
-
-    [[nodiscard]] FuncValues_t Calculate(const FuncValues_t& arg1, const FuncValues_t& arg2) const override
-    {
-        assert(arg1.size() == VALUES_RANGE);
-        assert(arg2.size() == VALUES_RANGE);
-        FuncValues_t res;
-        res.reserve(VALUES_RANGE);
-        for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
-            res.push_back(arg1[i] | arg2[i]);
-        }
-        return res;
-    }
-
-    [[nodiscard]] bool CheckChars([[maybe_unused]] const Characteristics<uint16_t>& arg1_chars,
-                                  [[maybe_unused]] const Characteristics<uint16_t>& arg2_chars) const override
-    {
-        return true;
-    }
-
-    [[nodiscard]] bool Commutative() const override { return true; }
-
-    [[nodiscard]] bool Idempotent() const override { return true; }
+    static constexpr std::string_view NAME = "OR";
+    static constexpr bool COMMUTATIVE = true;
+    static constexpr bool IDEMPOTENT = true;
+    static constexpr uint16_t Apply(uint16_t x, uint16_t y) { return static_cast<uint16_t>(x | y); }
+};
 
-    [[nodiscard]] std::string Str() const override { return "OR"; }
-};
\ No newline at end of file
+using AF_NOT = fw::StaticAtom1<uint16_t, K_NOT>;
+using AF_BITCOUNT = fw::StaticAtom1<uint16_t, K_BITCOUNT>;
+using AF_SUM = fw::StaticAtom2<uint16_t, K_SUM>;
+using AF_AND = fw::StaticAtom2<uint16_t, K_AND>;
+using AF_OR = fw::StaticAtom2<uint16_t, K_OR>;
@@ -2,23 +2,78 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <memory>
 #include <print>
+#include <ranges>
+#include <set>
+#include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <atom_samples.h>
+#include <best_first.h>
+#include <canonical_count.h>
 #include <common.h>
+#include <dag_program.h>
 #include <func_node.h>
+#include <generators.h>
+#include <gf2_affine.h>
+#include <lut_atoms.h>
+#include <node_store.h>
 #include <search_task.h>
+#include <shape_enum.h>
+#include <size_order.h>
+#include <static_atoms.h>
 #include <target.h>
+#include <target_file.h>
+#include <tiled_eval.h>
+#include <value_bank.h>
+#include <value_pool.h>
 
 using fw::AtomFuncs;
+using fw::AtomList;
+using fw::BestFirst;
+using fw::BigSerialNumber;
+using fw::CanonicalCounter;
+using fw::DagProgram;
 using fw::Distance;
+using fw::FileTarget;
 using fw::FuncNode;
+using fw::FusedPattern;
+using fw::HugePageRegion;
+using fw::LutAtom1;
+using fw::MemoryBudget;
+using fw::NodeRef;
+using fw::NodeStore;
 using fw::RangeSet;
+using fw::ScratchFile;
 using fw::SearchTask;
 using fw::Settings;
+using fw::ShapeLabels;
+using fw::SizeOrder;
+using fw::SolveAffine;
+using fw::StaticAtomSet;
+using fw::StaticEvaluator;
+using fw::StaticTileKernels;
 using fw::Target;
+using fw::TargetValues;
+using fw::TiledEvaluator;
+using fw::TreeShapes;
+using fw::UnaryChains;
+using fw::ValueBank;
+using fw::ValuePool;
+#if defined(__cpp_lib_generator)
+using fw::EnumerateDags;
+using fw::EnumerateShapes;
+using fw::EnumerateTrees;
+#endif
+
+/// @brief Copy values returned as a span, e.g. by FuncNode::Calculate()
+static std::vector<uint16_t> Copy(std::span<const uint16_t> values) { return {values.begin(), values.end()}; }
 
 class TestTarget : public Target<uint16_t>
 {
@@ -33,7 +88,7 @@ class TestTarget : public Target<uint16_t>
         }
     }
 
-    [[nodiscard]] Distance Compare(const FuncValues_t& values) const override
+    [[nodiscard]] Distance Compare(std::span<const uint16_t> values) const override
     {
         Distance dist{};
         for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
@@ -44,7 +99,7 @@ class TestTarget : public Target<uint16_t>
         return dist;
     }
 
-    [[nodiscard]] RangeSet<std::size_t> MatchPositions(const FuncValues_t& values) const override
+    [[nodiscard]] RangeSet<std::size_t> MatchPositions(std::span<const uint16_t> values) const override
     {
         RangeSet<std::size_t> rset;
         for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
@@ -72,6 +127,15 @@ std::unique_ptr<AF_SUM> af_sum;
 std::unique_ptr<AF_AND> af_and;
 std::unique_ptr<AF_OR> af_or;
 
+auto MakeTargetValues() -> std::vector<uint16_t>
+{
+    std::vector<uint16_t> values;
+    for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
+        values.push_back(static_cast<uint16_t>((i & 0x0FU) | 0x03U));
+    }
+    return values;
+}
+
 auto MakeAtoms() -> AtomFuncs<uint16_t>
 {
     constexpr uint16_t MAX_CONSTANTS = 3;
@@ -95,6 +159,51 @@ auto MakeAtoms() -> AtomFuncs<uint16_t>
     return atoms;
 }
 
+template <bool SKIP_CONSTANT, bool SKIP_SYMMETRIC>
+void CheckCanonicalRank(std::size_t max_depth)
+{
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    const CanonicalCounter<uint16_t, SKIP_CONSTANT, SKIP_SYMMETRIC> counter{&atoms, max_depth};
+    ASSERT_TRUE(counter.Fits());
+
+    FuncNode<uint16_t, SKIP_CONSTANT, SKIP_SYMMETRIC> fnc{&atoms};
+    fw::SerialNumber_t rank = 0;
+    for (fw::SerialNumber_t snum = 0; snum < fnc.MaxSerialNumber(max_depth); ++snum) {
+        ASSERT_TRUE(fnc.FromSerialNumber(snum));
+        if (not fnc.Pruned(false)) {
+            ASSERT_EQ(counter.Rank(fnc), rank);
+            ++rank;
+        }
+    }
+    ASSERT_EQ(counter.Count(max_depth), rank);
+}
+
+using Task_t = SearchTask<uint16_t, true, true>;
+
+/**
+ * Run a task for some steps, resume a second task from its checkpoint and
+ * run both to the end: they must find the same best functions in as many
+ * iterations. check() sees the task at the checkpoint.
+ */
+void CheckResume(Task_t& task, const Settings& settings, AtomFuncs<uint16_t>* atoms, Target<uint16_t>* target,
+                 std::size_t steps, const std::function<void(Task_t&)>& check = nullptr)
+{
+    for (std::size_t i = 0; i < steps; ++i) {
+        ASSERT_TRUE(task.SearchIterate());
+    }
+    Task_t resumed_task{settings, atoms, target};
+    ASSERT_TRUE(resumed_task.FromJSON(task.ToJSON().dump()));
+    if (check) {
+        check(task);
+    }
+    while (task.SearchIterate()) {
+    }
+    while (resumed_task.SearchIterate()) {
+    }
+    ASSERT_EQ(task.Best(), resumed_task.Best());
+    ASSERT_EQ(task.GetStatus().iterations_count, resumed_task.GetStatus().iterations_count);
+}
+
 }  // namespace
 
 // NOLINTBEGIN(readability-function-cognitive-complexity, readability-function-size)
@@ -123,6 +232,686 @@ TEST(FuncIterator, SerialNumber)
     }
 }
 
+TEST(FuncIterator, BigSerialNumber)
+{
+    constexpr std::size_t FIT_DEPTH = 5;
+    constexpr std::size_t OVERFLOW_DEPTH = 6;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    FuncNode<uint16_t> fnc{&atoms};
+    FuncNode<uint16_t, false, false, BigSerialNumber> big_fnc{&atoms};
+    ASSERT_TRUE(fnc.SerialNumberFits(FIT_DEPTH));
+    ASSERT_FALSE(fnc.SerialNumberFits(OVERFLOW_DEPTH));
+    ASSERT_TRUE(big_fnc.SerialNumberFits(OVERFLOW_DEPTH));
+
+    fw::SerialNumber_t max_sn{};
+    ASSERT_TRUE(fw::ToSerialNumber128(big_fnc.MaxSerialNumber(FIT_DEPTH), max_sn));
+    ASSERT_EQ(max_sn, fnc.MaxSerialNumber(FIT_DEPTH));
+    ASSERT_FALSE(fw::ToSerialNumber128(big_fnc.MaxSerialNumber(OVERFLOW_DEPTH), max_sn));
+
+    while (fnc.Iterate(2)) {
+        ASSERT_TRUE(big_fnc.Iterate(2));
+        ASSERT_EQ(BigSerialNumber(fnc.SerialNumber()), big_fnc.SerialNumber());
+    }
+
+    const auto last = big_fnc.MaxSerialNumber(OVERFLOW_DEPTH) - 1U;
+    ASSERT_TRUE(big_fnc.FromSerialNumber(last));
+    ASSERT_EQ(big_fnc.CurrentMaxLevel(), OVERFLOW_DEPTH);
+    ASSERT_EQ(big_fnc.SerialNumber(), last);
+    ASSERT_FALSE(fnc.FromSerialNumber(fnc.MaxSerialNumber(FIT_DEPTH)));
+
+    BigSerialNumber parsed;
+    ASSERT_TRUE(BigSerialNumber::FromString(last.ToString(), parsed));
+    ASSERT_EQ(parsed, last);
+
+    // Symmetric pruning of trees whose operands overflow SerialNumber_t
+    constexpr std::size_t DEEP_DEPTH = OVERFLOW_DEPTH + 1;
+    constexpr std::size_t DEEP_TREES = 64;
+    FuncNode<uint16_t, false, true, BigSerialNumber> big_sym{&atoms};
+    FuncNode<uint16_t, false, true> sym{&atoms};
+    FuncNode<uint16_t, false, true, BigSerialNumber> big_prev{&atoms};
+    const auto deep_first = big_sym.MaxSerialNumber(DEEP_DEPTH - 1);
+    const auto deep_step = (big_sym.MaxSerialNumber(DEEP_DEPTH) - deep_first) / BigSerialNumber(DEEP_TREES);
+    std::size_t pruned = 0;
+    for (std::size_t i = 0; i < DEEP_TREES; ++i) {
+        const auto snum = deep_first + deep_step * BigSerialNumber(i) + BigSerialNumber(i);
+        ASSERT_TRUE(big_sym.FromSerialNumber(snum));
+        ASSERT_TRUE(sym.FromJSON(big_sym.ToJSON()));
+        fw::SerialNumber_t unused{};
+        ASSERT_FALSE(sym.SerialNumber(unused));
+        ASSERT_EQ(sym.Pruned(false), big_sym.Pruned(false));
+        pruned += sym.Pruned(false) ? 1 : 0;
+        if (i > 0) {
+            ASSERT_EQ(big_sym.CompareSerial(big_prev), 1);
+            ASSERT_EQ(big_prev.CompareSerial(big_sym), -1);
+        }
+        ASSERT_TRUE(big_prev.FromJSON(big_sym.ToJSON()));
+        ASSERT_EQ(big_prev.CompareSerial(big_sym), 0);
+    }
+    ASSERT_GT(pruned, 0);
+
+    Settings settings;
+    settings.max_depth = OVERFLOW_DEPTH;
+    TargetValues<uint16_t> target{MakeTargetValues()};
+    SearchTask<uint16_t> task{settings, &atoms, &target};
+    ASSERT_TRUE(task.GetStatus().sn_overflow);
+    SearchTask<uint16_t, false, false, BigSerialNumber> big_task{settings, &atoms, &target};
+    const auto status = big_task.GetStatus();
+    ASSERT_TRUE(status.sn_overflow);
+    ASSERT_EQ(status.done_percent, 0.0F);
+}
+
+TEST(FuncIterator, CanonicalCount)
+{
+    CheckCanonicalRank<false, false>(2);
+    CheckCanonicalRank<true, false>(2);
+    CheckCanonicalRank<false, true>(2);
+    CheckCanonicalRank<true, true>(2);
+
+    // Every visited tree is canonical, value-constant ones are counted but skipped.
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    const CanonicalCounter<uint16_t, true, true> counter{&atoms, 2};
+    FuncNode<uint16_t, true, true> fnc{&atoms};
+    fw::SerialNumber_t visited = 1;
+    fw::SerialNumber_t last_rank = 0;
+    while (fnc.Iterate(2)) {
+        ++visited;
+        const auto rank = counter.Rank(fnc);
+        ASSERT_GT(rank, last_rank);
+        last_rank = rank;
+    }
+    ASSERT_LT(last_rank, counter.Count(2));
+    ASSERT_LE(visited, counter.Count(2));
+}
+
+TEST(FuncIterator, BestFirst)
+{
+    constexpr std::size_t MAX_COST = 6;
+    constexpr std::size_t BITCOUNT_COST = 3;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    af_bc->SetCost(BITCOUNT_COST);
+    const SizeOrder<uint16_t> order{&atoms, MAX_COST};
+
+    // Unbounded queue: every tree once, in non-decreasing cost.
+    BestFirst<uint16_t> unbounded{&atoms, MAX_COST, SIZE_MAX / 4};
+    FuncNode<uint16_t> fnc{&atoms};
+    std::set<std::string> reprs;
+    std::vector<std::string> sequence;
+    std::size_t last_cost = 0;
+    while (unbounded.Next(fnc)) {
+        ASSERT_GE(fnc.Cost(), last_cost);
+        last_cost = fnc.Cost();
+        reprs.insert(fnc.Repr());
+        sequence.push_back(fnc.Repr());
+    }
+    ASSERT_EQ(reprs.size(), order.Count());
+    ASSERT_EQ(unbounded.Refills(), 0);
+
+    // Small queue: same trees in the same order, at the price of refills.
+    constexpr std::size_t MAX_QUEUE = 16;
+    BestFirst<uint16_t> bounded{&atoms, MAX_COST, MAX_QUEUE};
+    std::vector<std::string> bounded_sequence;
+    while (bounded.Next(fnc)) {
+        ASSERT_LT(bounded.QueueSize(), 2 * MAX_QUEUE);
+        bounded_sequence.push_back(fnc.Repr());
+    }
+    ASSERT_GT(bounded.Refills(), 0);
+    ASSERT_EQ(bounded_sequence, sequence);
+
+    // Resume continues after a given tree.
+    const auto middle = sequence.size() / 2;
+    BestFirst<uint16_t> first{&atoms, MAX_COST, MAX_QUEUE};
+    for (std::size_t i = 0; i <= middle; ++i) {
+        ASSERT_TRUE(first.Next(fnc));
+    }
+    BestFirst<uint16_t> resumed{&atoms, MAX_COST, MAX_QUEUE};
+    resumed.Resume(fnc);
+    ASSERT_TRUE(resumed.Next(fnc));
+    ASSERT_EQ(fnc.Repr(), sequence[middle + 1]);
+}
+
+TEST(FuncIterator, DagProgram)
+{
+    constexpr std::size_t MAX_STEPS = 2;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    DagProgram<uint16_t> dag{&atoms};
+    FuncNode<uint16_t> fnc{&atoms};
+    std::size_t leaves = 0;
+    std::size_t one_step = 0;
+    std::size_t shared = 0;
+    while (dag.Iterate(MAX_STEPS)) {
+        // Cached step values match the expanded tree.
+        dag.ToTree(fnc);
+        ASSERT_EQ(dag.Calculate(), Copy(fnc.Calculate()));
+        if (dag.Steps() == 0) {
+            ASSERT_EQ(one_step, 0);
+            ASSERT_EQ(dag.Repr(), fnc.Repr());
+            ++leaves;
+        }
+        if (dag.Steps() == 1) {
+            ++one_step;
+            ASSERT_EQ(dag.Repr(), fnc.Repr());
+        }
+        if (dag.Repr().starts_with("t0=")) {
+            ++shared;
+        }
+
+        DagProgram<uint16_t> loaded{&atoms};
+        ASSERT_TRUE(loaded.FromJSON(dag.ToJSON()));
+        ASSERT_EQ(loaded, dag);
+    }
+    ASSERT_EQ(leaves, atoms.arg0.size());
+    ASSERT_EQ(one_step, (atoms.arg1.size() * atoms.arg0.size()) +
+                            (atoms.arg2.size() * atoms.arg0.size() * atoms.arg0.size()));
+    ASSERT_GT(shared, 0);
+
+    // Interning keeps sharing: t_k = SUM(t_k-1; t_k-1) is 2^STEPS - 1 nodes as a tree.
+    constexpr std::size_t DOUBLINGS = 40;
+    json j_doubling;
+    j_doubling["steps"] = json::array();
+    for (std::size_t i = 0; i < DOUBLINGS; ++i) {
+        const auto operand = (i == 0) ? std::size_t{0} : atoms.arg0.size() + i - 1;
+        j_doubling["steps"].push_back(
+            {{"arity", std::size_t{2}}, {"num", std::size_t{0}}, {"arg1", operand}, {"arg2", operand}});
+    }
+    DagProgram<uint16_t> doubling{&atoms};
+    ASSERT_TRUE(doubling.FromJSON(j_doubling));
+    NodeStore store;
+    const fw::SharedFunc<uint16_t> shared_func{doubling.Intern(store), doubling.Calculate()};
+    ASSERT_EQ(shared_func.CurrentMaxLevel(), DOUBLINGS);
+    ASSERT_EQ(shared_func.FunctionsCount(), (std::size_t{1} << DOUBLINGS) - 1);
+    ASSERT_EQ(shared_func.UniqueFunctions(), DOUBLINGS);
+}
+
+TEST(FuncIterator, ShapeFirst)
+{
+    constexpr std::size_t MAX_DEPTH = 2;
+
+    const TreeShapes shapes3{3};
+    ASSERT_EQ(shapes3.Count(), 107);
+    std::set<fw::TreeShape> distinct;
+    for (std::size_t i = 0; i < shapes3.Count(); ++i) {
+        distinct.insert(shapes3.Unrank(i));
+    }
+    ASSERT_EQ(distinct.size(), shapes3.Count());
+
+    // Without pruning every tree is visited once, with values of the built tree.
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    const TreeShapes shapes{MAX_DEPTH};
+    FuncNode<uint16_t> fnc{&atoms};
+    std::set<std::string> reprs;
+    for (std::size_t i = 0; i < shapes.Count(); ++i) {
+        ShapeLabels<uint16_t> labels{&atoms, shapes.Unrank(i)};
+        while (labels.Next()) {
+            labels.ToTree(fnc);
+            ASSERT_EQ(labels.Calculate(), Copy(fnc.Calculate()));
+            ASSERT_EQ(labels.Repr(), fnc.Repr());
+            reprs.insert(labels.Repr());
+        }
+    }
+    ASSERT_EQ(reprs.size(), fnc.MaxSerialNumber(MAX_DEPTH));
+
+    // With pruning the same functions are reached as by Iterate().
+    std::set<std::vector<uint16_t>> shaped_values;
+    for (std::size_t i = 0; i < shapes.Count(); ++i) {
+        ShapeLabels<uint16_t, true, true> labels{&atoms, shapes.Unrank(i)};
+        while (labels.Next()) {
+            shaped_values.insert(labels.Calculate());
+        }
+    }
+    std::set<std::vector<uint16_t>> tree_values;
+    FuncNode<uint16_t, true, true> pruned{&atoms};
+    tree_values.insert(Copy(pruned.Calculate()));
+    while (pruned.Iterate(MAX_DEPTH)) {
+        tree_values.insert(Copy(pruned.Calculate()));
+    }
+    ASSERT_EQ(shaped_values, tree_values);
+}
+
+TEST(FuncIterator, GrayOrder)
+{
+    constexpr std::size_t MAX_DEPTH = 2;
+
+    // Consecutive labellings differ in one node, values stay exact.
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    const TreeShapes shapes{MAX_DEPTH};
+    FuncNode<uint16_t> fnc{&atoms};
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < shapes.Count(); ++i) {
+        ShapeLabels<uint16_t> labels{&atoms, shapes.Unrank(i), true};
+        std::vector<std::size_t> previous;
+        while (labels.Next()) {
+            if (not previous.empty()) {
+                std::size_t changed = 0;
+                for (std::size_t node = 0; node < previous.size(); ++node) {
+                    changed += (previous[node] != labels.Labels()[node]) ? 1 : 0;
+                }
+                ASSERT_EQ(changed, 1);
+            }
+            previous = labels.Labels();
+            labels.ToTree(fnc);
+            ASSERT_EQ(labels.Calculate(), Copy(fnc.Calculate()));
+
+            // The tree (i.e. its serial number) maps back to the same position.
+            ShapeLabels<uint16_t> restored{&atoms, shapes.Unrank(i), true};
+            ASSERT_TRUE(restored.FromTree(fnc));
+            ASSERT_EQ(restored.Progress(), labels.Progress());
+            ++count;
+        }
+    }
+    ASSERT_EQ(count, fnc.MaxSerialNumber(MAX_DEPTH));
+
+    // With pruning the same functions are reached as in counter order.
+    std::set<std::vector<uint16_t>> counter_values;
+    std::set<std::vector<uint16_t>> gray_values;
+    for (std::size_t i = 0; i < shapes.Count(); ++i) {
+        ShapeLabels<uint16_t, true, true> counter{&atoms, shapes.Unrank(i)};
+        while (counter.Next()) {
+            counter_values.insert(counter.Calculate());
+        }
+        ShapeLabels<uint16_t, true, true> gray{&atoms, shapes.Unrank(i), true};
+        while (gray.Next()) {
+            gray_values.insert(gray.Calculate());
+        }
+    }
+    ASSERT_EQ(gray_values, counter_values);
+}
+
+#if defined(__cpp_lib_generator)
+TEST(FuncIterator, Generators)
+{
+    constexpr std::size_t MAX_DEPTH = 2;
+
+    // Same trees and values as driving Iterate() directly.
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    std::vector<std::string> reprs;
+    for (const auto& candidate : EnumerateTrees<uint16_t, true, true>(&atoms, MAX_DEPTH)) {
+        reprs.push_back(candidate.Repr());
+        ASSERT_FALSE(candidate.values.empty());
+    }
+    FuncNode<uint16_t, true, true> fnc{&atoms};
+    std::vector<std::string> iterated{fnc.Repr()};
+    while (fnc.Iterate(MAX_DEPTH)) {
+        iterated.push_back(fnc.Repr());
+    }
+    ASSERT_EQ(reprs, iterated);
+
+    // Stages compose lazily.
+    auto shaped = EnumerateShapes<uint16_t, true, true>(&atoms, MAX_DEPTH, true) |
+                  std::views::filter([](const auto& candidate) { return candidate.values[0] == 0; }) |
+                  std::views::take(3);
+    std::size_t taken = 0;
+    for (const auto& candidate : shaped) {
+        ASSERT_EQ(candidate.values[0], 0);
+        ++taken;
+    }
+    ASSERT_EQ(taken, 3);
+
+    std::size_t dags = 0;
+    for (const auto& candidate : EnumerateDags<uint16_t, true, true>(&atoms, 2)) {
+        ASSERT_FALSE(candidate.values.empty());
+        ++dags;
+    }
+    ASSERT_GT(dags, 0);
+}
+#endif
+
+TEST(FuncIterator, NodeStore)
+{
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    FuncNode<uint16_t> fnc{&atoms};
+    NodeStore store;
+    std::vector<NodeRef> roots;
+    for (std::size_t i = 0; i < 300; ++i) {
+        ASSERT_TRUE(fnc.Iterate(2));
+        roots.push_back(store.Intern(fnc));
+
+        // Equal trees share the root, the rebuilt tree is the same.
+        ASSERT_EQ(store.Intern(FuncNode<uint16_t>{fnc}), roots.back());
+        FuncNode<uint16_t> rebuilt{&atoms};
+        NodeStore::ToTree(*roots.back(), rebuilt);
+        ASSERT_EQ(rebuilt.Repr(), fnc.Repr());
+        ASSERT_EQ(NodeStore::Repr(&atoms, *roots.back()), fnc.Repr());
+        ASSERT_EQ(roots.back()->depth, fnc.CurrentMaxLevel());
+        ASSERT_EQ(roots.back()->functions, fnc.FunctionsCount());
+
+        std::unordered_set<fw::SerialNumber_t, fw::SerialNumberHash> uniqs;
+        fnc.UniqFunctionsSerialNumbers(uniqs);
+        ASSERT_EQ(NodeStore::UniqueFunctions(*roots.back()), uniqs.size());
+        ASSERT_EQ(fnc.UniqueFunctions(), uniqs.size());
+        ASSERT_EQ(fnc.StructuralHash(), roots.back()->hash);
+    }
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+        for (std::size_t j = 0; j < i; ++j) {
+            ASSERT_NE(roots[i], roots[j]);
+        }
+    }
+
+    // Subtrees are shared within and between trees: SUM(NOT(X);NOT(X)) is three nodes,
+    // and AND(NOT(X);X) adds only its root.
+    FuncNode<uint16_t> twice{&atoms};
+    twice.SetAtom(fw::AtomIndex{2, 0});
+    twice.Arg1().SetAtom(fw::AtomIndex{1, 0});
+    twice.Arg1().Arg1().SetAtom(fw::AtomIndex{0, 0});
+    twice.Arg2().SetAtom(fw::AtomIndex{1, 0});
+    twice.Arg2().Arg1().SetAtom(fw::AtomIndex{0, 0});
+    ASSERT_EQ(twice.Repr(), "SUM(NOT(X);NOT(X))");
+    NodeStore shared_store;
+    const auto root = shared_store.Intern(twice);
+    ASSERT_EQ(root->arg1, root->arg2);
+    ASSERT_EQ(shared_store.Size(), 3);
+    FuncNode<uint16_t> mixed{twice};
+    mixed.SetAtom(fw::AtomIndex{2, 1});
+    mixed.Arg2().SetAtom(fw::AtomIndex{0, 0});
+    ASSERT_EQ(mixed.Repr(), "AND(NOT(X);X)");
+    const auto mixed_root = shared_store.Intern(mixed);
+    ASSERT_EQ(mixed_root->arg1, root->arg1);
+    ASSERT_EQ(mixed_root->arg2, root->arg1->arg1);
+    ASSERT_EQ(shared_store.Size(), 4);
+    ASSERT_TRUE(NodeStore::Equal(*store.Intern(twice), *root));
+
+    // Deep chains beyond the inline capacity of the hash set.
+    FuncNode<uint16_t> chain{&atoms};
+    for (std::size_t cost = 1; cost <= 40; ++cost) {
+        SizeOrder<uint16_t> order{&atoms, cost};
+        ASSERT_TRUE(order.Unrank(order.CountBelow(cost), chain));
+    }
+    ASSERT_EQ(chain.UniqueFunctions(), NodeStore::UniqueFunctions(*store.Intern(chain)));
+}
+
+TEST(FuncIterator, ValuePool)
+{
+    constexpr std::size_t SAMPLES = 100;
+
+    ValuePool<uint16_t> pool{3, SAMPLES};
+    for (std::size_t slot = 0; slot < pool.Slots(); ++slot) {
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(pool.Slot(slot).data()) % ValuePool<uint16_t>::ALIGNMENT, 0);
+        ASSERT_EQ(pool.Slot(slot).size(), SAMPLES);
+        std::ranges::fill(pool.Slot(slot), static_cast<uint16_t>(slot + 1));
+    }
+    ASSERT_GE(pool.Stride(), SAMPLES);
+
+    // Growing keeps the contents of existing slots.
+    pool.Reserve(20);
+    ASSERT_EQ(pool.Slots(), 20);
+    for (std::size_t slot = 0; slot < 3; ++slot) {
+        ASSERT_TRUE(std::ranges::all_of(pool.Slot(slot), [&](uint16_t v) { return v == slot + 1; }));
+    }
+    ASSERT_TRUE(std::ranges::all_of(pool.Slot(19), [](uint16_t v) { return v == 0; }));
+
+    // Huge pages fall back gracefully; coverage never exceeds the allocation.
+    ValuePool<uint16_t> huge{4, HugePageRegion::HUGE_PAGE / sizeof(uint16_t), true};
+    std::ranges::fill(huge.Slot(3), 7);
+    ASSERT_EQ(huge.Slot(3).back(), 7);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(huge.Slot(1).data()) % ValuePool<uint16_t>::ALIGNMENT, 0);
+    ASSERT_LE(huge.HugeBytes(), huge.Bytes());
+    ASSERT_GE(huge.Bytes(), 4 * HugePageRegion::HUGE_PAGE);
+
+    // Regions counted together never report more than their sizes.
+    ValuePool<uint16_t> other{2, HugePageRegion::HUGE_PAGE / sizeof(uint16_t), true};
+    std::ranges::fill(other.Slot(1), 3);
+    const std::array extents{huge.GetExtent(), other.GetExtent(), pool.GetExtent()};
+    ASSERT_LE(HugePageRegion::HugeBytes(extents), huge.Bytes() + other.Bytes());
+    ASSERT_EQ(HugePageRegion::HugeBytes(std::span{extents}.last(1)), 0);
+}
+
+TEST(FuncIterator, ValueBank)
+{
+    constexpr std::size_t MAX_DEPTH = 2;
+    constexpr std::size_t DEEP = 3;
+    constexpr std::size_t LIMIT = std::size_t{6} << 20U;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    std::set<std::vector<uint16_t>> tree_values;
+    FuncNode<uint16_t, true, true> fnc{&atoms};
+    do {
+        tree_values.insert(Copy(fnc.Calculate()));
+    } while (fnc.Iterate(MAX_DEPTH));
+
+    // Each value is visited once, by a tree no deeper than the ones reaching it.
+    MemoryBudget budget;
+    ValueBank<uint16_t, true, true> bank{&atoms, MAX_DEPTH, &budget};
+    std::set<std::vector<uint16_t>> bank_values;
+    while (bank.Next()) {
+        ASSERT_TRUE(bank_values.insert(bank.Calculate()).second);
+        FuncNode<uint16_t, true, true> tree{&atoms};
+        bank.ToTree(tree);
+        ASSERT_EQ(Copy(tree.Calculate()), bank.Calculate());
+        ASSERT_EQ(tree.Repr(), bank.Repr());
+        ASSERT_LE(tree.CurrentMaxLevel(), MAX_DEPTH);
+    }
+    ASSERT_TRUE(std::ranges::includes(bank_values, tree_values));
+
+    // The banked values depend on the budget, so positions saved with another one are rejected.
+    MemoryBudget other_budget{LIMIT};
+    ValueBank<uint16_t, true, true> other{&atoms, MAX_DEPTH, &other_budget};
+    ASSERT_FALSE(other.FromJSON(bank.ToJSON()));
+
+    // A tight budget evicts and recomputes values without changing the candidates.
+    MemoryBudget unlimited;
+    MemoryBudget tight{LIMIT};
+    ValueBank<uint16_t, true, true> full_bank{&atoms, DEEP, &unlimited};
+    ValueBank<uint16_t, true, true> tight_bank{&atoms, DEEP, &tight};
+    // Evicted unary chains are recomputed by their tables.
+    const UnaryChains<uint16_t> chains{&atoms, DEEP};
+    tight_bank.SetChains(&chains);
+    while (full_bank.Next()) {
+        ASSERT_TRUE(tight_bank.Next());
+        ASSERT_EQ(tight_bank.Calculate(), full_bank.Calculate());
+    }
+    ASSERT_FALSE(tight_bank.Next());
+    ASSERT_GT(tight.Evictions(), 0);
+    ASSERT_EQ(tight_bank.Dropped(), 0);
+    ASSERT_EQ(tight_bank.Collisions(), 0);
+    ASSERT_LE(tight.Used(), LIMIT);
+    ASSERT_LT(tight_bank.Resident(), full_bank.Resident());
+}
+
+TEST(FuncIterator, ValueBankResume)
+{
+    constexpr std::size_t MAX_DEPTH = 2;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    MemoryBudget budget;
+    ValueBank<uint16_t, true, true> bank{&atoms, MAX_DEPTH, &budget};
+    while (bank.Next()) {
+    }
+
+    // A finished bank resumes finished.
+    MemoryBudget finished_budget;
+    ValueBank<uint16_t, true, true> finished{&atoms, MAX_DEPTH, &finished_budget};
+    ASSERT_TRUE(finished.FromJSON(bank.ToJSON()));
+    ASSERT_FALSE(finished.Next());
+    ASSERT_EQ(finished.Entries(), bank.Entries());
+}
+
+TEST(FuncIterator, ValueBankHugePages)
+{
+    constexpr std::size_t MAX_DEPTH = 2;
+
+    // Blocks are whole huge pages, so huge pages can back each of them.
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    MemoryBudget huge_budget;
+    ValueBank<uint16_t, true, true> huge_bank{&atoms, MAX_DEPTH, &huge_budget, true};
+    while (huge_bank.Next()) {
+    }
+    std::vector<HugePageRegion::Extent> extents;
+    huge_bank.BlockExtents(extents);
+    ASSERT_FALSE(extents.empty());
+    ASSERT_EQ(huge_bank.BlockMemoryBytes(), extents.size() * HugePageRegion::HUGE_PAGE);
+    ASSERT_LE(HugePageRegion::HugeBytes(extents), huge_bank.BlockMemoryBytes());
+}
+
+TEST(FuncIterator, ValueBankSpill)
+{
+    constexpr std::size_t DEEP = 3;
+    constexpr std::size_t SPILL_LIMIT = std::size_t{4} << 20U;
+
+    // A tight budget with a spill directory moves values to disk without changing the candidates.
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    MemoryBudget unlimited;
+    MemoryBudget spill{SPILL_LIMIT};
+    ValueBank<uint16_t, true, true> full_bank{&atoms, DEEP, &unlimited};
+    ValueBank<uint16_t, true, true> spill_bank{&atoms, DEEP, &spill, false,
+                                               std::filesystem::temp_directory_path().string()};
+    while (full_bank.Next()) {
+        ASSERT_TRUE(spill_bank.Next());
+        ASSERT_EQ(spill_bank.Calculate(), full_bank.Calculate());
+    }
+    ASSERT_FALSE(spill_bank.Next());
+    ASSERT_GT(spill_bank.SpilledBytes(), 0);
+    ASSERT_EQ(spill.Evictions(), 0);
+    ASSERT_EQ(spill_bank.Dropped(), 0);
+    ASSERT_LE(spill.Used(), SPILL_LIMIT);
+
+    // A scratch file grows by whole extents, and appended data never crosses one.
+    constexpr std::size_t EXTENT = 1 << 16;
+    ScratchFile scratch{std::filesystem::temp_directory_path().string(), EXTENT};
+    ASSERT_EQ(scratch.Bytes(), 0);
+    auto* first = static_cast<char*>(scratch.Append(EXTENT / 2));
+    auto* second = static_cast<char*>(scratch.Append(EXTENT / 4));
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(second, first + (EXTENT / 2));
+    ASSERT_EQ(scratch.Bytes(), EXTENT);
+    ASSERT_NE(scratch.Append(EXTENT / 2), nullptr);
+    ASSERT_EQ(scratch.Bytes(), 2 * EXTENT);
+    ASSERT_EQ(scratch.Append(EXTENT + 1), nullptr);
+}
+
+TEST(FuncIterator, ValueBankTiles)
+{
+    constexpr std::size_t MAX_DEPTH = 2;
+    constexpr std::size_t TILE = 7;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    MemoryBudget budget;
+    ValueBank<uint16_t, true, true> bank{&atoms, MAX_DEPTH, &budget};
+    std::set<std::vector<uint16_t>> bank_values;
+    while (bank.Next()) {
+        bank_values.insert(bank.Calculate());
+    }
+
+    // Any tile size walks the same pairs in another order, and resumes in it.
+    MemoryBudget tiled_budget;
+    ValueBank<uint16_t, true, true> tiled{&atoms, MAX_DEPTH, &tiled_budget, false, {}, TILE};
+    std::set<std::vector<uint16_t>> tiled_values;
+    long double progress = 0;
+    json position;
+    while (tiled.Next()) {
+        ASSERT_GE(tiled.Progress(), progress);
+        progress = tiled.Progress();
+        ASSERT_TRUE(tiled_values.insert(tiled.Calculate()).second);
+        if (tiled_values.size() == bank_values.size() / 2) {
+            position = tiled.ToJSON();
+        }
+    }
+    ASSERT_EQ(tiled_values, bank_values);
+    MemoryBudget resumed_budget;
+    ValueBank<uint16_t, true, true> resumed{&atoms, MAX_DEPTH, &resumed_budget};
+    ASSERT_TRUE(resumed.FromJSON(position));
+    ASSERT_EQ(resumed.Tile(), TILE);
+    ASSERT_EQ(resumed.ToJSON(), position);
+}
+
+TEST(FuncIterator, StaticAtomSet)
+{
+    constexpr std::size_t MAX_DEPTH = 3;
+    using Full_t = StaticAtomSet<uint16_t, AtomList<K_NOT, K_BITCOUNT>, AtomList<K_SUM, K_AND, K_OR>>;
+    using Binary_t = StaticAtomSet<uint16_t, AtomList<>, AtomList<K_SUM, K_AND, K_OR>>;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    // The same library with all kernels known at compile time, and with runtime unary atoms.
+    AtomFuncs<uint16_t> full_atoms;
+    full_atoms.arg0 = atoms.arg0;
+    Full_t full_set;
+    full_set.Register(full_atoms);
+    AtomFuncs<uint16_t> mixed_atoms;
+    mixed_atoms.arg0 = atoms.arg0;
+    mixed_atoms.arg1 = atoms.arg1;
+    Binary_t binary_set;
+    binary_set.Register(mixed_atoms);
+    ASSERT_EQ(full_atoms.arg2.size(), atoms.arg2.size());
+    ASSERT_EQ(mixed_atoms.arg2.size(), atoms.arg2.size());
+
+    StaticEvaluator<uint16_t, Full_t> full_eval{&full_atoms, &full_set};
+    StaticEvaluator<uint16_t, Binary_t> mixed_eval{&mixed_atoms, &binary_set};
+    full_set.RegisterFused<K_SUM, K_AND, K_OR>();
+    StaticEvaluator<uint16_t, Full_t> fused_eval{&full_atoms, &full_set, true};
+    StaticEvaluator<uint16_t, Binary_t> mixed_fused_eval{&mixed_atoms, &binary_set, true};
+    FuncNode<uint16_t, true, true> fnc{&atoms};
+    FuncNode<uint16_t, true, true> full_fnc{&full_atoms};
+    FuncNode<uint16_t, true, true> mixed_fnc{&mixed_atoms};
+    std::size_t count = 0;
+    do {
+        ASSERT_EQ(full_fnc.Repr(), fnc.Repr());
+        ASSERT_EQ(mixed_fnc.Repr(), fnc.Repr());
+        ASSERT_TRUE(std::ranges::equal(full_eval.Calculate(full_fnc), fnc.Calculate()));
+        ASSERT_TRUE(std::ranges::equal(mixed_eval.Calculate(mixed_fnc), fnc.Calculate()));
+        ASSERT_TRUE(std::ranges::equal(fused_eval.Calculate(full_fnc), fnc.Calculate()));
+        ASSERT_TRUE(std::ranges::equal(mixed_fused_eval.Calculate(mixed_fnc), fnc.Calculate()));
+        ASSERT_EQ(Copy(full_fnc.Calculate()), Copy(fnc.Calculate()));
+        ASSERT_TRUE(full_fnc.Iterate(MAX_DEPTH) == mixed_fnc.Iterate(MAX_DEPTH));
+        ++count;
+    } while (fnc.Iterate(MAX_DEPTH) and (count < 20'000));
+
+    ASSERT_EQ(full_eval.FusedNodes(), 0);
+    ASSERT_EQ(fused_eval.Nodes(), full_eval.Nodes());
+    ASSERT_GT(fused_eval.Hits(FusedPattern::Registered), 0);
+    ASSERT_GT(fused_eval.Hits(FusedPattern::UnaryOverUnary), 0);
+    ASSERT_GT(fused_eval.HitRate(), 0.5);
+    ASSERT_LE(fused_eval.HitRate(), 1.0);
+    // Runtime unary atoms are never fused.
+    ASSERT_EQ(mixed_fused_eval.Hits(FusedPattern::UnaryLeft), 0);
+    ASSERT_GT(mixed_fused_eval.Hits(FusedPattern::BinaryLeft), 0);
+    ASSERT_LT(mixed_fused_eval.HitRate(), fused_eval.HitRate());
+}
+
+TEST(FuncIterator, UnaryChains)
+{
+    constexpr std::size_t MAX_DEPTH = 3;
+    constexpr std::size_t MAX_LENGTH = 3;
+    constexpr std::size_t MAX_TREES = 50'000;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    for (const auto* atom : atoms.arg1) {
+        const LutAtom1<uint16_t> lut{atom};
+        ASSERT_EQ(lut.Str(), atom->Str());
+        ASSERT_EQ(lut.Calculate(atoms.arg0.front()->Calculate()), atom->Calculate(atoms.arg0.front()->Calculate()));
+    }
+
+    const UnaryChains<uint16_t> chains{&atoms, MAX_LENGTH};
+    ASSERT_TRUE(chains.Available());
+    ASSERT_EQ(chains.Count(), 2 + 4 + 8);
+    std::vector<uint16_t> out(VALUES_RANGE);
+    std::size_t longest = 0;
+    FuncNode<uint16_t> fnc{&atoms};
+    for (std::size_t count = 0; (count < MAX_TREES) and fnc.Iterate(MAX_DEPTH); ++count) {
+        FuncNode<uint16_t>* operand = nullptr;
+        const auto table = chains.Match(fnc, operand);
+        if (table.empty()) {
+            continue;
+        }
+        auto below = *operand;
+        UnaryChains<uint16_t>::Apply(table, below.Calculate(), out);
+        ASSERT_EQ(out, Copy(fnc.Calculate()));
+        longest = std::max(longest, fnc.CurrentMaxLevel() - operand->CurrentMaxLevel());
+        // Copies keep no values, so the whole tree is calculated through the tables.
+        auto chained = fnc;
+        ASSERT_EQ(Copy(chained.Calculate(chains)), Copy(fnc.Calculate()));
+    }
+    ASSERT_EQ(longest, MAX_LENGTH);
+
+    // Table counts are bounded before anything is built.
+    ASSERT_EQ(UnaryChains<uint16_t>::TableCount(2, MAX_LENGTH), chains.Count());
+    ASSERT_LE(UnaryChains<uint16_t>::TableCount(2, 11), UnaryChains<uint16_t>::MAX_TABLES);
+    ASSERT_GT(UnaryChains<uint16_t>::TableCount(2, 12), UnaryChains<uint16_t>::MAX_TABLES);
+    ASSERT_GT(UnaryChains<uint16_t>::TableCount(2, SIZE_MAX), UnaryChains<uint16_t>::MAX_TABLES);
+    const UnaryChains<uint16_t> too_long{&atoms, 12};
+    ASSERT_FALSE(too_long.Available());
+}
+
 TEST(FuncIterator, SkipSymmetric)
 {
     AtomFuncs<uint16_t> atoms = MakeAtoms();
@@ -225,6 +1014,600 @@ TEST(SearchTask, JSON)
     }
     ASSERT_TRUE(true);
 }
+
+TEST(SearchTask, ProgressiveEvaluation)
+{
+    constexpr std::size_t MAX_BEST = 5;
+    constexpr std::size_t MAX_ITERATIONS = 3000;
+    constexpr std::size_t PROBE_SAMPLES = 16;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues()};
+    Settings settings;
+    settings.max_best = MAX_BEST;
+    settings.max_depth = 2;
+    SearchTask<uint16_t, true, true> task{settings, &atoms, &target};
+    settings.probe_samples = PROBE_SAMPLES;
+    SearchTask<uint16_t, true, true> probe_task{settings, &atoms, &target};
+    for (std::size_t i = 0; i < MAX_ITERATIONS; ++i) {
+        const bool iterated = task.SearchIterate();
+        ASSERT_EQ(iterated, probe_task.SearchIterate());
+        if (not iterated) {
+            break;
+        }
+    }
+    ASSERT_EQ(task.Best(), probe_task.Best());
+    // Rejected candidates were evaluated on the probe samples only.
+    ASSERT_GT(probe_task.GetStatus().probe_rejected, 0);
+    ASSERT_LT(probe_task.GetStatus().evaluated_samples, task.GetStatus().evaluated_samples);
+}
+
+TEST(SearchTask, TiledEvaluation)
+{
+    constexpr std::size_t TILE_SIZE = 48;
+    constexpr std::size_t FIRST = 10;
+    constexpr std::size_t LAST = 200;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues(), FIRST, LAST};
+    TiledEvaluator<uint16_t> tiled{&atoms, &target, TILE_SIZE};
+    ASSERT_TRUE(tiled.Available());
+
+    FuncNode<uint16_t> fnc{&atoms};
+    fw::MatchMask mask;
+    while (fnc.Iterate(2)) {
+        const auto& values = fnc.Calculate();
+        const auto dist = target.Compare(values);
+        ASSERT_EQ(tiled.Evaluate(fnc, SIZE_MAX, &mask), dist);
+        ASSERT_EQ(mask.ToRangeSet(), target.MatchPositions(values));
+        if (dist > 0) {
+            ASSERT_GT(tiled.Evaluate(fnc, 0), 0);
+        }
+        ASSERT_EQ(tiled.ConstantValues(fnc), std::ranges::adjacent_find(values, std::ranges::not_equal_to{}) ==
+                                                 values.end());
+    }
+
+    // Constant values found tile by tile prune the same trees.
+    FuncNode<uint16_t, true, true> plain{&atoms};
+    FuncNode<uint16_t, true, true> streamed{&atoms};
+    const auto constant_values = [&tiled](const auto& node) { return tiled.ConstantValues(node); };
+    while (plain.Iterate(2)) {
+        ASSERT_TRUE(streamed.Iterate(2, 0, constant_values));
+        ASSERT_EQ(streamed, plain);
+    }
+    ASSERT_FALSE(streamed.Iterate(2, 0, constant_values));
+
+    Settings settings;
+    settings.max_best = 5;
+    settings.max_depth = 2;
+    SearchTask<uint16_t, true, true> task{settings, &atoms, &target};
+    settings.tile_size = TILE_SIZE;
+    SearchTask<uint16_t, true, true> tiled_task{settings, &atoms, &target};
+    while (task.SearchIterate()) {
+        ASSERT_TRUE(tiled_task.SearchIterate());
+    }
+    ASSERT_EQ(task.Best(), tiled_task.Best());
+}
+
+TEST(SearchTask, FusedKernels)
+{
+    constexpr std::size_t TILE_SIZE = 48;
+    constexpr std::size_t FIRST = 10;
+    constexpr std::size_t LAST = 200;
+
+    // Tiles of an atom set known at compile time run through its fused kernels, with the same results.
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues(), FIRST, LAST};
+    TiledEvaluator<uint16_t> tiled{&atoms, &target, TILE_SIZE};
+    using Set_t = StaticAtomSet<uint16_t, AtomList<K_NOT, K_BITCOUNT>, AtomList<K_SUM, K_AND, K_OR>>;
+    AtomFuncs<uint16_t> set_atoms;
+    set_atoms.arg0 = atoms.arg0;
+    Set_t set;
+    set.Register(set_atoms);
+    set.RegisterFused<K_SUM, K_AND, K_OR>();
+    TargetValues<uint16_t> full_target{MakeTargetValues()};
+    TiledEvaluator<uint16_t> full_tiled{&set_atoms, &full_target, TILE_SIZE};
+    StaticTileKernels<uint16_t, FuncNode<uint16_t>, Set_t> kernels{&set_atoms, &set, true};
+    FuncNode<uint16_t> set_fnc{&set_atoms};
+    fw::MatchMask mask;
+    while (set_fnc.Iterate(2)) {
+        const auto& values = set_fnc.Calculate();
+        ASSERT_EQ(full_tiled.Evaluate(set_fnc, SIZE_MAX, &mask, &kernels), full_target.Compare(values));
+        ASSERT_EQ(mask.ToRangeSet(), full_target.MatchPositions(values));
+        ASSERT_EQ(tiled.Evaluate(set_fnc, SIZE_MAX, &mask, &kernels), target.Compare(values));
+    }
+    ASSERT_GT(kernels.HitRate(), 0.0);
+
+    Settings settings;
+    settings.max_best = 5;
+    settings.max_depth = 2;
+    SearchTask<uint16_t, true, true> task{settings, &atoms, &target};
+    while (task.SearchIterate()) {
+    }
+    settings.tile_size = TILE_SIZE;
+    settings.fused_kernels = true;
+    SearchTask<uint16_t, true, true> fused_task{settings, &set_atoms, &target};
+    fused_task.UseAtomSet(&set);
+    while (fused_task.SearchIterate()) {
+    }
+    ASSERT_EQ(fused_task.Best().size(), task.Best().size());
+    for (std::size_t i = 0; i < task.Best().size(); ++i) {
+        ASSERT_EQ(fused_task.Best()[i].Repr(), task.Best()[i].Repr());
+    }
+    ASSERT_GT(fused_task.GetStatus().fused_hit_rate, 0.0);
+    ASSERT_TRUE(fused_task.Status().contains("fused nodes"));
+}
+
+TEST(SearchTask, UnaryChains)
+{
+    constexpr std::size_t TILE_SIZE = 48;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues()};
+    Settings settings;
+    settings.max_best = 5;
+    settings.max_depth = 2;
+    SearchTask<uint16_t, true, true> task{settings, &atoms, &target};
+    settings.unary_chains = 2;
+    SearchTask<uint16_t, true, true> chained_task{settings, &atoms, &target};
+    settings.tile_size = TILE_SIZE;
+    SearchTask<uint16_t, true, true> tiled_chained_task{settings, &atoms, &target};
+    while (task.SearchIterate()) {
+        ASSERT_TRUE(chained_task.SearchIterate());
+        ASSERT_TRUE(tiled_chained_task.SearchIterate());
+    }
+    ASSERT_EQ(task.Best(), chained_task.Best());
+    ASSERT_EQ(task.Best(), tiled_chained_task.Best());
+    ASSERT_TRUE(chained_task.Status().contains("unary chain tables 6"));
+    ASSERT_EQ(chained_task.GetStatus().cache_bytes, chained_task.GetStatus().chain_bytes);
+
+    // Tables beyond their count limit or the memory budget are rejected up front.
+    settings.unary_chains = 12;
+    SearchTask<uint16_t, true, true> too_long_task{settings, &atoms, &target};
+    ASSERT_FALSE(too_long_task.SearchIterate());
+    ASSERT_TRUE(too_long_task.Rejected().contains("more than"));
+    ASSERT_TRUE(too_long_task.Status().starts_with("settings rejected"));
+    settings.unary_chains = 2;
+    settings.memory_budget = chained_task.GetStatus().chain_bytes - 1;
+    SearchTask<uint16_t, true, true> over_budget_task{settings, &atoms, &target};
+    ASSERT_FALSE(over_budget_task.SearchIterate());
+    ASSERT_TRUE(over_budget_task.GetStatus().rejected.contains("memory budget"));
+}
+
+TEST(Target, FileTarget)
+{
+    constexpr std::size_t MASKED = 8;
+    constexpr fw::Weight ODD_WEIGHT = 2;
+
+    const auto values = MakeTargetValues();
+    std::vector<uint8_t> mask(values.size(), 1);
+    std::vector<fw::Weight> weights(values.size(), 1);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        mask[i] = (i < MASKED) ? 0 : 1;
+        weights[i] = (i % 2 == 1) ? ODD_WEIGHT : 1;
+    }
+
+    // Unique directory, so parallel test runs do not share the files
+    std::string dir_template = (std::filesystem::temp_directory_path() / "fw_target_XXXXXX").string();
+    ASSERT_NE(::mkdtemp(dir_template.data()), nullptr);
+    const std::filesystem::path dir{dir_template};
+    const auto values_path = (dir / "values.bin").string();
+    const auto mask_path = (dir / "mask.bin").string();
+    const auto weights_path = (dir / "weights.bin").string();
+    const auto csv_path = (dir / "target.csv").string();
+    {
+        std::ofstream values_file(values_path, std::ios::binary);
+        values_file.write(reinterpret_cast<const char*>(values.data()),
+                          static_cast<std::streamsize>(values.size() * sizeof(uint16_t)));
+        std::ofstream mask_file(mask_path, std::ios::binary);
+        mask_file.write(reinterpret_cast<const char*>(mask.data()), static_cast<std::streamsize>(mask.size()));
+        std::ofstream weights_file(weights_path, std::ios::binary);
+        weights_file.write(reinterpret_cast<const char*>(weights.data()),
+                           static_cast<std::streamsize>(weights.size() * sizeof(fw::Weight)));
+        std::ofstream csv_file(csv_path);
+        csv_file << "value,care,weight\n";
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            csv_file << values[i] << ", " << static_cast<int>(mask[i]) << ", " << weights[i] << "\n";
+        }
+    }
+
+    FileTarget<uint16_t> bin_target;
+    ASSERT_TRUE(bin_target.Load(values_path, mask_path, weights_path));
+    FileTarget<uint16_t> csv_target;
+    ASSERT_TRUE(csv_target.Load(csv_path));
+    ASSERT_FALSE(csv_target.Load(values_path + ".missing"));
+    ASSERT_TRUE(csv_target.Load(csv_path));
+    ASSERT_EQ(bin_target.Values(), values);
+    ASSERT_EQ(csv_target.Values(), values);
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    FuncNode<uint16_t> fnc{&atoms};
+    while (fnc.Iterate(1)) {
+        const auto& fnc_values = fnc.Calculate();
+        Distance dist{};
+        for (std::size_t i = MASKED; i < values.size(); ++i) {
+            dist += (fnc_values[i] != values[i]) ? weights[i] : 0;
+        }
+        ASSERT_EQ(bin_target.Compare(fnc_values), dist);
+        ASSERT_EQ(csv_target.Compare(fnc_values), dist);
+        ASSERT_EQ(bin_target.MatchPositions(fnc_values), csv_target.MatchPositions(fnc_values));
+    }
+    ASSERT_EQ(bin_target.SamplePositions().size(), values.size() - MASKED);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Target, MaskedWeightedKernels)
+{
+    constexpr std::size_t TILE_SIZE = 40;
+    constexpr std::size_t CARE_PERIOD = 3;
+    constexpr fw::Weight MAX_WEIGHT = 4;
+
+    const auto values = MakeTargetValues();
+    std::vector<uint8_t> mask(values.size());
+    std::vector<fw::Weight> weights(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        mask[i] = (i % CARE_PERIOD != 0) ? 1 : 0;
+        weights[i] = static_cast<fw::Weight>(i % MAX_WEIGHT);
+    }
+    TargetValues<uint16_t> target{values, mask, weights};
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TiledEvaluator<uint16_t> tiled{&atoms, &target, TILE_SIZE};
+    ASSERT_TRUE(tiled.Available());
+
+    FuncNode<uint16_t> fnc{&atoms};
+    fw::MatchMask match_mask;
+    while (fnc.Iterate(2)) {
+        const auto& fnc_values = fnc.Calculate();
+        Distance dist{};
+        RangeSet<std::size_t> matches;
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            const auto weight = (mask[i] != 0) ? weights[i] : 0;
+            if (fnc_values[i] != values[i]) {
+                dist += weight;
+            }
+            else if (weight != 0) {
+                matches.Add(i);
+            }
+        }
+        ASSERT_EQ(target.Compare(fnc_values), dist);
+        ASSERT_EQ(target.MatchPositions(fnc_values), matches);
+        ASSERT_EQ(tiled.Evaluate(fnc, SIZE_MAX, &match_mask), dist);
+        ASSERT_EQ(match_mask.ToRangeSet(), matches);
+    }
+}
+
+TEST(SearchTask, AffineStage)
+{
+    std::vector<uint16_t> args;
+    std::vector<uint16_t> affine;
+    std::vector<uint16_t> squares;
+    for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
+        const auto x = static_cast<uint16_t>(i);
+        args.push_back(x);
+        affine.push_back(static_cast<uint16_t>((x << 1U) ^ (x >> 3U) ^ 0x21U));
+        squares.push_back(static_cast<uint16_t>(x * x));
+    }
+    TargetValues<uint16_t> target{affine};
+    const auto positions = target.SamplePositions();
+
+    const auto map = SolveAffine<uint16_t>(args, affine, positions);
+    ASSERT_TRUE(map.has_value());
+    for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
+        ASSERT_EQ(map->Apply(args[i]), affine[i]);
+    }
+    ASSERT_FALSE(SolveAffine<uint16_t>(args, squares, positions).has_value());
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    Settings settings;
+    settings.max_depth = 1;
+    settings.affine_stage = true;
+    SearchTask<uint16_t, true, true> task{settings, &atoms, &target};
+    while (task.SearchIterate()) {
+    }
+    const auto found = task.AffineFunctions();
+    ASSERT_FALSE(found.empty());
+    ASSERT_EQ(found.front(), map->Repr("X"));
+}
+
+TEST(SearchTask, RandomSampling)
+{
+    constexpr std::size_t SAMPLES = 500;
+    constexpr uint64_t SEED = 12345;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues()};
+    Settings settings;
+    settings.max_best = 5;
+    settings.max_depth = 3;
+    settings.random_sampling = true;
+    settings.random_seed = SEED;
+    settings.depth_weights = {0, 0, 1};
+    SearchTask<uint16_t, true, true> task{settings, &atoms, &target};
+    SearchTask<uint16_t, true, true> same_seed_task{settings, &atoms, &target};
+    for (std::size_t i = 0; i < SAMPLES; ++i) {
+        ASSERT_TRUE(task.SearchIterate());
+        ASSERT_TRUE(same_seed_task.SearchIterate());
+    }
+    ASSERT_EQ(task.Best(), same_seed_task.Best());
+    for (auto best : task.Best()) {
+        ASSERT_EQ(best.CurrentMaxLevel(), 2);
+        ASSERT_FALSE(best.Pruned());
+    }
+    // Pruned draws are counted, not evaluated, and do not end the search
+    const auto status = task.GetStatus();
+    ASSERT_GT(status.sample_rejected, 0);
+    ASSERT_EQ(status.iterations_count + status.sample_rejected, SAMPLES);
+    // Draws do not cover the space in order, so no progress or remaining time is made up.
+    ASSERT_EQ(status.done_percent, 0);
+    ASSERT_EQ(status.remaining.count(), 0);
+    ASSERT_TRUE(status.to_string().contains("n/a (random order)"));
+
+    SearchTask<uint16_t, true, true> resumed_task{settings, &atoms, &target};
+    ASSERT_TRUE(resumed_task.FromJSON(task.ToJSON().dump()));
+    for (std::size_t i = 0; i < SAMPLES; ++i) {
+        ASSERT_TRUE(task.SearchIterate());
+        ASSERT_TRUE(resumed_task.SearchIterate());
+    }
+    ASSERT_EQ(task.Best(), resumed_task.Best());
+}
+
+TEST(FuncIterator, SizeOrder)
+{
+    constexpr std::size_t MAX_COST = 5;
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    const SizeOrder<uint16_t> order{&atoms, MAX_COST};
+    ASSERT_TRUE(order.Fits());
+
+    // Ranks are a bijection onto trees of non-decreasing cost, and in-place
+    // rebuilds calculate the same values as fresh trees.
+    FuncNode<uint16_t> fnc{&atoms};
+    std::set<std::string> reprs;
+    std::size_t last_cost = 0;
+    for (fw::SerialNumber_t rank = 0; rank < order.Count(); ++rank) {
+        ASSERT_TRUE(order.Unrank(rank, fnc));
+        ASSERT_EQ(order.Rank(fnc), rank);
+        ASSERT_GE(fnc.Cost(), last_cost);
+        ASSERT_LE(fnc.Cost(), MAX_COST);
+        last_cost = fnc.Cost();
+        reprs.insert(fnc.Repr());
+        FuncNode<uint16_t> fresh{&atoms};
+        ASSERT_TRUE(order.Unrank(rank, fresh));
+        ASSERT_EQ(Copy(fnc.Calculate()), Copy(fresh.Calculate()));
+    }
+    ASSERT_EQ(reprs.size(), order.Count());
+    ASSERT_FALSE(order.Unrank(order.Count(), fnc));
+
+    const SizeOrder<uint16_t, true, true> pruned_order{&atoms, MAX_COST};
+    FuncNode<uint16_t, true, true> pruned{&atoms};
+    std::size_t visited = 0;
+    for (bool ok = pruned_order.Next(pruned, true); ok; ok = pruned_order.Next(pruned)) {
+        ASSERT_FALSE(pruned.Pruned());
+        ++visited;
+    }
+    ASSERT_GT(visited, 0);
+    ASSERT_LT(visited, pruned_order.Count());
+}
+
+TEST(SearchTask, SizeOrder)
+{
+    constexpr std::size_t STEPS = 100;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues()};
+    Settings settings;
+    settings.max_best = 5;
+    settings.size_order = true;
+    settings.max_cost = 5;
+    Task_t task{settings, &atoms, &target};
+    ASSERT_NO_FATAL_FAILURE(CheckResume(task, settings, &atoms, &target, STEPS, [](Task_t& stopped) {
+        const auto status = stopped.GetStatus();
+        ASSERT_GT(status.done_percent, 0.0F);
+        ASSERT_EQ(status.progress_order, fw::status::ProgressOrder::SizeOrder);
+        ASSERT_FALSE(status.sn_overflow);
+    }));
+    for (const auto& best : task.Best()) {
+        ASSERT_LE(best.Cost(), settings.max_cost);
+    }
+
+    // Conflicting enumeration modes are rejected, not resolved by precedence.
+    settings.iterative_deepening = true;
+    ASSERT_EQ(settings.EnumerationModes().size(), 2);
+    SearchTask<uint16_t, true, true> conflict_task{settings, &atoms, &target};
+    ASSERT_FALSE(conflict_task.SearchIterate());
+    ASSERT_EQ(conflict_task.Rejected(), "conflicting enumeration modes: size_order, iterative_deepening");
+}
+
+TEST(SearchTask, BestFirst)
+{
+    constexpr std::size_t STEPS = 100;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues()};
+    Settings settings;
+    settings.max_best = 5;
+    settings.best_first = true;
+    settings.max_cost = 5;
+    settings.max_queue = 16;
+    Task_t task{settings, &atoms, &target};
+    ASSERT_NO_FATAL_FAILURE(CheckResume(task, settings, &atoms, &target, STEPS, [](Task_t& stopped) {
+        const auto status = stopped.GetStatus();
+        ASSERT_GT(status.done_percent, 0.0F);
+        ASSERT_GT(status.queue_size, 0);
+        ASSERT_EQ(status.progress_order, fw::status::ProgressOrder::BestFirst);
+    }));
+    // Cheaper trees come first, so the queue was refilled on the way.
+    ASSERT_GT(task.GetStatus().queue_refills, 0);
+}
+
+TEST(SearchTask, DagProgram)
+{
+    constexpr std::size_t STEPS = 1000;
+
+    // 4 * NOT(X): a tree of 7 nodes, but 3 steps as a DAG.
+    std::vector<uint16_t> values;
+    for (std::size_t i = 0; i < VALUES_RANGE; ++i) {
+        values.push_back(static_cast<uint16_t>(4U * static_cast<uint16_t>(~i)));
+    }
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{values};
+    Settings settings;
+    settings.max_best = 5;
+    settings.dag_steps = 3;
+    Task_t task{settings, &atoms, &target};
+    ASSERT_NO_FATAL_FAILURE(CheckResume(task, settings, &atoms, &target, STEPS, [](Task_t& stopped) {
+        ASSERT_GT(stopped.GetStatus().done_percent, 0.0F);
+        ASSERT_EQ(stopped.GetStatus().progress_order, fw::status::ProgressOrder::Dag);
+    }));
+    auto best = task.Best().front();
+    ASSERT_EQ(Copy(best.Calculate()), values);
+}
+
+TEST(SearchTask, ShapeFirst)
+{
+    constexpr std::size_t STEPS = 100;
+    constexpr std::size_t SHARDS = 3;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues()};
+    Settings settings;
+    settings.max_best = 5;
+    settings.max_depth = 2;
+    settings.shape_first = true;
+    Task_t task{settings, &atoms, &target};
+    ASSERT_NO_FATAL_FAILURE(CheckResume(task, settings, &atoms, &target, STEPS, [](Task_t& stopped) {
+        ASSERT_GT(stopped.GetStatus().done_percent, 0.0F);
+        ASSERT_EQ(stopped.GetStatus().progress_order, fw::status::ProgressOrder::Shapes);
+    }));
+
+    // A checkpoint resumed under another max_depth keeps its depth and the shapes of that depth.
+    Task_t stopped_task{settings, &atoms, &target};
+    for (std::size_t i = 0; i < STEPS; ++i) {
+        ASSERT_TRUE(stopped_task.SearchIterate());
+    }
+    settings.max_depth = 3;
+    Task_t deeper_task{settings, &atoms, &target};
+    settings.max_depth = 2;
+    ASSERT_TRUE(deeper_task.FromJSON(stopped_task.ToJSON().dump()));
+    while (stopped_task.SearchIterate()) {
+    }
+    while (deeper_task.SearchIterate()) {
+    }
+    ASSERT_EQ(deeper_task.Best(), stopped_task.Best());
+    ASSERT_EQ(deeper_task.GetStatus().iterations_count, stopped_task.GetStatus().iterations_count);
+
+    // Gray order visits the same candidates.
+    settings.gray_order = true;
+    Task_t gray_task{settings, &atoms, &target};
+    ASSERT_NO_FATAL_FAILURE(CheckResume(gray_task, settings, &atoms, &target, STEPS));
+    ASSERT_EQ(gray_task.GetStatus().iterations_count, task.GetStatus().iterations_count);
+    settings.gray_order = false;
+
+    // Shards split the shapes between tasks.
+    std::size_t sharded_count = 0;
+    settings.shape_shards = SHARDS;
+    for (std::size_t shard = 0; shard < SHARDS; ++shard) {
+        settings.shape_shard = shard;
+        SearchTask<uint16_t, true, true> shard_task{settings, &atoms, &target};
+        while (shard_task.SearchIterate()) {
+        }
+        sharded_count += shard_task.GetStatus().iterations_count;
+    }
+    ASSERT_EQ(sharded_count, task.GetStatus().iterations_count);
+}
+
+TEST(SearchTask, IterativeDeepening)
+{
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues()};
+    Settings settings;
+    settings.max_best = 5;
+    settings.max_depth = 2;
+    settings.iterative_deepening = true;
+    SearchTask<uint16_t, true, true> shallow_task{settings, &atoms, &target};
+    while (shallow_task.SearchIterate()) {
+    }
+    const auto depths = shallow_task.Depths();
+    ASSERT_EQ(depths.size(), 3);
+    ASSERT_EQ(depths.back().depth, 2);
+    ASSERT_EQ(depths.back().count, shallow_task.GetStatus().iterations_count);
+
+    // Resuming at a higher depth continues after the completed depths.
+    settings.max_depth = 3;
+    SearchTask<uint16_t, true, true> deep_task{settings, &atoms, &target};
+    ASSERT_TRUE(deep_task.FromJSON(shallow_task.ToJSON().dump()));
+    ASSERT_FALSE(deep_task.Done());
+    while (deep_task.SearchIterate()) {
+    }
+    SearchTask<uint16_t, true, true> full_task{settings, &atoms, &target};
+    while (full_task.SearchIterate()) {
+    }
+    ASSERT_EQ(deep_task.GetStatus().iterations_count, full_task.GetStatus().iterations_count);
+    ASSERT_EQ(deep_task.Best(), full_task.Best());
+    ASSERT_EQ(deep_task.Depths().size(), 4);
+    ASSERT_EQ(deep_task.Depths()[2].count, depths.back().count);
+
+    // Value banks are carried to the next depth instead of being rebuilt from scratch.
+    settings.bottom_up = true;
+    settings.max_depth = 2;
+    ASSERT_EQ(settings.EnumerationModes().size(), 1);
+    SearchTask<uint16_t, true, true> shallow_bank_task{settings, &atoms, &target};
+    while (shallow_bank_task.SearchIterate()) {
+    }
+    const auto shallow_status = shallow_bank_task.GetStatus();
+    ASSERT_EQ(shallow_bank_task.Depths().size(), 3);
+    settings.max_depth = 3;
+    SearchTask<uint16_t, true, true> deep_bank_task{settings, &atoms, &target};
+    ASSERT_TRUE(deep_bank_task.FromJSON(shallow_bank_task.ToJSON().dump()));
+    ASSERT_EQ(deep_bank_task.GetStatus().bank_entries, shallow_status.bank_entries);
+    while (deep_bank_task.SearchIterate()) {
+    }
+    SearchTask<uint16_t, true, true> full_bank_task{settings, &atoms, &target};
+    while (full_bank_task.SearchIterate()) {
+    }
+    ASSERT_GT(full_bank_task.GetStatus().iterations_count, shallow_status.iterations_count);
+    ASSERT_EQ(deep_bank_task.GetStatus().iterations_count, full_bank_task.GetStatus().iterations_count);
+    ASSERT_EQ(deep_bank_task.GetStatus().bank_entries, full_bank_task.GetStatus().bank_entries);
+    ASSERT_EQ(deep_bank_task.Best(), full_bank_task.Best());
+    ASSERT_EQ(deep_bank_task.Depths().size(), 4);
+    ASSERT_EQ(deep_bank_task.Depths()[2].count, shallow_status.iterations_count);
+    ASSERT_EQ(full_bank_task.Depths().back().count, full_bank_task.GetStatus().iterations_count);
+}
+
+TEST(SearchTask, BottomUp)
+{
+    constexpr std::size_t STEPS = 100;
+    constexpr std::size_t LIMIT = std::size_t{6} << 20U;
+
+    AtomFuncs<uint16_t> atoms = MakeAtoms();
+    TargetValues<uint16_t> target{MakeTargetValues()};
+    Settings settings;
+    settings.max_best = 5;
+    settings.max_depth = 3;
+    settings.bottom_up = true;
+    settings.memory_budget = LIMIT;
+
+    // The banks are rebuilt by replay, so both tasks continue alike.
+    Task_t task{settings, &atoms, &target};
+    std::string checkpoint;
+    ASSERT_NO_FATAL_FAILURE(CheckResume(task, settings, &atoms, &target, STEPS, [&](Task_t& stopped) {
+        const auto status = stopped.GetStatus();
+        ASSERT_EQ(status.bank_entries, STEPS);
+        ASSERT_GT(status.cache_bytes, 0);
+        ASSERT_GT(status.done_percent, 0.0F);
+        ASSERT_EQ(status.progress_order, fw::status::ProgressOrder::BottomUp);
+        ASSERT_FALSE(status.sn_overflow);
+        checkpoint = stopped.ToJSON().dump();
+    }));
+    // The budget is too tight for the deepest level, so values were evicted.
+    ASSERT_GT(task.GetStatus().cache_evictions, 0);
+
+    // Another budget banks other values, so the checkpoint does not apply.
+    settings.memory_budget = 2 * LIMIT;
+    Task_t other_task{settings, &atoms, &target};
+    ASSERT_FALSE(other_task.FromJSON(checkpoint));
+}
+
 // NOLINTEND(readability-function-cognitive-complexity, readability-function-size)
 
 int main(int argc, char** argv)